@@ -11,6 +11,8 @@
 #include <stdint.h>
 #include "main.h"
 #include "stdbool.h"
+#include "DW_FramePool.h"
+#include "DW_Timestamp.h"
 
 /* Register Address Map */
 #define DW_REG_DEV_ID          0x00
@@ -67,14 +69,15 @@ typedef enum {
 typedef enum {
     DW_TX_MODE_STANDARD,
     DW_TX_MODE_DELAYED,
-    DW_TX_MODE_RESPONSE
+    DW_TX_MODE_RESPONSE,            // Receiver turns on W4R_TIM after TX
+    DW_TX_MODE_DELAYED_RESPONSE     // Delayed TX, then wait for response
 } DW_TxMode_t;
 
 
 /* Register Definition Structure */
 typedef struct {
     uint8_t address;
-    uint8_t length;
+    uint16_t length;
     DW_RegAccessType access;
     const char* name;
     const char* description;
@@ -154,7 +157,7 @@ static const DW_RegisterDef DW_Registers[] = {
     {0x2B, 21, DW_REG_READ_WRITE, "FS_CTRL", "Frequency synthesiser control block"},
     {0x2C, 12, DW_REG_READ_WRITE, "AON", "Always-On register set"},
     {0x2D, 18, DW_REG_READ_WRITE, "OTP_IF", "One Time Programmable Memory Interface"},
-    {0x2E, 0, DW_REG_READ_WRITE, "LDE_CTRL", "Leading edge detection control block"},
+    {0x2E, 0x2806, DW_REG_READ_WRITE, "LDE_CTRL", "Leading edge detection control block"},
     {0x2F, 41, DW_REG_READ_WRITE, "DIG_DIAG", "Digital Diagnostics Interface"},
     {0x36, 48, DW_REG_READ_WRITE, "PMSC", "Power Management System Control Block"}
 };
@@ -162,35 +165,419 @@ static const DW_RegisterDef DW_Registers[] = {
 /* Channel Control Register Bit Definitions */
 #define DW_CHAN_CTRL_TX_CHAN_MASK     0x0000000F
 #define DW_CHAN_CTRL_RX_CHAN_MASK     0x000000F0
-#define DW_CHAN_CTRL_TX_PRF_MASK      0x00000300
-#define DW_CHAN_CTRL_TX_PRF_16MHZ     0x00000100
-#define DW_CHAN_CTRL_TX_PRF_64MHZ     0x00000200
-#define DW_CHAN_CTRL_PHY_MODE_MASK    0x00000C00
+#define DW_CHAN_CTRL_RX_CHAN_SHIFT    4
+#define DW_CHAN_CTRL_DWSFD            0x00020000
+#define DW_CHAN_CTRL_RXPRF_SHIFT      18
+#define DW_CHAN_CTRL_TNSSFD           0x00100000
+#define DW_CHAN_CTRL_RNSSFD           0x00200000
+#define DW_CHAN_CTRL_TX_PCODE_SHIFT   22
+#define DW_CHAN_CTRL_RX_PCODE_SHIFT   27
+
+/* TX_FCTRL Register Bit Definitions */
+#define DW_TX_FCTRL_TFLEN_MASK        0x000003FF
+#define DW_TX_FCTRL_TXBR_SHIFT        13
+#define DW_TX_FCTRL_TR                0x00008000
+#define DW_TX_FCTRL_TXPRF_SHIFT       16
+#define DW_TX_FCTRL_TXPSR_PE_SHIFT    18
+#define DW_TX_FCTRL_TXBOFFS_SHIFT     22
 
 
 /* SYS_CTRL Register Bit Definitions */
-#define SYS_CTRL_TXEN      (0x00000001)  // Transmitter enable
-#define SYS_CTRL_RXEN      (0x00000002)  // Receiver enable
-#define SYS_CTRL_TXSTRT    (0x00000004)  // Start transmission
+#define SYS_CTRL_SFCST     (0x00000001)  // Suppress auto-FCS transmission
+#define SYS_CTRL_TXSTRT    (0x00000002)  // Start transmission
+#define SYS_CTRL_TXDLYS    (0x00000004)  // Delayed transmit enable
 #define SYS_CTRL_TRXOFF    (0x00000040)  // Transceiver off
-#define SYS_CTRL_TXDLYE    (0x00000020)  // Delayed transmit enable
-#define SYS_CTRL_RXDLYE    (0x00000080)  // Delayed receive enable
+#define SYS_CTRL_WAIT4RESP (0x00000080)  // Wait for response after TX
+#define SYS_CTRL_RXENAB    (0x00000100)  // Receiver enable
+#define SYS_CTRL_RXDLYE    (0x00000200)  // Delayed receive enable
+#define SYS_CTRL_HRBPT     (0x01000000)  // Host side receive buffer pointer toggle
+
+/* Sub-register Offsets */
+#define DW_SUB_AGC_TUNE1       0x04    // AGC_CTRL
+#define DW_SUB_AGC_TUNE2       0x0C
+#define DW_SUB_AGC_TUNE3       0x12
+#define DW_SUB_DRX_TUNE0B      0x02    // DRX_CONF
+#define DW_SUB_DRX_TUNE1A      0x04
+#define DW_SUB_DRX_TUNE1B      0x06
+#define DW_SUB_DRX_TUNE2       0x08
+#define DW_SUB_DRX_SFDTOC      0x20
+#define DW_SUB_DRX_PRETOC      0x24
+#define DW_SUB_DRX_TUNE4H      0x26
+#define DW_SUB_DRX_PACC_NOSAT  0x2C
+#define DW_SUB_RF_RXCTRLH      0x0B    // RF_CONF
+#define DW_SUB_RF_TXCTRL       0x0C
+#define DW_SUB_TC_PGDELAY      0x0B    // TX_CAL
+#define DW_SUB_FS_PLLCFG       0x07    // FS_CTRL
+#define DW_SUB_FS_PLLTUNE      0x0B
+#define DW_SUB_OTP_CTRL        0x06    // OTP_IF
+#define DW_SUB_LDE_CFG1        0x0806  // LDE_CTRL
+#define DW_SUB_LDE_CFG2        0x1806
+#define DW_SUB_LDE_RXANTD      0x1804
+#define DW_SUB_LDE_REPC        0x2804
+#define DW_SUB_EVC_CTRL        0x00    // DIG_DIAG
+#define DW_SUB_EVC_PHE         0x04
+#define DW_SUB_EVC_FFR         0x0C
+#define DW_SUB_RX_FP_INDEX     0x05    // RX_TIME
+#define DW_SUB_RX_FP_AMPL1     0x07
+#define DW_SUB_PMSC_CTRL0      0x00    // PMSC
+#define DW_SUB_PMSC_CTRL1      0x04
+#define DW_SUB_EC_CTRL         0x00    // EXT_SYNC
+#define DW_SUB_EC_RXTC         0x04
+#define DW_SUB_EC_GOLP         0x08
+#define DW_SUB_GPIO_MODE       0x00    // GPIO_CTRL
+
+/* PMSC_CTRL0 Bit Definitions */
+#define DW_PMSC_CTRL0_RXCLKS_MASK   0x000C
+#define DW_PMSC_CTRL0_RXCLKS_PLL    0x0008  // Force the 125 MHz PLL clock
+#define DW_PMSC_CTRL0_FACE          0x0040  // Accumulator clock enable
+#define DW_PMSC_CTRL0_AMCE          0x8000  // Accumulator memory clock enable
+
+/* EC_CTRL Bit Definitions */
+#define DW_EC_CTRL_OSTSM            0x00000001  // One-shot TX on SYNC (not used)
+#define DW_EC_CTRL_OSRSM            0x00000002  // One-shot receiver enable on SYNC
+#define DW_EC_CTRL_WAIT_SHIFT       3           // 38.4 MHz cycles from SYNC to action
+#define DW_EC_CTRL_WAIT_MASK        0x000007F8
+#define DW_EC_CTRL_OSTRM            0x00000800  // One-shot timebase reset on SYNC
+#define DW_EC_GOLP_MASK             0x3F        // First path offset, 1 GHz counts
+#define DW_GPIO_MSGP7_MASK          0x00300000  // GPIO_MODE: 00 selects the SYNC input
+
+/* SYS_STATUS Register Bit Definitions (low 32 bits) */
+#define SYS_STATUS_IRQS    (0x00000001)  // Interrupt request status
+#define SYS_STATUS_CPLOCK  (0x00000002)  // Clock PLL lock
+#define SYS_STATUS_TXFRB   (0x00000010)  // Transmit frame begins
+#define SYS_STATUS_TXPRS   (0x00000020)  // Transmit preamble sent
+#define SYS_STATUS_TXPHS   (0x00000040)  // Transmit PHY header sent
+#define SYS_STATUS_TXFRS   (0x00000080)  // Transmit frame sent
+#define SYS_STATUS_RXPRD   (0x00000100)  // Receiver preamble detected
+#define SYS_STATUS_RXSFDD  (0x00000200)  // Receiver SFD detected
+#define SYS_STATUS_LDEDONE (0x00000400)  // LDE processing done
+#define SYS_STATUS_RXPHD   (0x00000800)  // Receiver PHY header detect
+#define SYS_STATUS_RXPHE   (0x00001000)  // Receiver PHY header error
+#define SYS_STATUS_RXDFR   (0x00002000)  // Receiver data frame ready
+#define SYS_STATUS_RXFCG   (0x00004000)  // Receiver FCS good
+#define SYS_STATUS_RXFCE   (0x00008000)  // Receiver FCS error
+#define SYS_STATUS_RXRFSL  (0x00010000)  // Reed Solomon frame sync loss
+#define SYS_STATUS_RXRFTO  (0x00020000)  // Receive frame wait timeout
+#define SYS_STATUS_LDEERR  (0x00040000)  // Leading edge detection error
+#define SYS_STATUS_RXOVRR  (0x00100000)  // Receiver overrun
+#define SYS_STATUS_RXPTO   (0x00200000)  // Preamble detection timeout
+#define SYS_STATUS_RXSFDTO (0x04000000)  // Receive SFD timeout
+#define SYS_STATUS_HPDWARN (0x08000000)  // Half period delay warning
+#define SYS_STATUS_TXBERR  (0x10000000)  // Transmit buffer error
+#define SYS_STATUS_AFFREJ  (0x20000000)  // Automatic frame filtering rejection
+#define SYS_STATUS_HSRBP   (0x40000000)  // Host side receive buffer pointer
+#define SYS_STATUS_ICRBP   (0x80000000)  // IC side receive buffer pointer
 
-/* Channel Control Options */
-#define DW_CHAN_CTRL_TX_CHAN_5  (0x00000001)  // Channel 5 (default)
-#define DW_CHAN_CTRL_TX_PRF_64MHZ (0x00000200) // 64 MHz PRF
+#define SYS_STATUS_ALL_TX  (SYS_STATUS_TXFRB | SYS_STATUS_TXPRS | \
+                            SYS_STATUS_TXPHS | SYS_STATUS_TXFRS)
+#define SYS_STATUS_ALL_RX_GOOD (SYS_STATUS_RXDFR | SYS_STATUS_RXFCG | \
+                                SYS_STATUS_RXPRD | SYS_STATUS_RXSFDD | \
+                                SYS_STATUS_RXPHD | SYS_STATUS_LDEDONE)
+#define SYS_STATUS_ALL_RX_ERR  (SYS_STATUS_RXPHE | SYS_STATUS_RXFCE | \
+                                SYS_STATUS_RXRFSL | SYS_STATUS_RXSFDTO | \
+                                SYS_STATUS_AFFREJ | SYS_STATUS_LDEERR | \
+                                SYS_STATUS_RXOVRR)
+#define SYS_STATUS_ALL_RX_TO   (SYS_STATUS_RXRFTO | SYS_STATUS_RXPTO)
 
+/* RX_FINFO Register Bit Definitions */
+#define DW_RX_FINFO_RXFLEN_MASK        0x000003FF  // RXFLEN + RXFLE
+#define DW_RX_FINFO_RXBR_SHIFT         13
+#define DW_RX_FINFO_RNG                0x00008000
+#define DW_RX_FINFO_RXPRFR_SHIFT       16
+#define DW_RX_FINFO_RXPACC_SHIFT       20
+
+/* RX_TTCKO Register Bit Definitions */
+#define DW_RX_TTCKO_RXTOFS_MASK        0x0007FFFF  // Time tracking offset, 19-bit signed
+#define DW_RX_TTCKO_RXTOFS_SIGN        0x00040000
+
+
+/* ACK_RESP_T Register Bit Definitions */
+#define DW_ACK_RESP_T_W4R_TIM_MASK     0x000FFFFF  // Wait-for-response turn-on time
+#define DW_ACK_RESP_T_ACK_TIM_MASK     0xFF000000  // Auto-ACK turnaround (symbols)
 
 /* System Configuration Register Bit Definitions */
-#define DW_SYS_CFG_RXAUTR              0x00000001
-#define DW_SYS_CFG_AUTOACK             0x00000002
-#define DW_SYS_CFG_FFEN                0x00000004
-#define DW_SYS_CFG_FFBC                0x00000008
-#define DW_SYS_CFG_FFAB                0x00000010
+#define DW_SYS_CFG_FFEN                0x00000001  // Frame filtering enable
+#define DW_SYS_CFG_FFBC                0x00000002  // Behave as coordinator
+#define DW_SYS_CFG_FFAB                0x00000004  // Allow beacon frames
+#define DW_SYS_CFG_FFAD                0x00000008  // Allow data frames
+#define DW_SYS_CFG_FFAA                0x00000010  // Allow ACK frames
+#define DW_SYS_CFG_FFAM                0x00000020  // Allow MAC command frames
+#define DW_SYS_CFG_FFAR                0x00000040  // Allow reserved frame types
+#define DW_SYS_CFG_FFA4                0x00000080  // Allow frame type 4
+#define DW_SYS_CFG_FFA5                0x00000100  // Allow frame type 5
+#define DW_SYS_CFG_FF_MASK             0x000001FF
+#define DW_SYS_CFG_DIS_DRXB            0x00001000
+#define DW_SYS_CFG_PHR_MODE_MASK       0x00030000
+#define DW_SYS_CFG_PHR_MODE_SHIFT      16
+#define DW_SYS_CFG_RXM110K             0x00400000
+#define DW_SYS_CFG_RXWTOE              0x10000000  // Receive wait timeout enable
+#define DW_SYS_CFG_RXAUTR              0x20000000  // Receiver auto re-enable
+#define DW_SYS_CFG_AUTOACK             0x40000000
+
+/* Physical Layer Configuration */
+typedef enum {
+    DW_BR_110K = 0,
+    DW_BR_850K = 1,
+    DW_BR_6M8  = 2
+} DW_DataRate_t;
+
+typedef enum {
+    DW_PRF_16M = 1,
+    DW_PRF_64M = 2
+} DW_Prf_t;
+
+/* Preamble length, encoded as the TX_FCTRL TXPSR/PE field */
+typedef enum {
+    DW_PLEN_64   = 0x1,
+    DW_PLEN_128  = 0x5,
+    DW_PLEN_256  = 0x9,
+    DW_PLEN_512  = 0xD,
+    DW_PLEN_1024 = 0x2,
+    DW_PLEN_1536 = 0x6,
+    DW_PLEN_2048 = 0xA,
+    DW_PLEN_4096 = 0x3
+} DW_PreambleLen_t;
+
+/* Preamble acquisition chunk size */
+typedef enum {
+    DW_PAC_8,
+    DW_PAC_16,
+    DW_PAC_32,
+    DW_PAC_64
+} DW_Pac_t;
+
+typedef enum {
+    DW_PHR_STD = 0,     // Frames up to 127 bytes
+    DW_PHR_EXT = 3      // Frames up to 1023 bytes
+} DW_PhrMode_t;
+
+typedef struct {
+    uint8_t channel;                // 1, 2, 3, 4, 5 or 7
+    DW_Prf_t prf;
+    DW_DataRate_t data_rate;
+    DW_PreambleLen_t preamble_len;
+    DW_Pac_t pac;
+    uint8_t preamble_code;          // Used for both TX and RX
+    bool nonstd_sfd;                // Decawave SFD instead of IEEE SFD
+    DW_PhrMode_t phr_mode;
+} DW_PhyConfig_t;
+
+extern const DW_PhyConfig_t DW_PHY_DEFAULT;
+
+/* Transmit Frame Builder
+ * Frames are assembled directly in a static SPI/DMA buffer that already holds
+ * the TX_BUFFER write header, so header and payload are written in place and
+ * clocked out in a single SPI transaction without an intermediate copy. */
+#ifndef DW_TX_FRAME_MAX
+#define DW_TX_FRAME_MAX        127   // Longest frame incl. FCS (standard PHR)
+#endif
+#define DW_FCS_LEN             2     // CRC appended automatically by the DW1000
+#define DW_SPI_HDR_MAX         3     // Longest SPI transaction header
+#define DW_SPI_DMA_MIN         16    // Shorter reads are not worth the DMA setup
+#define DW_SPI_DMA_TIMEOUT_MS  10    // DMA transfer not done after this is aborted
+#define DW_TX_BUFFER_SIZE      1024
+
+typedef struct {
+    uint8_t* data;      // Frame start inside the SPI TX buffer
+    uint16_t length;    // Bytes written so far
+    uint16_t capacity;  // Bytes available, excluding FCS
+} DW_FrameBuilder_t;
+
+/* IEEE 802.15.4 Frame Control Field */
+#define DW_FC_TYPE_BEACON      0x0000
+#define DW_FC_TYPE_DATA        0x0001
+#define DW_FC_TYPE_ACK         0x0002
+#define DW_FC_TYPE_MAC_CMD     0x0003
+#define DW_FC_TYPE_MASK        0x0007
+#define DW_FC_ACK_REQ          0x0020
+#define DW_FC_PANID_COMP       0x0040
+#define DW_FC_DST_SHORT        0x0800
+#define DW_FC_SRC_SHORT        0x8000
+#define DW_FC_DST_MODE_MASK    0x0C00
+#define DW_FC_DST_EXT          0x0C00
+#define DW_FC_SRC_MODE_MASK    0xC000
+#define DW_FC_SRC_EXT          0xC000
+#define DW_MAC_HDR_SHORT_LEN   9     // FC + seq + PAN + dst + src
+
+/* DIG_DIAG Event Counters (12 bits, wrap around) */
+#define DW_EVC_CTRL_EN         0x00000001
+#define DW_EVC_CTRL_CLR        0x00000002
+#define DW_EVC_MASK            0x0FFF
+
+/* Parsed IEEE 802.15.4 MAC header. Addresses hold either a short or an
+ * extended address, depending on the addressing mode in frame_ctrl. */
+typedef struct {
+    uint16_t frame_ctrl;
+    uint8_t seq;
+    uint16_t dst_pan;
+    uint64_t dst_addr;
+    uint16_t src_pan;
+    uint64_t src_addr;
+    uint8_t length;             // Header bytes, payload starts here
+} DW_MacHeader_t;
+
+/* Frame Filtering
+ * The DW1000 checks frame type, destination PAN and address before the
+ * frame reaches the host; rejected frames never raise an interrupt. The
+ * software filter handles what the hardware cannot: source allow-lists and
+ * retransmitted duplicates. */
+#define DW_SW_FILTER_MAX_SRC   8
+#define DW_SW_FILTER_DUP_CACHE 4     // Sources remembered for duplicate detection
+
+typedef struct {
+    uint16_t pan_id;
+    uint16_t short_addr;
+    uint16_t frame_types;       // DW_SYS_CFG_FFAB..FFA5 bits of accepted types
+    bool coordinator;           // Also accept frames without destination (FFBC)
+} DW_FilterConfig_t;
+
+typedef struct {
+    uint16_t src_allow[DW_SW_FILTER_MAX_SRC];   // Short source addresses accepted
+    uint8_t src_allow_count;    // 0 accepts any source
+    bool drop_duplicates;       // Same source and sequence number as the last frame
+} DW_SwFilter_t;
+
+typedef struct {
+    uint32_t hw_rejected;       // Dropped by the DW1000 (EVC_FFR)
+    uint32_t sw_rejected;       // Dropped by the source allow-list
+    uint32_t sw_duplicates;     // Dropped as duplicates
+    uint32_t accepted;          // Passed both stages
+} DW_FilterStats_t;
+
+/* Driver Events
+ * DW_ProcessEvents() services the radio (from the main loop) and queues
+ * completion records; the application drains them with DW_GetEvent() or
+ * receives them through a callback. */
+#define DW_EVENT_QUEUE_LEN     8     // Must be a power of two
+#define DW_TX_TIMEOUT_MS       20    // TX not done after this is reported
+
+typedef uint16_t DW_TxHandle_t;
+
+typedef enum {
+    DW_EVENT_NONE,
+    DW_EVENT_TX_DONE,
+    DW_EVENT_RX_FRAME,      // Good frame, owner must DW_PoolFree(rx.frame)
+    DW_EVENT_RX_ERROR,
+    DW_EVENT_RX_TIMEOUT
+} DW_EventType_t;
+
+typedef enum {
+    DW_TX_OK,
+    DW_TX_LATE,         // Delayed TX time already passed (HPDWARN), aborted
+    DW_TX_TIMEOUT,      // TXFRS never seen
+    DW_TX_NO_STAMP      // Sent, but TX_TIME could not be read
+} DW_TxStatus_t;
+
+typedef struct {
+    DW_TxHandle_t handle;   // Handle returned by DW_GetLastTxHandle()
+    DW_TxStatus_t status;
+    DW_Time_t tx_time;      // TX_STAMP if DW_TX_OK with timestamping on, else 0
+} DW_TxCompletion_t;
+
+/* Receive status, one per SYS_STATUS error/timeout cause */
+typedef enum {
+    DW_RX_OK,
+    DW_RX_ERR_PHR,              // PHY header error (RXPHE)
+    DW_RX_ERR_FCS,              // CRC error (RXFCE)
+    DW_RX_ERR_SYNC_LOSS,        // Reed Solomon frame sync loss (RXRFSL)
+    DW_RX_ERR_SFD_TIMEOUT,      // SFD not found after preamble (RXSFDTO)
+    DW_RX_ERR_LDE,              // Leading edge detection failed (LDEERR)
+    DW_RX_ERR_OVERRUN,          // Receiver overrun (RXOVRR)
+    DW_RX_ERR_REJECTED,         // Frame filtering rejection (AFFREJ)
+    DW_RX_ERR_BUFFER,           // No frame buffer available or SPI failure
+    DW_RX_TIMEOUT_FRAME,        // Frame wait timeout (RXRFTO)
+    DW_RX_TIMEOUT_PREAMBLE      // Preamble detection timeout (RXPTO)
+} DW_RxStatus_t;
+
+typedef struct {
+    uint16_t length;            // Frame length excluding FCS
+    uint16_t preamble_count;    // Preamble symbols accumulated (RXPACC)
+    DW_DataRate_t data_rate;
+    DW_Prf_t prf;
+    bool ranging;               // Ranging bit set in the PHR
+} DW_RxFrameInfo_t;
+
+/* Receive Statistics */
+typedef struct {
+    uint32_t frames;            // Good frames delivered
+    uint32_t errors;            // Frames lost to PHR/FCS/sync/SFD/LDE errors
+    uint32_t timeouts;          // Frame wait and preamble timeouts
+    uint32_t overruns;          // Frames lost with both RX buffers full
+    uint32_t discarded;         // Frames dropped by the classifier after the header read
+} DW_RxStats_t;
+
+/* Per-cause receive counters for continuous listening. The first nine
+ * come from the DW1000 event counters and also count errors the chip
+ * recovered from on its own. */
+typedef struct {
+    uint32_t phr_errors;        // EVC_PHE
+    uint32_t sync_loss;         // EVC_RSE
+    uint32_t fcs_good;          // EVC_FCG
+    uint32_t fcs_errors;        // EVC_FCE
+    uint32_t filter_rejects;    // EVC_FFR
+    uint32_t overruns;          // EVC_OVR
+    uint32_t sfd_timeouts;      // EVC_STO
+    uint32_t preamble_timeouts; // EVC_PTO
+    uint32_t frame_timeouts;    // EVC_FWTO
+    uint32_t lde_errors;        // LDEERR seen by the host
+    uint32_t rx_resets;         // Receiver soft resets by the driver
+    uint32_t reenables;         // RXENAB issued by the driver
+    uint32_t elapsed_ms;        // Time since the counters were reset
+    uint64_t deaf_us;           // Receiver off, from detection to re-enable
+    uint32_t deaf_max_us;       // Longest single deaf interval
+} DW_RxCounters_t;
+
+/* Header-first reception: decides from the first bytes of a frame whether
+ * the rest is read from RX_BUFFER. Called from DW_ProcessEvents(). */
+typedef bool (*DW_RxClassifier_t)(const uint8_t* header, uint8_t length,
+                                  const DW_RxFrameInfo_t* info);
+
+#define DW_RX_OFFSET_INVALID   INT32_MIN
+
+/* Raw receive quality of one frame, read while its buffer is still on the
+ * host side (see DW_RxSetQualityCapture). DW_Diag turns it into levels. */
+typedef struct {
+    uint16_t fp_index;          // First path index, 10.6 fixed point
+    uint16_t fp_ampl1;          // First path amplitude points 1-3
+    uint16_t fp_ampl2;
+    uint16_t fp_ampl3;
+    uint16_t std_noise;         // Standard deviation of the noise
+    uint16_t cir_power;         // Channel impulse response power
+    uint16_t rxpacc_nosat;      // RXPACC_NOSAT, equal to RXPACC unless the count saturated
+} DW_RxQuality_t;
+
+typedef struct {
+    DW_RxStatus_t status;
+    DW_RxFrameInfo_t info;      // Valid for DW_EVENT_RX_FRAME
+    DW_Time_t rx_time;          // RX_STAMP, valid for DW_EVENT_RX_FRAME
+    int32_t clock_offset_ppb;   // Transmitter clock relative to ours, DW_RX_OFFSET_INVALID if not read
+    DW_RxQuality_t quality;     // All zero unless quality capture is enabled
+    DW_FrameBuf_t* frame;       // Frame data (info.length bytes), see DW_EVENT_RX_FRAME
+} DW_RxEvent_t;
+
+typedef struct {
+    DW_EventType_t type;
+    union {
+        DW_TxCompletion_t tx;
+        DW_RxEvent_t rx;
+    };
+} DW_Event_t;
+
+typedef void (*DW_EventCallback_t)(const DW_Event_t* evt);
 
 /* Function Prototypes */
 uint32_t DW_ReadReg(uint8_t reg_addr, uint8_t* data, uint8_t length);
 uint32_t DW_WriteReg(uint8_t reg_addr, uint8_t* data, uint8_t length);
+uint32_t DW_ReadSubReg(uint8_t reg_addr, uint16_t offset, uint8_t* data, uint16_t length);
+uint32_t DW_WriteSubReg(uint8_t reg_addr, uint16_t offset, const uint8_t* data, uint16_t length);
+uint32_t DW_ReadStatus(void);
+HAL_StatusTypeDef DW_ClearStatus(uint32_t bits);
+HAL_StatusTypeDef DW_Configure(const DW_PhyConfig_t* cfg);
+const DW_PhyConfig_t* DW_GetPhyConfig(void);
+HAL_StatusTypeDef DW_SetAntennaDelay(uint16_t tx_antd, uint16_t rx_antd);
+HAL_StatusTypeDef DW_GetAntennaDelay(uint16_t* tx_antd, uint16_t* rx_antd);
+uint32_t DW_FrameAirtimeUs(const DW_PhyConfig_t* cfg, uint16_t frame_len);
+HAL_StatusTypeDef DW_SpiSetFast(bool fast);
 uint32_t DW_ReadDevID(void);
 uint32_t DW_WriteEUI(uint8_t* eui);
 uint32_t DW_ReadEUI(uint8_t* eui);
@@ -199,7 +586,80 @@ HAL_StatusTypeDef DW_WriteAndVerifyEUI(uint8_t* eui);
 bool DW_CompareEUI(uint8_t* eui1, uint8_t* eui2);
 HAL_StatusTypeDef DW_EnableTxMode(DW_TxMode_t mode);
 HAL_StatusTypeDef DW_DisableTxMode(void);
+HAL_StatusTypeDef DW_SetResponseDelay(uint32_t delay_us);
+HAL_StatusTypeDef DW_SetDelayedTime(DW_Time_t dx_time);
+HAL_StatusTypeDef DW_ReadSysTime(DW_Time_t* sys_time);
 HAL_StatusTypeDef DW_SendFrame(uint8_t* frame_data, uint16_t length);
+uint8_t* DW_FrameBegin(DW_FrameBuilder_t* fb);
+uint8_t* DW_FrameReserve(DW_FrameBuilder_t* fb, uint16_t n);
+HAL_StatusTypeDef DW_FrameWriteMacHeader(DW_FrameBuilder_t* fb, uint16_t frame_ctrl,
+                                         uint8_t seq, uint16_t pan_id,
+                                         uint16_t dst_addr, uint16_t src_addr);
+HAL_StatusTypeDef DW_FrameSend(DW_FrameBuilder_t* fb);
+HAL_StatusTypeDef DW_FrameUpload(DW_FrameBuilder_t* fb, uint16_t tx_offset);
+HAL_StatusTypeDef DW_FrameStart(uint16_t length, uint16_t tx_offset);
+DW_TxHandle_t DW_GetLastTxHandle(void);
+HAL_StatusTypeDef DW_WaitTxDone(uint32_t timeout_ms);
+void DW_SetTxTimestamping(bool enable);
+void DW_ProcessEvents(void);
+bool DW_GetEvent(DW_Event_t* evt);
+void DW_SetEventCallback(DW_EventCallback_t cb);
+uint32_t DW_GetEventDrops(void);
+HAL_StatusTypeDef DW_RxEnable(void);
+HAL_StatusTypeDef DW_RxEnableDelayed(DW_Time_t rx_time);
+HAL_StatusTypeDef DW_RxDisable(void);
+HAL_StatusTypeDef DW_RxSetTimeouts(uint32_t frame_wait_us, uint32_t preamble_us);
+HAL_StatusTypeDef DW_RxListenWindow(uint32_t window_us, uint16_t frame_len);
+HAL_StatusTypeDef DW_RxReadInfo(DW_RxFrameInfo_t* info);
+HAL_StatusTypeDef DW_RxReadFrame(uint8_t* buf, uint16_t size, DW_RxFrameInfo_t* info);
+HAL_StatusTypeDef DW_RxReadTimestamp(DW_Time_t* rx_time);
+HAL_StatusTypeDef DW_RxReadClockOffset(int32_t* ppb);
+HAL_StatusTypeDef DW_RxReadQuality(DW_RxQuality_t* quality);
+void DW_RxSetQualityCapture(bool enable);
+DW_RxStatus_t DW_RxClassifyStatus(uint32_t status);
+HAL_StatusTypeDef DW_RxSetDoubleBuffer(bool enable);
+HAL_StatusTypeDef DW_RxSyncBufferPointers(void);
+HAL_StatusTypeDef DW_RxSetClassifier(DW_RxClassifier_t classifier, uint8_t header_len);
+HAL_StatusTypeDef DW_RxSetContinuous(bool enable);
+void DW_RxGetCounters(DW_RxCounters_t* counters);
+void DW_RxResetCounters(void);
+void DW_RxGetStats(DW_RxStats_t* stats);
+void DW_RxResetStats(void);
+HAL_StatusTypeDef DW_MacParseHeader(const uint8_t* data, uint16_t length, DW_MacHeader_t* hdr);
+HAL_StatusTypeDef DW_SetFrameFilter(const DW_FilterConfig_t* cfg);
+HAL_StatusTypeDef DW_DisableFrameFilter(void);
+void DW_SetSoftwareFilter(const DW_SwFilter_t* filter);
+void DW_GetFilterStats(DW_FilterStats_t* stats);
+void DW_ResetFilterStats(void);
+
+/* Cycle counter (DWT) used for on-target benchmarks */
+static inline void DW_CycleCounterInit(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline uint32_t DW_Cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
+/* Host link packets end in a Fletcher-16 checksum, little endian, so the
+ * host can find them again among printf text on the same link */
+#define DW_LINK_CHECKSUM_LEN   2
+
+static inline uint16_t DW_LinkChecksum(const uint8_t* data, uint16_t length)
+{
+    uint16_t sum1 = 0;
+    uint16_t sum2 = 0;
+
+    for (uint16_t i = 0; i < length; i++) {
+        sum1 = (sum1 + data[i]) % 255;
+        sum2 = (sum2 + sum1) % 255;
+    }
+    return (uint16_t)((sum2 << 8) | sum1);
+}
 
 
 #endif /* INC_DWM1000_H_ */
@@ -0,0 +1,83 @@
+/*
+ * DW_AntCal.h
+ *
+ *  Created on: Jul 18, 2025
+ *      Author: 36dhe
+ */
+
+#ifndef INC_DW_ANTCAL_H_
+#define INC_DW_ANTCAL_H_
+
+#include "DW_Ranging.h"
+
+/* Antenna Delay Calibration
+ * Every range carries the TX and RX antenna delays of both nodes that the
+ * programmed TX_ANTD and LDE_RXANTD do not cancel. With D = TX + RX delay
+ * of a node still unaccounted for, a pair measures
+ *   tof_ij = true_ij + (D_i + D_j) / 2
+ * Three nodes at surveyed distances give three such equations, so each
+ * node solves its own correction
+ *   D_i = e_ij + e_ik - e_jk,   e = measured - true ToF
+ * The nodes take turns: node 0 ranges DW_ANTCAL_RANGES times (SS-TWR) to
+ * each peer, broadcasts its mean times of flight in a report and thereby
+ * hands over to node 1, then node 2. Each pair is measured in both
+ * directions and averaged, which cancels the SS-TWR clock offset residue.
+ * Ranges are bias corrected (DW_RangeBias) so the delays do not absorb
+ * the level-dependent bias at the calibration distances.
+ * The correction is split evenly between TX and RX; the result is written
+ * to the last flash page and applied at boot by DW_AntCalLoad(). */
+#define DW_ANTCAL_NODES          3
+#ifndef DW_ANTCAL_RANGES
+#define DW_ANTCAL_RANGES         100   // Ranges per peer
+#endif
+#define DW_ANTCAL_ATTEMPTS       3     // Exchanges allowed per wanted range
+#define DW_ANTCAL_DEFAULT_ANTD   16436 // TX and RX each, uncalibrated
+#define DW_ANTCAL_MAX_CORR_TICKS 1280  // ~6 m of range, larger means bad survey
+#define DW_ANTCAL_TIMEOUT_MS     60000 // Without a report, once started
+#define DW_ANTCAL_HANDOVER_MS    20    // Next node starts this long after a report
+#define DW_ANTCAL_REPORT_REPEAT  3
+#define DW_ANTCAL_FC_REPORT      0xAC  // Function code, first byte after the MAC header
+#define DW_ANTCAL_REPORT_LEN     (DW_MAC_HDR_SHORT_LEN + 2 + 2 * 4)
+
+/* Storage: last 1 KB page, kept out of the image by the linker script */
+#define DW_ANTCAL_FLASH_ADDR     0x0800FC00
+#define DW_ANTCAL_MAGIC          0xA17D
+
+typedef enum {
+    DW_ANTCAL_IDLE,
+    DW_ANTCAL_WAIT,             // Responding until it is our turn
+    DW_ANTCAL_MEASURE,          // Ranging to the peers
+    DW_ANTCAL_DONE,             // Applied and saved
+    DW_ANTCAL_FAILED
+} DW_AntCalState_t;
+
+typedef struct {
+    uint8_t node;               // 0, 1 or 2; node 0 calls DW_AntCalStart()
+    uint16_t pan_id;
+    uint16_t addr[DW_ANTCAL_NODES];
+    uint32_t dist_mm[DW_ANTCAL_NODES];  // Pairs 0-1, 0-2, 1-2
+    uint16_t ranges;            // Per peer, 0 for DW_ANTCAL_RANGES
+    uint32_t reply_delay_us;    // 0 for DW_RNG_REPLY_DELAY_US, same on all nodes
+} DW_AntCalConfig_t;
+
+typedef struct {
+    DW_AntCalState_t state;
+    uint16_t tx_antd;           // Programmed now
+    uint16_t rx_antd;
+    int32_t correction_ticks;   // Added to TX_ANTD + RX_ANTD
+    int32_t pair_error_mm[DW_ANTCAL_NODES];  // Before calibration, pairs as dist_mm
+    int32_t pair_asym_mm[DW_ANTCAL_NODES];   // Between the two directions
+    uint32_t ranges;            // Our own, all peers
+    uint32_t failed;            // Our exchanges without a range
+} DW_AntCalResult_t;
+
+/* Function Prototypes */
+HAL_StatusTypeDef DW_AntCalInit(const DW_AntCalConfig_t* cfg);
+HAL_StatusTypeDef DW_AntCalStart(void);
+HAL_StatusTypeDef DW_AntCalRun(void);
+void DW_AntCalGetResult(DW_AntCalResult_t* result);
+void DW_AntCalPrintResult(void);
+bool DW_AntCalLoad(void);
+HAL_StatusTypeDef DW_AntCalSave(uint16_t tx_antd, uint16_t rx_antd);
+
+#endif /* INC_DW_ANTCAL_H_ */
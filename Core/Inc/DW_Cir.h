@@ -0,0 +1,58 @@
+/*
+ * DW_Cir.h
+ *
+ *  Created on: Jun 28, 2025
+ *      Author: 36dhe
+ */
+
+#ifndef INC_DW_CIR_H_
+#define INC_DW_CIR_H_
+
+#include "DWM1000.h"
+
+/* Channel Impulse Response Capture
+ * A window of accumulator (ACC_MEM) samples around the first path of the
+ * last received frame is read in chunks and each chunk is handed to the
+ * host link as it arrives, so only a small buffer is needed and normal
+ * reception resumes after a few milliseconds. */
+#define DW_CIR_SAMPLE_SIZE     4     // int16 real + int16 imaginary
+#define DW_CIR_SAMPLES_16M     992   // Accumulator length at 16 MHz PRF
+#define DW_CIR_SAMPLES_64M     1016  // Accumulator length at 64 MHz PRF
+#ifndef DW_CIR_CHUNK_SAMPLES
+#define DW_CIR_CHUNK_SAMPLES   32    // Samples per SPI read / host packet
+#endif
+
+#define DW_CIR_MAGIC           0xC1
+#define DW_CIR_FLAG_FIRST      0x01
+#define DW_CIR_FLAG_LAST       0x02
+#define DW_CIR_FLAG_ABORTED    0x04  // A new frame overwrote the accumulator
+
+/* Host packet header, followed by 'samples' complex samples and the
+ * DW_LinkChecksum() of both */
+typedef struct __attribute__((packed)) {
+    uint8_t magic;              // DW_CIR_MAGIC
+    uint8_t flags;
+    uint16_t capture_id;
+    uint16_t fp_index;          // First path index, 10.6 fixed point
+    uint16_t first_sample;      // Accumulator index of the first sample
+    uint16_t samples;
+} DW_CirChunkHdr_t;
+
+typedef struct {
+    uint16_t pre_samples;       // Samples before the first path
+    uint16_t samples;           // Window length
+} DW_CirConfig_t;
+
+typedef struct {
+    uint32_t captures;          // Windows streamed completely
+    uint32_t aborted;           // Windows cut short by a new frame
+    uint32_t link_errors;       // Chunks the host link did not accept
+    uint32_t last_cycles;       // CPU cycles of the last capture
+} DW_CirStats_t;
+
+/* Function Prototypes */
+HAL_StatusTypeDef DW_CirCapture(const DW_RxEvent_t* rx, const DW_CirConfig_t* cfg);
+void DW_CirGetStats(DW_CirStats_t* stats);
+HAL_StatusTypeDef DW_CirLinkWrite(const uint8_t* data, uint16_t length);
+
+#endif /* INC_DW_CIR_H_ */
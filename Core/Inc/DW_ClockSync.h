@@ -0,0 +1,79 @@
+/*
+ * DW_ClockSync.h
+ *
+ *  Created on: Jul 16, 2025
+ *      Author: 36dhe
+ */
+
+#ifndef INC_DW_CLOCKSYNC_H_
+#define INC_DW_CLOCKSYNC_H_
+
+#include "DWM1000.h"
+#include "DW_Timestamp.h"
+
+/* Wireless Clock Synchronisation (TDoA anchors)
+ * The master anchor broadcasts a sync frame every period as a delayed TX,
+ * so the frame carries its own TX timestamp. Every other anchor pairs the
+ * RX time of a sync with the master TX time plus the flight time over the
+ * surveyed master distance, and tracks offset and drift of its SYS_TIME
+ * against the master's with an alpha-beta filter in fixed point:
+ *   offset  Q8 ticks, master - local at the last sync
+ *   drift   Q32 ticks per tick, master rate - local rate
+ * The drift starts from the RX clock offset of the first sync and from the
+ * two-point slope of the second. Syncs further than DW_CSYNC_GATE_TICKS
+ * from the prediction are rejected once locked; DW_CSYNC_REJECT_LIMIT in a
+ * row, or no sync for DW_CSYNC_HOLDOVER_MS, restart the filter.
+ * Wired anchors send and track nothing: one SYNC pulse resets every
+ * SYS_TIME to a common epoch and local time is master time from then on. */
+#define DW_CSYNC_FC            0x2C  // Function code, first byte after the MAC header
+#define DW_CSYNC_LEN           (DW_MAC_HDR_SHORT_LEN + 1 + DW_TIME_BYTES)
+#define DW_CSYNC_PERIOD_MS     100   // Default master sync interval
+#define DW_CSYNC_TX_LEAD_US    500   // Sync read of SYS_TIME to TX
+#ifndef DW_CSYNC_ALPHA_SHIFT
+#define DW_CSYNC_ALPHA_SHIFT   1     // Offset gain 1/2
+#endif
+#ifndef DW_CSYNC_BETA_SHIFT
+#define DW_CSYNC_BETA_SHIFT    2     // Drift gain 1/4, follows crystal wander
+#endif
+#define DW_CSYNC_LOCK_SYNCS    4     // Syncs inside the gate before converting
+#define DW_CSYNC_GATE_TICKS    640   // ~10 ns from the prediction
+#define DW_CSYNC_REJECT_LIMIT  3
+#define DW_CSYNC_HOLDOVER_MS   2000  // Conversions stop this long after the last sync
+
+typedef enum {
+    DW_CSYNC_ROLE_MASTER,
+    DW_CSYNC_ROLE_SLAVE,
+    DW_CSYNC_ROLE_WIRED         // SYNC pulse and shared reference, see DW_ExtSync
+} DW_ClockSyncRole_t;
+
+typedef struct {
+    DW_ClockSyncRole_t role;
+    uint16_t pan_id;
+    uint16_t short_addr;
+    uint16_t master_addr;       // Slave: syncs from other anchors are ignored
+    uint32_t master_dist_mm;    // Slave: surveyed distance to the master
+    uint32_t period_ms;         // Master: 0 for DW_CSYNC_PERIOD_MS
+} DW_ClockSyncConfig_t;
+
+typedef struct {
+    bool locked;                // Local times convert to master time
+    int64_t offset_ticks;       // Master - local at the last sync
+    int32_t drift_ppb;          // Master clock rate relative to ours
+    int32_t last_error_ticks;   // Last sync against the prediction
+    uint32_t rms_error_ticks;   // Since the last lock
+    uint32_t syncs;             // Master: sent / slave: accepted
+    uint32_t rejected;          // Outside the gate
+    uint32_t restarts;          // Filter restarted after rejects or holdover
+    uint32_t errors;
+} DW_ClockSyncStats_t;
+
+/* Function Prototypes */
+HAL_StatusTypeDef DW_ClockSyncInit(const DW_ClockSyncConfig_t* cfg);
+HAL_StatusTypeDef DW_ClockSyncRun(void);
+bool DW_ClockSyncHandleEvent(const DW_Event_t* evt);
+bool DW_ClockSyncClassify(const uint8_t* header, uint8_t length);
+bool DW_ClockSyncToMaster(DW_Time_t local, DW_Time_t* master);
+void DW_ClockSyncGetStats(DW_ClockSyncStats_t* stats);
+void DW_ClockSyncPrintStats(void);
+
+#endif /* INC_DW_CLOCKSYNC_H_ */
@@ -0,0 +1,49 @@
+/*
+ * DW_Diag.h
+ *
+ *  Created on: Jul 2, 2025
+ *      Author: 36dhe
+ */
+
+#ifndef INC_DW_DIAG_H_
+#define INC_DW_DIAG_H_
+
+#include "DWM1000.h"
+
+/* Receive Diagnostics
+ * Raw quality values of the last received frame and the estimated RX and
+ * first path levels (DW1000 User Manual 4.7). Levels are computed in
+ * integer math with a log2 lookup table; no floating point is used. */
+#define DW_DIAG_LEVEL_INVALID  INT16_MIN
+#define DW_DIAG_A_16M          11377  // Constant A in centi-dB, 16 MHz PRF
+#define DW_DIAG_A_64M          12174  // Constant A in centi-dB, 64 MHz PRF
+
+typedef struct {
+    uint16_t fp_index;          // First path index, 10.6 fixed point
+    uint16_t fp_ampl1;          // First path amplitude points 1-3
+    uint16_t fp_ampl2;
+    uint16_t fp_ampl3;
+    uint16_t std_noise;         // Standard deviation of the noise
+    uint16_t cir_power;         // Channel impulse response power
+    uint16_t preamble_count;    // RXPACC, corrected for the SFD
+    int16_t rx_level;           // Estimated RX level, centi-dBm
+    int16_t fp_level;           // Estimated first path level, centi-dBm
+} DW_RxDiag_t;
+
+/* Diagnostics Benchmark, CPU cycles per frame */
+typedef struct {
+    uint32_t read_cycles;       // SPI reads of RX_FQUAL, RX_TIME, RX_FINFO
+    uint32_t fixed_cycles;      // DW_DiagCompute
+    uint32_t float_cycles;      // Same computation with soft-float log10f
+    int16_t max_error;          // Largest fixed vs float difference, centi-dB
+} DW_DiagBench_t;
+
+/* Function Prototypes */
+HAL_StatusTypeDef DW_DiagRead(DW_RxDiag_t* diag);
+void DW_DiagFromQuality(const DW_RxQuality_t* q, uint16_t rxpacc, bool sfd_corr, DW_RxDiag_t* diag);
+void DW_DiagCompute(DW_RxDiag_t* diag);
+int32_t DW_DiagLog2Q16(uint64_t x);
+HAL_StatusTypeDef DW_DiagBenchmark(uint32_t iterations, DW_DiagBench_t* bench);
+void DW_DiagPrint(const DW_RxDiag_t* diag);
+
+#endif /* INC_DW_DIAG_H_ */
@@ -0,0 +1,43 @@
+/*
+ * DW_ExtSync.h
+ *
+ *  Created on: Jul 17, 2025
+ *      Author: 36dhe
+ */
+
+#ifndef INC_DW_EXTSYNC_H_
+#define INC_DW_EXTSYNC_H_
+
+#include "DWM1000.h"
+#include "DW_Timestamp.h"
+
+/* Wired Synchronisation (EXT_SYNC)
+ * In fixed installations one pulse line drives the SYNC pin of every
+ * anchor, and the anchors run from one distributed 38.4 MHz reference so
+ * the pulse is sampled on the same clock edge everywhere. Two one-shot
+ * modes act on the next SYNC edge, WAIT reference cycles later:
+ *  Timebase reset (OSTRM): SYS_TIME restarts from zero. All anchors then
+ *    share one SYS_TIME epoch and, on a common reference, stay aligned
+ *    without any sync traffic.
+ *  RX on sync (OSRSM): the receiver turns on, and for the next frame
+ *    EC_RXTC counts reference cycles from the SYNC edge to the first path,
+ *    refined by EC_GOLP in 1 ns steps.
+ * WAIT must be the same on all anchors. The SYNC pin must keep its reset
+ * function (GPIO_MODE MSGP7 = 0). */
+#define DW_EXTSYNC_WAIT_DEFAULT    33    // Reference cycles from SYNC to action
+#define DW_EXTSYNC_TICKS_PER_CYCLE 1664  // 63.8976 GHz / 38.4 MHz
+#define DW_EXTSYNC_JUMP_MS         5     // SYS_TIME this far off its course is a reset
+
+typedef enum {
+    DW_EXTSYNC_OFF,
+    DW_EXTSYNC_TIMEBASE_RESET,  // OSTRM
+    DW_EXTSYNC_RX_ON_SYNC       // OSRSM
+} DW_ExtSyncMode_t;
+
+/* Function Prototypes */
+HAL_StatusTypeDef DW_ExtSyncArm(DW_ExtSyncMode_t mode, uint8_t wait);
+HAL_StatusTypeDef DW_ExtSyncDisarm(void);
+HAL_StatusTypeDef DW_ExtSyncPoll(bool* done);
+HAL_StatusTypeDef DW_ExtSyncReadRx(DW_Time_t* since_sync);
+
+#endif /* INC_DW_EXTSYNC_H_ */
@@ -0,0 +1,59 @@
+/*
+ * DW_FramePool.h
+ *
+ *  Created on: Jun 21, 2025
+ *      Author: 36dhe
+ */
+
+#ifndef INC_DW_FRAMEPOOL_H_
+#define INC_DW_FRAMEPOOL_H_
+
+#include <stdint.h>
+#include "main.h"
+#include "stdbool.h"
+
+/* Block classes, smallest first. A request is served from the smallest
+ * class that fits; when that class is empty the next larger one is used. */
+#ifndef DW_POOL_SHORT_SIZE
+#define DW_POOL_SHORT_SIZE     32    // Ranging/control frames
+#endif
+#ifndef DW_POOL_SHORT_COUNT
+#define DW_POOL_SHORT_COUNT    8
+#endif
+#ifndef DW_POOL_LONG_SIZE
+#define DW_POOL_LONG_SIZE      128   // Data frames up to the standard PHR limit
+#endif
+#ifndef DW_POOL_LONG_COUNT
+#define DW_POOL_LONG_COUNT     6
+#endif
+
+#define DW_POOL_CLASSES        2
+
+/* Frame Buffer
+ * Header in front of the payload. 'next' links free blocks inside the pool
+ * and may be used by the owner to queue frames while allocated. */
+typedef struct DW_FrameBuf {
+    struct DW_FrameBuf* next;
+    uint16_t capacity;          // Payload bytes available
+    uint16_t length;            // Payload bytes in use
+    uint8_t pool_class;         // Owning class, used by DW_PoolFree
+    uint8_t reserved[3];
+    uint8_t data[];
+} DW_FrameBuf_t;
+
+/* Pool Statistics */
+typedef struct {
+    uint16_t block_size[DW_POOL_CLASSES];
+    uint16_t free[DW_POOL_CLASSES];         // Blocks free now
+    uint16_t min_free[DW_POOL_CLASSES];     // Low-water mark
+    uint32_t exhausted[DW_POOL_CLASSES];    // Requests that found the class empty
+    uint32_t failures;                      // Requests nothing could serve
+} DW_PoolStats_t;
+
+/* Function Prototypes */
+void DW_PoolInit(void);
+DW_FrameBuf_t* DW_PoolAlloc(uint16_t length);
+void DW_PoolFree(DW_FrameBuf_t* buf);
+void DW_PoolGetStats(DW_PoolStats_t* stats);
+
+#endif /* INC_DW_FRAMEPOOL_H_ */
@@ -0,0 +1,84 @@
+/*
+ * DW_Group.h
+ *
+ *  Created on: Jul 14, 2025
+ *      Author: 36dhe
+ */
+
+#ifndef INC_DW_GROUP_H_
+#define INC_DW_GROUP_H_
+
+#include "DW_Ranging.h"
+
+/* Group Ranging
+ * One tag ranges with up to DW_GRP_MAX_ANCHORS anchors in N + 2 frames
+ * instead of 2N (SS-TWR) or 3N (DS-TWR):
+ *  1. The tag broadcasts a poll listing the anchors.
+ *  2. Anchor k answers at poll RX + reply delay + k slots with a delayed TX
+ *     that carries its poll RX and response TX times. The tag receives the
+ *     responses back to back with both RX buffers.
+ *  3. After the last slot the tag broadcasts one final with its poll TX,
+ *     final TX and the response RX time of every anchor.
+ * The tag computes an SS-TWR range per response, corrected with the clock
+ * offset from RX time tracking; each anchor computes a DS-TWR range from
+ * the final. All nodes need the same PHY configuration and reply delay, as
+ * the slot length follows from the response airtime. */
+#define DW_GRP_MAX_ANCHORS     8
+#define DW_GRP_SLOT_GUARD_US   200   // Between responses, for reading out the previous one
+#define DW_GRP_FINAL_DELAY_US  1000  // End of the last slot to the final
+#define DW_GRP_FINAL_SLACK_US  500   // Anchors accept a final this much later
+#define DW_GRP_ROUND_TIMEOUT_MS 20   // Round abandoned without any event
+
+/* Message function codes, first byte after the MAC header */
+#define DW_GRP_FC_POLL         0x62
+#define DW_GRP_FC_RESP         0x52
+#define DW_GRP_FC_FINAL        0x6A
+
+#define DW_GRP_POLL_LEN(n)     (DW_MAC_HDR_SHORT_LEN + 2 + 2 * (n))
+#define DW_GRP_RESP_LEN        (DW_MAC_HDR_SHORT_LEN + 1 + 2 * DW_TIME_BYTES)
+#define DW_GRP_FINAL_LEN(n)    (DW_MAC_HDR_SHORT_LEN + 2 + (2 + (n)) * DW_TIME_BYTES)
+
+typedef struct {
+    DW_RangingRole_t role;      // Initiator: tag, responder: anchor
+    uint16_t pan_id;
+    uint16_t short_addr;
+    uint32_t reply_delay_us;    // 0 for DW_RNG_REPLY_DELAY_US, same on all nodes
+    uint8_t n_anchors;          // Tag: anchors in each round, in slot order
+    uint16_t anchors[DW_GRP_MAX_ANCHORS];
+    bool bias_correction;       // Correct ranges by RX level (DW_RangeBias)
+} DW_GroupConfig_t;
+
+typedef struct {
+    uint32_t rounds;            // Tag: polls sent
+    uint32_t responses;         // Tag: responses received / anchor: sent
+    uint32_t missed;            // Tag: anchors not heard in their slot
+    uint32_t finals;            // Tag: finals sent
+    uint32_t ranges;            // Tag: SS-TWR / anchor: DS-TWR ranges computed
+    uint32_t timeouts;          // Anchor: final not received
+    uint32_t errors;
+    uint32_t late;              // Delayed TX time already passed
+} DW_GroupStats_t;
+
+/* Group Ranging Benchmark, back-to-back rounds */
+typedef struct {
+    uint32_t rounds;
+    uint32_t ranges;            // Tag-side SS-TWR ranges
+    uint32_t total_cycles;
+    uint32_t rounds_per_s;
+    uint32_t round_us;          // Poll TX to final sent
+    uint32_t airtime_us;        // Group round: poll, N responses, final
+    uint32_t airtime_ss_us;     // Same anchors with SS-TWR: N polls and responses
+    uint32_t airtime_ds_us;     // Same anchors with DS-TWR: N polls, responses and finals
+} DW_GroupBench_t;
+
+/* Function Prototypes */
+HAL_StatusTypeDef DW_GroupInit(const DW_GroupConfig_t* cfg);
+HAL_StatusTypeDef DW_GroupStart(void);
+HAL_StatusTypeDef DW_GroupRun(void);
+bool DW_GroupBusy(void);
+uint8_t DW_GroupHandleEvent(const DW_Event_t* evt, DW_RangeResult_t* results);
+void DW_GroupGetStats(DW_GroupStats_t* stats);
+HAL_StatusTypeDef DW_GroupBenchmark(uint32_t n_rounds, DW_GroupBench_t* bench);
+void DW_GroupPrintBench(const DW_GroupBench_t* bench);
+
+#endif /* INC_DW_GROUP_H_ */
@@ -0,0 +1,43 @@
+/*
+ * DW_RangeBias.h
+ *
+ *  Created on: Jul 19, 2025
+ *      Author: 36dhe
+ */
+
+#ifndef INC_DW_RANGEBIAS_H_
+#define INC_DW_RANGEBIAS_H_
+
+#include "DW_Diag.h"
+
+/* Range Bias Correction
+ * The leading edge is found relative to the noise floor, so a strong
+ * signal reads short and a weak one long, by up to a few decimetres. The
+ * curve differs between the narrow band channels (1, 2, 3, 5), the wide
+ * band channels (4, 7) and the two PRFs (APS011). It is tabulated here
+ * against the estimated RX level, one point every DW_RBIAS_STEP_CDBM, and
+ * linearly interpolated in integer math; the bias is taken off the time of
+ * flight before the range is reported. The RX level estimate compresses
+ * above about -85 dBm, which the tables include since they are indexed by
+ * the estimate. The built-in tables follow the published curves; measured
+ * ones go in with DW_RangeBiasSetTable(). Antenna delays should be
+ * calibrated with the correction on (DW_AntCal does so). */
+#define DW_RBIAS_POINTS        9
+#define DW_RBIAS_LEVEL_MIN     (-9500)  // First point, centi-dBm
+#define DW_RBIAS_STEP_CDBM     400      // Between points, 4 dB
+
+typedef enum {
+    DW_RBIAS_NB_16M,            // Channels 1, 2, 3, 5
+    DW_RBIAS_NB_64M,
+    DW_RBIAS_WB_16M,            // Channels 4, 7
+    DW_RBIAS_WB_64M,
+    DW_RBIAS_TABLES
+} DW_RangeBiasTable_t;
+
+/* Function Prototypes */
+int16_t DW_RangeBiasRxLevel(const DW_RxEvent_t* rx);
+int32_t DW_RangeBiasMm(int16_t rx_level);
+int64_t DW_RangeBiasCorrect(const DW_RxEvent_t* rx, int64_t tof, int16_t* rx_level);
+HAL_StatusTypeDef DW_RangeBiasSetTable(DW_RangeBiasTable_t table, const int16_t* bias_mm);
+
+#endif /* INC_DW_RANGEBIAS_H_ */
@@ -0,0 +1,70 @@
+/*
+ * DW_RangeFilter.h
+ *
+ *  Created on: Jul 20, 2025
+ *      Author: 36dhe
+ */
+
+#ifndef INC_DW_RANGEFILTER_H_
+#define INC_DW_RANGEFILTER_H_
+
+#include "DW_Ranging.h"
+
+/* Per-Peer Range Filter
+ * A two-state Kalman filter (range, range rate) per peer, constant
+ * velocity with white acceleration noise, in 64-bit fixed point:
+ *   range, rate     Q8 mm, Q8 mm/s
+ *   covariance      Q8 mm^2, mm^2/s, mm^2/s^2
+ * A range whose innovation lies outside DW_RFILT_GATE_SIGMA standard
+ * deviations of the predicted innovation is rejected; DW_RFILT_REJECT_LIMIT
+ * rejects in a row mean the peer really moved and restart its filter.
+ * Peers live in a static table, the longest silent one gives way to a new
+ * peer. Estimates are due once per report_ms and peer, so the host gets
+ * filtered ranges with their variance at a bounded rate. */
+#ifndef DW_RFILT_MAX_PEERS
+#define DW_RFILT_MAX_PEERS     16
+#endif
+#define DW_RFILT_MEAS_STD_MM   50    // Default range noise
+#define DW_RFILT_ACCEL_MM_S2   2000  // Default acceleration noise, walking pace
+#define DW_RFILT_ACCEL_MAX     20000 // Keeps the covariance products within 63 bits
+#define DW_RFILT_INIT_RATE     1000  // Rate uncertainty of a new peer, mm/s
+#define DW_RFILT_GATE_SIGMA    3
+#define DW_RFILT_REJECT_LIMIT  3
+#define DW_RFILT_MIN_UPDATES   3     // Accepted ranges before estimates are due
+#define DW_RFILT_MAX_GAP_MS    1000  // Longer silence restarts the peer
+#define DW_RFILT_REPORT_MS     100   // Default estimate interval per peer
+
+typedef struct {
+    uint16_t meas_std_mm;       // 0 for DW_RFILT_MEAS_STD_MM
+    uint16_t accel_mm_s2;       // 0 for DW_RFILT_ACCEL_MM_S2, at most DW_RFILT_ACCEL_MAX
+    uint8_t gate_sigma;         // 0 for DW_RFILT_GATE_SIGMA
+    uint16_t report_ms;         // 0 for DW_RFILT_REPORT_MS
+} DW_RangeFilterConfig_t;
+
+typedef struct {
+    uint16_t peer;
+    int32_t distance_mm;        // Filtered
+    int32_t rate_mm_s;          // Positive while the peer moves away
+    uint32_t variance_mm2;      // Of distance_mm
+    uint16_t ranges;            // Accepted since the last estimate
+    uint16_t rejected;          // Rejected since the last estimate
+} DW_RangeEstimate_t;
+
+typedef struct {
+    uint32_t ranges;            // Fed in
+    uint32_t rejected;          // Outside the gate
+    uint32_t restarts;          // Reject limit or gap
+    uint32_t estimates;         // Reported
+    uint32_t evictions;         // Peers dropped for a new one
+    uint8_t peers;
+} DW_RangeFilterStats_t;
+
+/* Function Prototypes */
+void DW_RangeFilterInit(const DW_RangeFilterConfig_t* cfg);
+bool DW_RangeFilterUpdate(const DW_RangeResult_t* range, DW_RangeEstimate_t* est);
+bool DW_RangeFilterGet(uint16_t peer, DW_RangeEstimate_t* est);
+void DW_RangeFilterRemove(uint16_t peer);
+void DW_RangeFilterGetStats(DW_RangeFilterStats_t* stats);
+void DW_RangeFilterPrintEstimate(const DW_RangeEstimate_t* est);
+
+#endif /* INC_DW_RANGEFILTER_H_ */
@@ -0,0 +1,153 @@
+/*
+ * DW_Ranging.h
+ *
+ *  Created on: Jul 8, 2025
+ *      Author: 36dhe
+ */
+
+#ifndef INC_DW_RANGING_H_
+#define INC_DW_RANGING_H_
+
+#include "DWM1000.h"
+
+/* Two-Way Ranging
+ * Single-sided (SS-TWR): the initiator sends a poll; the responder answers
+ * at a fixed delay after the poll RX timestamp with a delayed TX and embeds
+ * both its poll RX and response TX timestamps. The initiator then has
+ *   T_round = resp_rx - poll_tx   (initiator clock)
+ *   T_reply = resp_tx - poll_rx   (responder clock)
+ *   ToF     = (T_round - T_reply * (1 - e)) / 2
+ * where e is the responder clock offset. It is taken from the receiver
+ * time tracking of the response itself (RX_TTCKO / RX_TTCKI), so a single
+ * exchange is enough; the estimate from the response timestamps of
+ * consecutive exchanges is the fallback.
+ *
+ * Double-sided (DS-TWR): the initiator answers the response with a final
+ * carrying poll TX, response RX and final TX, and the responder computes
+ *   ToF = (R1 * R2 - D1 * D2) / (R1 + R2 + D1 + D2)
+ * with R1/D2 the initiator round/reply and R2/D1 the responder round/reply
+ * times. The clock offset cancels to first order and the reply times need
+ * not be equal. */
+#ifndef DW_RNG_REPLY_DELAY_US
+#define DW_RNG_REPLY_DELAY_US      2000  // RX to reply TX, both sides
+#endif
+#define DW_RNG_REPLY_DELAY_MAX_US  30000 // Keeps the DS-TWR products within 63 bits
+#define DW_RNG_RX_MARGIN_US        100   // Receiver on this early before the response
+#define DW_RNG_TX_LEAD_US          150   // Timed polls closer than this are not sent
+#define DW_RNG_EXCHANGE_TIMEOUT_MS 10    // Exchange abandoned without any event
+#define DW_RNG_OFFSET_MAX_PPB      100000 // Larger estimates are rejected (100 ppm)
+#define DW_RNG_OFFSET_MAX_AGE_MS   1000  // Longer gaps restart the offset estimate
+#define DW_RNG_OFFSET_SHIFT        2     // Offset smoothing, weight 1/4 per exchange
+
+/* Message function codes, first byte after the MAC header */
+#define DW_RNG_FC_POLL             0x61
+#define DW_RNG_FC_RESP             0x50
+#define DW_RNG_FC_FINAL            0x69
+
+#define DW_RNG_POLL_LEN            (DW_MAC_HDR_SHORT_LEN + 1)
+#define DW_RNG_RESP_LEN            (DW_MAC_HDR_SHORT_LEN + 1 + 2 * DW_TIME_BYTES)
+#define DW_RNG_FINAL_LEN           (DW_MAC_HDR_SHORT_LEN + 1 + 3 * DW_TIME_BYTES)
+
+typedef enum {
+    DW_RNG_ROLE_INITIATOR,
+    DW_RNG_ROLE_RESPONDER
+} DW_RangingRole_t;
+
+typedef enum {
+    DW_RNG_SS_TWR,
+    DW_RNG_DS_TWR
+} DW_RangingMethod_t;
+
+typedef struct {
+    DW_RangingRole_t role;
+    DW_RangingMethod_t method;  // Same on both sides
+    uint16_t pan_id;
+    uint16_t short_addr;
+    uint16_t peer_addr;         // Initiator: responder for DW_RangingStart()
+    uint32_t reply_delay_us;    // 0 for DW_RNG_REPLY_DELAY_US, same on both sides
+    bool bias_correction;       // Correct ranges by RX level (DW_RangeBias)
+} DW_RangingConfig_t;
+
+typedef struct {
+    uint16_t peer;
+    uint8_t seq;
+    int32_t tof_ticks;          // Time of flight, DW1000 ticks (15.65 ps)
+    int32_t distance_mm;
+    int32_t clock_offset_ppb;   // Peer clock relative to ours
+    bool offset_valid;          // SS-TWR: false without RX tracking until two responses were seen
+    int16_t rx_level;           // Centi-dBm, INT16_MIN without bias correction
+} DW_RangeResult_t;
+
+typedef struct {
+    uint32_t polls;             // Initiator: polls sent
+    uint32_t ranges;            // SS-TWR initiator / DS-TWR responder: ranges computed
+    uint32_t finals;            // DS-TWR initiator: finals sent
+    uint32_t timeouts;          // No response (initiator) or final (responder) in time
+    uint32_t errors;            // Failed TX, RX errors, unexpected frames
+    uint32_t responses;         // Responder: responses sent
+    uint32_t late;              // Reply delay too short (HPDWARN) or timed poll too close
+} DW_RangingStats_t;
+
+/* Ranging Benchmark, back-to-back exchanges */
+typedef struct {
+    uint32_t exchanges;
+    uint32_t ranges;            // Completed exchanges (DS-TWR: finals sent)
+    uint32_t total_cycles;      // CPU cycles for the whole run
+    uint32_t airtime_us;        // All frames of one exchange on air
+    uint32_t ranges_per_s;      // Sustained update rate with one responder
+    int32_t mean_mm;            // SS-TWR: mean distance of the successful ranges
+    int32_t min_mm;
+    int32_t max_mm;
+} DW_RangingBench_t;
+
+/* Ranging Simulation
+ * Runs the SS-TWR and DS-TWR computations on timestamps generated from a
+ * clock drift model, so the methods can be compared without hardware. */
+typedef struct {
+    int32_t distance_mm;
+    int32_t offset_ppb;         // Responder crystal relative to the initiator
+    int32_t drift_ppb_s;        // Change of that offset per second (warm-up)
+    uint32_t reply1_us;         // Responder reply delay
+    uint32_t reply2_us;         // Initiator reply delay (DS-TWR final)
+    uint32_t jitter_us;         // Extra turnaround per reply, uniform 0..jitter_us
+    uint16_t noise_ticks;       // Timestamp noise, uniform +-noise_ticks
+    uint16_t rx_offset_noise_ppb;   // RX time tracking estimate noise, uniform +-
+    uint32_t period_us;         // Time between exchanges
+    uint32_t iterations;
+} DW_RangingSimModel_t;
+
+typedef struct {
+    int32_t mean_mm;            // Mean error (bias)
+    int32_t std_mm;             // Standard deviation of the error
+    int32_t max_abs_mm;         // Largest absolute error
+} DW_RangingSimError_t;
+
+typedef struct {
+    DW_RangingSimError_t ss_raw;    // SS-TWR without offset correction
+    DW_RangingSimError_t ss;        // SS-TWR with the consecutive-response offset estimate
+    DW_RangingSimError_t ss_rx;     // SS-TWR with the per-frame RX time tracking offset
+    DW_RangingSimError_t ds;        // DS-TWR, asymmetric formula
+    uint32_t ss_ranges_per_s;       // From airtime and reply delays
+    uint32_t ds_ranges_per_s;
+    uint32_t ss_cycles;             // CPU cycles per range computation
+    uint32_t ds_cycles;
+} DW_RangingSim_t;
+
+/* Function Prototypes */
+HAL_StatusTypeDef DW_RangingInit(const DW_RangingConfig_t* cfg);
+HAL_StatusTypeDef DW_RangingStart(void);
+HAL_StatusTypeDef DW_RangingStartAt(uint16_t peer, DW_Time_t tx_time);
+bool DW_RangingBusy(void);
+bool DW_RangingHandleEvent(const DW_Event_t* evt, DW_RangeResult_t* result);
+void DW_RangingGetStats(DW_RangingStats_t* stats);
+HAL_StatusTypeDef DW_RangingBenchmark(uint32_t n_exchanges, DW_RangingBench_t* bench);
+void DW_RangingPrintBench(const DW_RangingBench_t* bench);
+HAL_StatusTypeDef DW_RangingSimulate(const DW_RangingSimModel_t* model, DW_RangingSim_t* sim);
+void DW_RangingPrintSim(const DW_RangingSimModel_t* model, const DW_RangingSim_t* sim);
+int64_t DW_RangingSsTof(int64_t t_round, int64_t t_reply, int32_t offset_ppb);
+int64_t DW_RangingDsTof(int64_t round1, int64_t reply1, int64_t round2, int64_t reply2);
+const uint8_t* DW_RangingParseMsg(const DW_RxEvent_t* rx, uint16_t pan_id, uint16_t short_addr,
+                                  uint8_t fcode, uint16_t min_len, DW_MacHeader_t* hdr);
+void DW_RangingRxRestart(bool* timeout_armed);
+
+#endif /* INC_DW_RANGING_H_ */
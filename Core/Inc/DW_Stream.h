@@ -0,0 +1,42 @@
+/*
+ * DW_Stream.h
+ *
+ *  Created on: Jun 14, 2025
+ *      Author: 36dhe
+ */
+
+#ifndef INC_DW_STREAM_H_
+#define INC_DW_STREAM_H_
+
+#include "DWM1000.h"
+
+/* The TX buffer is split in two halves: the next frame is uploaded into one
+ * half while the previous frame is still on air from the other. */
+#define DW_STREAM_HALF_OFFSET    512
+#define DW_STREAM_TX_TIMEOUT_MS  10
+
+/* 6.8 Mbit/s, 64 MHz PRF, 64-symbol preamble, extended PHR */
+extern const DW_PhyConfig_t DW_PHY_STREAM_6M8;
+
+/* Streaming Statistics */
+typedef struct {
+    uint32_t frames;           // Frames transmitted
+    uint32_t payload_bytes;    // Application payload bytes transmitted
+    uint32_t tx_errors;        // Frames not sent: upload, start or TX wait failed
+    uint32_t total_cycles;     // CPU cycles for the whole run
+    uint32_t spi_cycles;       // Cycles spent clocking frames and TX_FCTRL over SPI
+    uint32_t wait_cycles;      // Cycles spent waiting for the previous frame
+    uint32_t airtime_us;       // On-air time of one frame
+    uint32_t bytes_per_s;      // Sustained payload throughput
+    uint32_t frames_per_s;     // Sustained frame rate
+} DW_StreamStats_t;
+
+/* Function Prototypes */
+HAL_StatusTypeDef DW_StreamBegin(void);
+HAL_StatusTypeDef DW_StreamSend(DW_FrameBuilder_t* fb);
+HAL_StatusTypeDef DW_StreamFlush(void);
+HAL_StatusTypeDef DW_StreamEnd(void);
+HAL_StatusTypeDef DW_StreamBenchmark(uint16_t payload_len, uint32_t n_frames, DW_StreamStats_t* stats);
+void DW_StreamPrintStats(const DW_StreamStats_t* stats);
+
+#endif /* INC_DW_STREAM_H_ */
@@ -0,0 +1,72 @@
+/*
+ * DW_Tdma.h
+ *
+ *  Created on: Jul 12, 2025
+ *      Author: 36dhe
+ */
+
+#ifndef INC_DW_TDMA_H_
+#define INC_DW_TDMA_H_
+
+#include "DW_Ranging.h"
+
+/* TDMA Ranging Scheduler (anchor)
+ * The anchor is the SS-TWR initiator and polls its tags in a superframe of
+ * back-to-back slots, one per tag that owns a slot. The poll of slot k is a
+ * delayed TX at T0 + k * slot length on the DW1000 clock, so slots neither
+ * drift with host latency nor overlap. A tag that misses
+ * DW_TDMA_MISS_LIMIT polls in a row gives its slot back and the superframe
+ * shrinks; such tags share one probe slot at the end of the superframe,
+ * polled in turn, and own a slot again after their first response. Tags
+ * run the ranging responder with their own short address. */
+#define DW_TDMA_MAX_TAGS       32
+#define DW_TDMA_ADDR_NONE      0xFFFF  // Free table entry
+#define DW_TDMA_MISS_LIMIT     3       // Consecutive misses before a slot is reclaimed
+#define DW_TDMA_GUARD_US       100     // Idle air between a response and the next poll
+#define DW_TDMA_HOST_US        400     // Event handling and loading of the next poll
+#define DW_TDMA_RESYNC_MS      1000    // Longer pauses restart the superframe timebase
+
+typedef struct {
+    uint16_t pan_id;
+    uint16_t short_addr;
+    uint32_t reply_delay_us;    // 0 for DW_RNG_REPLY_DELAY_US, same on the tags
+    uint32_t superframe_min_us; // Lower bound on the superframe, 0 for back-to-back slots
+    bool bias_correction;       // Correct ranges by RX level (DW_RangeBias)
+} DW_TdmaConfig_t;
+
+typedef struct {
+    uint16_t addr;              // DW_TDMA_ADDR_NONE if the entry is free
+    bool active;                // Owns a slot, otherwise probed
+    uint8_t misses;             // Consecutive polls without a range
+    uint32_t polls;
+    uint32_t ranges;
+    int32_t last_mm;            // Last distance
+    uint32_t rate_mhz;          // Achieved update rate, mHz (DW_TdmaGetTag)
+} DW_TdmaTag_t;
+
+typedef struct {
+    uint32_t superframes;
+    uint32_t polls;             // Slots with a poll on air
+    uint32_t ranges;
+    uint32_t misses;            // Polls without a range
+    uint32_t resyncs;           // Superframe moved because a poll time had passed
+    uint32_t reclaimed;         // Slots taken from silent tags
+    uint32_t restored;          // Slots given back after a probe response
+    uint32_t slot_us;           // Slot length
+    uint32_t superframe_us;     // Length of the current superframe
+    uint32_t elapsed_ms;        // Since DW_TdmaResetStats()
+    uint32_t ranges_per_s;      // All tags together
+} DW_TdmaStats_t;
+
+/* Function Prototypes */
+HAL_StatusTypeDef DW_TdmaInit(const DW_TdmaConfig_t* cfg);
+HAL_StatusTypeDef DW_TdmaAddTag(uint16_t addr);
+HAL_StatusTypeDef DW_TdmaRemoveTag(uint16_t addr);
+HAL_StatusTypeDef DW_TdmaRun(void);
+bool DW_TdmaHandleEvent(const DW_Event_t* evt, DW_RangeResult_t* result);
+HAL_StatusTypeDef DW_TdmaGetTag(uint8_t index, DW_TdmaTag_t* tag);
+void DW_TdmaGetStats(DW_TdmaStats_t* stats);
+void DW_TdmaResetStats(void);
+void DW_TdmaPrintStats(void);
+
+#endif /* INC_DW_TDMA_H_ */
@@ -0,0 +1,87 @@
+/*
+ * DW_Tdoa.h
+ *
+ *  Created on: Jul 15, 2025
+ *      Author: 36dhe
+ */
+
+#ifndef INC_DW_TDOA_H_
+#define INC_DW_TDOA_H_
+
+#include "DW_Diag.h"
+#include "DW_ClockSync.h"
+
+/* TDoA Anchor
+ * Tags only transmit blinks; the anchor listens continuously and reports
+ * the 40-bit RX timestamp and receive quality of every blink to the host,
+ * which solves the time differences between anchors. The receiver never
+ * waits for the host: RXAUTR restarts it after errors and, with double
+ * buffering, the driver re-arms it before a frame is read. A header
+ * classifier drops everything but blinks and clock sync frames before the
+ * payload is read. Reports are collected into binary batches so the host link sees
+ * one packet per DW_TDOA_BATCH_MAX blinks or per DW_TDOA_FLUSH_MS.
+ * With DW_ClockSync running, the anchor also takes part in clock sync and
+ * reports timestamps already converted to master time. */
+#define DW_TDOA_BLINK_FC       0xC5  // Blink frame control (ISO/IEC 24730-62)
+#define DW_TDOA_BLINK_LEN      10    // FC, sequence number, 64-bit tag ID
+#ifndef DW_TDOA_BATCH_MAX
+#define DW_TDOA_BATCH_MAX      16    // Reports per host packet
+#endif
+#define DW_TDOA_FLUSH_MS       20    // Longest time a report waits for its batch
+#define DW_TDOA_MAGIC          0xB1
+
+#define DW_TDOA_FLAG_MASTER    0x01  // rx_time is in master time, else local
+
+/* Host packet header, followed by 'count' reports and the
+ * DW_LinkChecksum() of both */
+typedef struct __attribute__((packed)) {
+    uint8_t magic;              // DW_TDOA_MAGIC
+    uint8_t count;
+    uint16_t anchor;            // Anchor ID
+    uint16_t batch_seq;         // Gaps mean lost packets
+    uint16_t lost;              // Blinks lost by the anchor since the last batch
+} DW_TdoaBatchHdr_t;
+
+/* One blink, 21 bytes */
+typedef struct __attribute__((packed)) {
+    uint64_t tag_id;
+    uint8_t seq;
+    uint8_t flags;              // DW_TDOA_FLAG_*
+    uint8_t rx_time[DW_TIME_BYTES];  // RX_STAMP, little endian
+    uint16_t fp_index;          // First path index, 10.6 fixed point
+    int16_t rx_level;           // Centi-dBm
+    int16_t fp_level;           // Centi-dBm, well below rx_level without line of sight
+} DW_TdoaReport_t;
+
+typedef struct {
+    uint16_t anchor_id;
+    uint16_t flush_ms;          // 0 for DW_TDOA_FLUSH_MS
+    bool double_buffer;         // Keep listening while a blink is read out
+} DW_TdoaConfig_t;
+
+typedef struct {
+    uint32_t blinks;            // Reported
+    uint32_t local_time;        // Reported in local time, clock sync not locked
+    uint32_t no_stamp;          // Blinks without a valid leading edge, not reported
+    uint32_t lost;              // Overruns, full event queue or frame pool
+    uint32_t discarded;         // Other frames dropped by the classifier
+    uint32_t batches;
+    uint32_t link_errors;       // Batches the host link did not accept
+    uint32_t elapsed_ms;        // Since DW_TdoaResetStats()
+    uint32_t blinks_per_s;      // Measured
+    uint32_t cycles_per_blink;  // Host time: service, report, share of the batch write
+    uint32_t capacity_per_s;    // Blinks/s the host could handle back to back
+    uint32_t airtime_per_s;     // Blinks/s the channel could carry back to back
+} DW_TdoaStats_t;
+
+/* Function Prototypes */
+HAL_StatusTypeDef DW_TdoaInit(const DW_TdoaConfig_t* cfg);
+HAL_StatusTypeDef DW_TdoaRun(void);
+HAL_StatusTypeDef DW_TdoaFlush(void);
+void DW_TdoaGetStats(DW_TdoaStats_t* stats);
+void DW_TdoaResetStats(void);
+void DW_TdoaPrintStats(void);
+HAL_StatusTypeDef DW_TdoaBlink(uint64_t tag_id, uint8_t seq);
+HAL_StatusTypeDef DW_TdoaLinkWrite(const uint8_t* data, uint16_t length);
+
+#endif /* INC_DW_TDOA_H_ */
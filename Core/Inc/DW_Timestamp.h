@@ -0,0 +1,130 @@
+/*
+ * DW_Timestamp.h
+ *
+ *  Created on: Jul 5, 2025
+ *      Author: 36dhe
+ */
+
+#ifndef INC_DW_TIMESTAMP_H_
+#define INC_DW_TIMESTAMP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* DW1000 Timestamps
+ * SYS_TIME, DX_TIME, RX_STAMP and TX_STAMP are 40-bit counters of
+ * 1 / (128 * 499.2 MHz) = 15.65 ps that wrap every ~17.2 s. They are kept
+ * in the low 40 bits of a uint64_t; all arithmetic is modulo 2^40. */
+typedef uint64_t DW_Time_t;
+
+#define DW_TIME_BITS           40
+#define DW_TIME_MASK           0xFFFFFFFFFFULL
+#define DW_TIME_BYTES          5
+#define DW_TIME_TICKS_PER_US   63898           // 63897.6, see DW_TimeFromUs
+#define DW_TIME_DX_MASK        0xFFFFFFFE00ULL // DX_TIME ignores the low 9 bits
+
+/* (a + b) mod 2^40 */
+static inline DW_Time_t DW_TimeAdd(DW_Time_t a, DW_Time_t b)
+{
+    return (a + b) & DW_TIME_MASK;
+}
+
+/* Ticks from b to a, assuming a is not earlier than b: (a - b) mod 2^40 */
+static inline DW_Time_t DW_TimeSub(DW_Time_t a, DW_Time_t b)
+{
+    return (a - b) & DW_TIME_MASK;
+}
+
+/* Signed difference a - b, correct while |a - b| < 2^39 (~8.6 s) */
+static inline int64_t DW_TimeDiff(DW_Time_t a, DW_Time_t b)
+{
+    return (int64_t)((a - b) << (64 - DW_TIME_BITS)) >> (64 - DW_TIME_BITS);
+}
+
+/* true if a is earlier than b (wrap-safe within half a period) */
+static inline bool DW_TimeBefore(DW_Time_t a, DW_Time_t b)
+{
+    return DW_TimeDiff(a, b) < 0;
+}
+
+/* Conversions avoid 64-bit division, a library call of 100+ cycles on
+ * the Cortex-M3, and multiply by Q-format constants instead. */
+
+/* Ticks to picoseconds: 1 tick = 78125 / 4992 ps (Q19 multiply, 2.5e-8
+ * relative error). Valid for |ticks| < 2^40. */
+static inline int64_t DW_TimeToPs(int64_t ticks)
+{
+    return (ticks * 8205128) >> 19;
+}
+
+/* Microseconds to ticks: 1 us = 63897 + 0.6 ticks, the fraction in Q32.
+ * Truncated like us * 638976 / 10, exact for us < 2^31. */
+static inline DW_Time_t DW_TimeFromUs(uint32_t us)
+{
+    return (uint64_t)us * 63897 + (((uint64_t)us * 2576980378u) >> 32);
+}
+
+/* Ticks to microseconds, truncated: ticks * 5 / 319488 with
+ * 319488 = 2^12 * 78, the division by 78 as a Q39 multiply. Exact for
+ * ticks < 2^40. */
+static inline uint32_t DW_TimeToUs(DW_Time_t ticks)
+{
+    return (uint32_t)((((ticks * 5) >> 12) * 7048151461ULL) >> 39);
+}
+
+/* Time of flight in ticks to distance in millimetres (4.6917 mm per tick,
+ * Q16 multiply). Valid for |ticks| < 2^28 (~1200 km). */
+static inline int32_t DW_TimeToMm(int64_t ticks)
+{
+    return (int32_t)((ticks * 307480) >> 16);
+}
+
+/* Distance in millimetres to time of flight in ticks, inverse of
+ * DW_TimeToMm (2^48 / 307480 as a Q32 multiply), rounded. Valid for
+ * |mm| < 2^33, negative distances included. */
+static inline int64_t DW_TimeFromMm(int64_t mm)
+{
+    return (mm * 915425318 + ((int64_t)1 << 31)) >> 32;
+}
+
+/* floor(sqrt(x)), for RMS and standard deviations of ticks and distances;
+ * two bits per iteration */
+static inline uint32_t DW_Isqrt(uint64_t x)
+{
+    uint64_t r = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > x) bit >>= 2;
+    while (bit) {
+        if (x >= r + bit) {
+            x -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)r;
+}
+
+/* 5-byte little-endian register form to timestamp */
+static inline DW_Time_t DW_TimeUnpack(const uint8_t* raw)
+{
+    return (uint64_t)raw[4] << 32 |
+           (uint64_t)raw[3] << 24 |
+           (uint64_t)raw[2] << 16 |
+           (uint64_t)raw[1] << 8  |
+           raw[0];
+}
+
+/* Timestamp to 5-byte little-endian register form */
+static inline void DW_TimePack(uint8_t* raw, DW_Time_t t)
+{
+    raw[0] = (uint8_t)t;
+    raw[1] = (uint8_t)(t >> 8);
+    raw[2] = (uint8_t)(t >> 16);
+    raw[3] = (uint8_t)(t >> 24);
+    raw[4] = (uint8_t)(t >> 32);
+}
+
+#endif /* INC_DW_TIMESTAMP_H_ */
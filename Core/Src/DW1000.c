@@ -8,9 +8,120 @@
 #include "DWM1000.h"
 #include "main.h"
 #include <stdbool.h>
+#include <string.h>
+
+/* Private Variables */
+
+/* SPI transmit buffer: room for the longest SPI header followed by the
+ * frame. The header is placed right before the frame when it is uploaded.
+ * Word aligned so it can be handed to the SPI TX DMA channel as is. */
+static uint8_t dw_spi_tx_buf[DW_SPI_HDR_MAX + DW_TX_FRAME_MAX] __attribute__((aligned(4)));
+
+/* Shadow copy of the low 32 bits of TX_FCTRL (IFSDELAY is left at 0) */
+static uint32_t dw_tx_fctrl;
+
+/* Transmission mode selected by DW_EnableTxMode */
+static DW_TxMode_t dw_tx_mode = DW_TX_MODE_STANDARD;
+
+/* Physical layer configuration applied by DW_Configure */
+static DW_PhyConfig_t dw_phy;
+
+/* Transmission in progress, completed by DW_ProcessEvents/DW_WaitTxDone */
+static struct {
+    bool pending;
+    bool timestamping;
+    DW_TxHandle_t handle;
+    uint32_t start_tick;
+} dw_tx = { .timestamping = true };
+
+/* Receiver state. Frame data of RX events is held in pool buffers that
+ * are handed to the application by reference. */
+static struct {
+    bool enabled;
+    bool double_buffer;     // Receiver re-armed by the driver, see DW_RxSetDoubleBuffer
+    DW_RxClassifier_t classifier;
+    uint8_t header_len;     // Bytes read before calling the classifier
+    bool continuous;        // RXAUTR set, see DW_RxSetContinuous
+    bool quality;           // RX events carry DW_RxQuality_t
+    DW_RxStats_t stats;
+} dw_rx;
+
+/* ppb per RXTOFS count in Q16 for the last RXTTCKI seen; RXTTCKI only
+ * changes with the PRF, so the division is rarely repeated. */
+static struct {
+    uint32_t ttcki;
+    uint32_t ppb_q16;
+} dw_rx_ttck;
+
+/* Continuous-listen counters. The DIG_DIAG event counters are 12 bits
+ * wide and are accumulated here on every DW_RxGetCounters call. */
+#define DW_EVC_RX_COUNT        9     // EVC_PHE .. EVC_FWTO
+
+static struct {
+    uint16_t evc_last[DW_EVC_RX_COUNT];
+    uint32_t evc_total[DW_EVC_RX_COUNT];
+    uint32_t lde_errors;
+    uint32_t rx_resets;
+    uint32_t reenables;
+    bool deaf;
+    uint32_t deaf_start;    // DWT cycles
+    uint64_t deaf_cycles;
+    uint32_t deaf_max_cycles;
+    uint32_t start_tick;
+} dw_rx_cnt;
+
+/* Frame filtering: software stage and per-stage counters */
+static struct {
+    DW_SwFilter_t sw;
+    struct {
+        uint16_t src;
+        uint8_t seq;
+        bool valid;
+    } dup[DW_SW_FILTER_DUP_CACHE];
+    uint8_t dup_next;
+    uint16_t evc_ffr;           // EVC_FFR at the last DW_GetFilterStats
+    DW_FilterStats_t stats;
+} dw_filter;
+
+/* Event queue, single producer (driver) / single consumer (application) */
+static DW_Event_t dw_event_queue[DW_EVENT_QUEUE_LEN];
+static volatile uint8_t dw_event_head;
+static volatile uint8_t dw_event_tail;
+static uint32_t dw_event_drops;
+static DW_EventCallback_t dw_event_cb;
+
+/* Default configuration: channel 5, 64 MHz PRF, 6.8 Mbit/s, 128 symbols */
+const DW_PhyConfig_t DW_PHY_DEFAULT = {
+    .channel = 5,
+    .prf = DW_PRF_64M,
+    .data_rate = DW_BR_6M8,
+    .preamble_len = DW_PLEN_128,
+    .pac = DW_PAC_8,
+    .preamble_code = 9,
+    .nonstd_sfd = false,
+    .phr_mode = DW_PHR_STD
+};
 
 /* Private Function Prototypes */
-static bool DW_ValidateRegisterAccess(uint8_t reg_addr, uint8_t length);
+static bool DW_ValidateRegisterAccess(uint8_t reg_addr, uint16_t offset, uint16_t length);
+static uint8_t DW_BuildHeader(uint8_t* hdr, uint8_t reg_addr, uint16_t offset, bool write);
+static HAL_StatusTypeDef DW_SpiTransmit(const uint8_t* buf, uint16_t length);
+static HAL_StatusTypeDef DW_SpiReceive(uint8_t* buf, uint16_t length);
+static HAL_StatusTypeDef DW_SpiDmaWait(void);
+static HAL_StatusTypeDef DW_WriteValue(uint8_t reg_addr, uint16_t offset, uint32_t value, uint8_t length);
+static uint16_t DW_PreambleSymbols(DW_PreambleLen_t plen);
+static HAL_StatusTypeDef DW_ReadTimestamp(uint8_t reg_addr, uint16_t offset, DW_Time_t* ts);
+static void DW_TxComplete(DW_TxStatus_t status);
+static void DW_TxAbortLate(void);
+static void DW_PostEvent(const DW_Event_t* evt);
+static void DW_RxService(uint32_t status);
+static HAL_StatusTypeDef DW_RxReset(void);
+static bool DW_SwFilterAccept(const uint8_t* data, uint16_t length);
+static HAL_StatusTypeDef DW_RxFetchFrame(DW_RxEvent_t* rx, bool* keep);
+static HAL_StatusTypeDef DW_RxRearm(void);
+static void DW_RxMarkDeaf(void);
+static void DW_RxMarkListening(void);
+static uint32_t DW_RxIrqMask(void);
 
 /* Exported Functions */
 
@@ -23,47 +134,100 @@ static bool DW_ValidateRegisterAccess(uint8_t reg_addr, uint8_t length);
   */
 uint32_t DW_ReadReg(uint8_t reg_addr, uint8_t* data, uint8_t length)
 {
-    uint8_t header = reg_addr & 0x3F; // Bit 7=0 (read), Bit 6=0 (no sub-index)
+    return DW_ReadSubReg(reg_addr, 0, data, length);
+}
+
+/**
+  * @brief  Writes data to a DW1000 register
+  * @param  reg_addr: Register address (0x00-0x3F)
+  * @param  data: Pointer to data buffer
+  * @param  length: Number of bytes to write
+  * @retval HAL_OK on success, HAL_ERROR on failure
+  */
+uint32_t DW_WriteReg(uint8_t reg_addr, uint8_t* data, uint8_t length)
+{
+    return DW_WriteSubReg(reg_addr, 0, data, length);
+}
+
+/**
+  * @brief  Reads data from a DW1000 register at a sub-address
+  * @param  reg_addr: Register address (0x00-0x3F)
+  * @param  offset: Sub-address within the register (0x0000-0x7FFF)
+  * @param  data: Pointer to data buffer
+  * @param  length: Number of bytes to read
+  * @retval HAL_OK on success, HAL_ERROR on failure
+  */
+uint32_t DW_ReadSubReg(uint8_t reg_addr, uint16_t offset, uint8_t* data, uint16_t length)
+{
+    uint8_t header[DW_SPI_HDR_MAX];
 
-    if (!data || !DW_ValidateRegisterAccess(reg_addr, length)) {
+    if (!data || !DW_ValidateRegisterAccess(reg_addr, offset, length)) {
         return HAL_ERROR;
     }
 
+    uint8_t hlen = DW_BuildHeader(header, reg_addr, offset, false);
+
     HAL_GPIO_WritePin(SPICS_GPIO_Port, SPICS_Pin, GPIO_PIN_RESET);
-    HAL_StatusTypeDef status = HAL_SPI_Transmit(&hspi1, &header, 1, HAL_MAX_DELAY);
+    HAL_StatusTypeDef status = HAL_SPI_Transmit(&hspi1, header, hlen, HAL_MAX_DELAY);
     if (status == HAL_OK) {
-        status = HAL_SPI_Receive(&hspi1, data, length, HAL_MAX_DELAY);
+        status = DW_SpiReceive(data, length);
     }
     HAL_GPIO_WritePin(SPICS_GPIO_Port, SPICS_Pin, GPIO_PIN_SET);
-    
+
     return (status == HAL_OK) ? HAL_OK : HAL_ERROR;
 }
 
 /**
-  * @brief  Writes data to a DW1000 register
+  * @brief  Writes data to a DW1000 register at a sub-address
   * @param  reg_addr: Register address (0x00-0x3F)
+  * @param  offset: Sub-address within the register (0x0000-0x7FFF)
   * @param  data: Pointer to data buffer
   * @param  length: Number of bytes to write
   * @retval HAL_OK on success, HAL_ERROR on failure
   */
-uint32_t DW_WriteReg(uint8_t reg_addr, uint8_t* data, uint8_t length)
+uint32_t DW_WriteSubReg(uint8_t reg_addr, uint16_t offset, const uint8_t* data, uint16_t length)
 {
-    uint8_t header = (reg_addr & 0x3F) | 0x80; // Bit 7=1 (write)
+    uint8_t header[DW_SPI_HDR_MAX];
 
-    if (!data || !DW_ValidateRegisterAccess(reg_addr, length)) {
+    if (!data || !DW_ValidateRegisterAccess(reg_addr, offset, length)) {
         return HAL_ERROR;
     }
 
+    uint8_t hlen = DW_BuildHeader(header, reg_addr, offset, true);
+
     HAL_GPIO_WritePin(SPICS_GPIO_Port, SPICS_Pin, GPIO_PIN_RESET);
-    HAL_StatusTypeDef status = HAL_SPI_Transmit(&hspi1, &header, 1, HAL_MAX_DELAY);
+    HAL_StatusTypeDef status = HAL_SPI_Transmit(&hspi1, header, hlen, HAL_MAX_DELAY);
     if (status == HAL_OK) {
-        status = HAL_SPI_Transmit(&hspi1, data, length, HAL_MAX_DELAY);
+        status = HAL_SPI_Transmit(&hspi1, (uint8_t*)data, length, HAL_MAX_DELAY);
     }
     HAL_GPIO_WritePin(SPICS_GPIO_Port, SPICS_Pin, GPIO_PIN_SET);
 
     return (status == HAL_OK) ? HAL_OK : HAL_ERROR;
 }
 
+/**
+  * @brief  Reads the low 32 bits of the System Event Status Register
+  * @retval Status bits, 0 on SPI error
+  */
+uint32_t DW_ReadStatus(void)
+{
+    uint32_t status = 0;
+    if (DW_ReadReg(DW_REG_SYS_STATUS, (uint8_t*)&status, 4) != HAL_OK) {
+        return 0;
+    }
+    return status;
+}
+
+/**
+  * @brief  Clears System Event Status bits (write-1-to-clear)
+  * @param  bits: SYS_STATUS_xxx bits to clear
+  * @retval HAL_OK on success, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_ClearStatus(uint32_t bits)
+{
+    return DW_WriteReg(DW_REG_SYS_STATUS, (uint8_t*)&bits, 4);
+}
+
 /**
   * @brief  Reads the 32-bit Device ID (register 0x00)
   * @retval Device ID or 0xFFFFFFFF on error
@@ -105,16 +269,17 @@ uint32_t DW_ReadEUI(uint8_t* eui)
 /**
   * @brief  Validates register access parameters
   * @param  reg_addr: Register address to validate
+  * @param  offset: Sub-address within the register
   * @param  length: Requested data length
   * @retval true if valid, false otherwise
   */
-static bool DW_ValidateRegisterAccess(uint8_t reg_addr, uint8_t length)
+static bool DW_ValidateRegisterAccess(uint8_t reg_addr, uint16_t offset, uint16_t length)
 {
     // Check if register exists in predefined map
     for (uint8_t i = 0; i < sizeof(DW_Registers)/sizeof(DW_RegisterDef); i++) {
         if (DW_Registers[i].address == reg_addr) {
             // Validate length and access type
-            if (length > DW_Registers[i].length) {
+            if ((uint32_t)offset + length > DW_Registers[i].length) {
                 return false;
             }
             return true;
@@ -123,6 +288,44 @@ static bool DW_ValidateRegisterAccess(uint8_t reg_addr, uint8_t length)
     return false;
 }
 
+/**
+  * @brief  Builds the 1-3 byte SPI transaction header
+  * @param  hdr: Output buffer of DW_SPI_HDR_MAX bytes
+  * @param  reg_addr: Register address
+  * @param  offset: Sub-address (0 = no sub-index)
+  * @param  write: true for a write transaction
+  * @retval Header length in bytes
+  */
+static uint8_t DW_BuildHeader(uint8_t* hdr, uint8_t reg_addr, uint16_t offset, bool write)
+{
+    hdr[0] = (reg_addr & 0x3F) | (write ? 0x80 : 0x00);
+    if (offset == 0) {
+        return 1;
+    }
+
+    hdr[0] |= 0x40;                          // Sub-index present
+    if (offset < 0x80) {
+        hdr[1] = (uint8_t)offset;
+        return 2;
+    }
+
+    hdr[1] = 0x80 | (offset & 0x7F);         // Extended address
+    hdr[2] = (uint8_t)(offset >> 7);
+    return 3;
+}
+
+/**
+  * @brief  Writes a little-endian value of 1-4 bytes to a sub-register
+  * @retval HAL_OK on success, HAL_ERROR on failure
+  */
+static HAL_StatusTypeDef DW_WriteValue(uint8_t reg_addr, uint16_t offset, uint32_t value, uint8_t length)
+{
+    uint8_t data[4] = {
+        (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24)
+    };
+    return DW_WriteSubReg(reg_addr, offset, data, length);
+}
+
 
 /**
   * @brief  Reads all DW1000 registers into a structure
@@ -208,121 +411,1731 @@ bool DW_CompareEUI(uint8_t* eui1, uint8_t* eui2)
 }
 
 /**
-  * @brief  Configures DW1000 for transmission
-  * @param  mode: Transmission mode (standard/delayed/response)
+  * @brief  Applies a physical layer configuration
+  * @param  cfg: Channel, PRF, data rate, preamble and PHR settings
+  * @note   Register values follow the DW1000 User Manual default
+  *         configuration tables (section 2.5.5 and 7.2).
   * @retval HAL_OK if successful, HAL_ERROR on failure
   */
-HAL_StatusTypeDef DW_EnableTxMode(DW_TxMode_t mode)
+HAL_StatusTypeDef DW_Configure(const DW_PhyConfig_t* cfg)
 {
-    /* 1. Configure System Control Register (SYS_CTRL) */
-    uint32_t sys_ctrl = 0;
+    static const uint8_t chan_idx[8] = {0xFF, 0, 1, 2, 3, 4, 0xFF, 5};
+    static const uint32_t rf_txctrl[6] = {
+        0x00005C40, 0x00045CA0, 0x00086CC0, 0x00045C80, 0x001E3FE0, 0x001E7DE0
+    };
+    static const uint8_t rf_rxctrlh[6] = {0xD8, 0xD8, 0xD8, 0xBC, 0xD8, 0xBC};
+    static const uint8_t tc_pgdelay[6] = {0xC9, 0xC2, 0xC5, 0x95, 0xC0, 0x93};
+    static const uint32_t fs_pllcfg[6] = {
+        0x09000407, 0x08400508, 0x08401009, 0x08400508, 0x0800041D, 0x0800041D
+    };
+    static const uint8_t fs_plltune[6] = {0x1E, 0x26, 0x56, 0x26, 0xBE, 0xBE};
+    static const uint32_t tx_power[2][6] = {
+        {0x15355575, 0x15355575, 0x0F2F4F6F, 0x1F1F3F5F, 0x0E082848, 0x32527292},
+        {0x07274767, 0x07274767, 0x2B4B6B8B, 0x3A5A7A9A, 0x25456585, 0x5171B1D1}
+    };
+    static const uint32_t drx_tune2[4][2] = {
+        {0x311A002D, 0x313B006B}, {0x331A0052, 0x333B00BE},
+        {0x351A009A, 0x353B015E}, {0x371A011D, 0x373B0296}
+    };
+    static const uint16_t lde_repc[25] = {
+        0x0000, 0x5998, 0x5998, 0x51EA, 0x428E, 0x451E, 0x2E14, 0x8000, 0x51EA,
+        0x28F4, 0x3332, 0x3AE0, 0x3D70, 0x3AE0, 0x35C2, 0x2B84, 0x35C2, 0x3332,
+        0x35C2, 0x35C2, 0x47AE, 0x3AE0, 0x3850, 0x30A2, 0x3850
+    };
+    static bool lde_loaded = false;
 
-    /* Read current SYS_CTRL */
-    if (DW_ReadReg(DW_REG_SYS_CTRL, (uint8_t*)&sys_ctrl, 4) != HAL_OK) {
+    if (!cfg || cfg->channel > 7 || chan_idx[cfg->channel] == 0xFF ||
+        cfg->preamble_code == 0 || cfg->preamble_code > 24) {
         return HAL_ERROR;
     }
 
-    /* Set TX mode bits (clear RX bits) */
-    sys_ctrl &= ~(SYS_CTRL_RXEN | SYS_CTRL_RXDLYE);  // Disable RX
-    sys_ctrl |= SYS_CTRL_TXEN;                       // Enable TX
+    uint8_t ch = chan_idx[cfg->channel];
+    uint8_t prf64 = (cfg->prf == DW_PRF_64M) ? 1 : 0;
+    uint16_t plen = DW_PreambleSymbols(cfg->preamble_len);
+    uint16_t pac = (uint16_t)(8u << cfg->pac);
+    uint16_t sfd_len = (cfg->data_rate == DW_BR_110K) ? 64 :
+                       (cfg->nonstd_sfd && cfg->data_rate == DW_BR_850K) ? 16 : 8;
 
-    /* Mode-specific configurations */
-    switch(mode) {
-        case DW_TX_MODE_DELAYED:
-            sys_ctrl |= SYS_CTRL_TXDLYE;  // Enable delayed TX
-            break;
-        case DW_TX_MODE_RESPONSE:
-            sys_ctrl |= SYS_CTRL_TRXOFF;  // Disable transceiver
-            // Additional response mode config
-            break;
-        default: // Standard mode
-            break;
+    /* 1. Load the LDE microcode from ROM (needed for RX timestamps) */
+    if (!lde_loaded) {
+        if (DW_WriteValue(DW_REG_PMSC, DW_SUB_PMSC_CTRL0, 0x0301, 2) != HAL_OK) return HAL_ERROR;
+        if (DW_WriteValue(DW_REG_OTP_IF, DW_SUB_OTP_CTRL, 0x8000, 2) != HAL_OK) return HAL_ERROR;
+        HAL_Delay(1);
+        if (DW_WriteValue(DW_REG_PMSC, DW_SUB_PMSC_CTRL0, 0x0200, 2) != HAL_OK) return HAL_ERROR;
+        lde_loaded = true;
     }
 
-    /* Write back SYS_CTRL */
-    if (DW_WriteReg(DW_REG_SYS_CTRL, (uint8_t*)&sys_ctrl, 4) != HAL_OK) {
-        return HAL_ERROR;
+    /* 2. System configuration: PHR mode and 110 kbit/s receiver mode */
+    uint32_t sys_cfg = 0;
+    if (DW_ReadReg(DW_REG_SYS_CFG, (uint8_t*)&sys_cfg, 4) != HAL_OK) return HAL_ERROR;
+    sys_cfg &= ~(DW_SYS_CFG_PHR_MODE_MASK | DW_SYS_CFG_RXM110K);
+    sys_cfg |= (uint32_t)cfg->phr_mode << DW_SYS_CFG_PHR_MODE_SHIFT;
+    if (cfg->data_rate == DW_BR_110K) {
+        sys_cfg |= DW_SYS_CFG_RXM110K;
     }
+    if (DW_WriteReg(DW_REG_SYS_CFG, (uint8_t*)&sys_cfg, 4) != HAL_OK) return HAL_ERROR;
 
-    /* 2. Configure Frame Control Register (TX_FCTRL) */
-    uint8_t tx_fctrl[5] = {0};
-    tx_fctrl[0] = 0x00;  // Standard frame control
-    tx_fctrl[1] = 0x00;  // Frame length will be set during send
+    /* 3. Channel, PRF and preamble codes */
+    uint32_t chan_ctrl = cfg->channel |
+                         ((uint32_t)cfg->channel << DW_CHAN_CTRL_RX_CHAN_SHIFT) |
+                         ((uint32_t)cfg->prf << DW_CHAN_CTRL_RXPRF_SHIFT) |
+                         ((uint32_t)cfg->preamble_code << DW_CHAN_CTRL_TX_PCODE_SHIFT) |
+                         ((uint32_t)cfg->preamble_code << DW_CHAN_CTRL_RX_PCODE_SHIFT);
+    if (cfg->nonstd_sfd) {
+        chan_ctrl |= DW_CHAN_CTRL_DWSFD | DW_CHAN_CTRL_TNSSFD | DW_CHAN_CTRL_RNSSFD;
+    }
+    if (DW_WriteReg(DW_REG_CHAN_CTRL, (uint8_t*)&chan_ctrl, 4) != HAL_OK) return HAL_ERROR;
+
+    /* 4. Transmit frame control (frame length and offset are set per send) */
+    dw_tx_fctrl = ((uint32_t)cfg->data_rate << DW_TX_FCTRL_TXBR_SHIFT) |
+                  DW_TX_FCTRL_TR |
+                  ((uint32_t)cfg->prf << DW_TX_FCTRL_TXPRF_SHIFT) |
+                  ((uint32_t)cfg->preamble_len << DW_TX_FCTRL_TXPSR_PE_SHIFT);
+    if (DW_WriteReg(DW_REG_TX_FCTRL, (uint8_t*)&dw_tx_fctrl, 4) != HAL_OK) return HAL_ERROR;
+
+    /* 5. Analog RF and frequency synthesiser */
+    if (DW_WriteValue(DW_REG_RF_CONF, DW_SUB_RF_TXCTRL, rf_txctrl[ch], 4) != HAL_OK) return HAL_ERROR;
+    if (DW_WriteValue(DW_REG_RF_CONF, DW_SUB_RF_RXCTRLH, rf_rxctrlh[ch], 1) != HAL_OK) return HAL_ERROR;
+    if (DW_WriteValue(DW_REG_TX_CAL, DW_SUB_TC_PGDELAY, tc_pgdelay[ch], 1) != HAL_OK) return HAL_ERROR;
+    if (DW_WriteValue(DW_REG_FS_CTRL, DW_SUB_FS_PLLCFG, fs_pllcfg[ch], 4) != HAL_OK) return HAL_ERROR;
+    if (DW_WriteValue(DW_REG_FS_CTRL, DW_SUB_FS_PLLTUNE, fs_plltune[ch], 1) != HAL_OK) return HAL_ERROR;
+    if (DW_WriteValue(DW_REG_TX_POWER, 0, tx_power[prf64][ch], 4) != HAL_OK) return HAL_ERROR;
+
+    /* 6. Digital receiver tuning */
+    uint16_t tune0b = (cfg->data_rate == DW_BR_110K) ? (cfg->nonstd_sfd ? 0x0016 : 0x000A) :
+                      (cfg->data_rate == DW_BR_850K) ? (cfg->nonstd_sfd ? 0x0006 : 0x0001) :
+                                                       (cfg->nonstd_sfd ? 0x0002 : 0x0001);
+    uint16_t tune1b = (cfg->data_rate == DW_BR_110K) ? 0x0064 :
+                      (plen == 64) ? 0x0010 : 0x0020;
+    if (DW_WriteValue(DW_REG_DRX_CONF, DW_SUB_DRX_TUNE0B, tune0b, 2) != HAL_OK) return HAL_ERROR;
+    if (DW_WriteValue(DW_REG_DRX_CONF, DW_SUB_DRX_TUNE1A, prf64 ? 0x008D : 0x0087, 2) != HAL_OK) return HAL_ERROR;
+    if (DW_WriteValue(DW_REG_DRX_CONF, DW_SUB_DRX_TUNE1B, tune1b, 2) != HAL_OK) return HAL_ERROR;
+    if (DW_WriteValue(DW_REG_DRX_CONF, DW_SUB_DRX_TUNE2, drx_tune2[cfg->pac][prf64], 4) != HAL_OK) return HAL_ERROR;
+    if (DW_WriteValue(DW_REG_DRX_CONF, DW_SUB_DRX_TUNE4H, (plen == 64) ? 0x0010 : 0x0028, 2) != HAL_OK) return HAL_ERROR;
+    if (DW_WriteValue(DW_REG_DRX_CONF, DW_SUB_DRX_SFDTOC, plen + 1 + sfd_len - pac, 2) != HAL_OK) return HAL_ERROR;
+
+    /* 7. Automatic gain control */
+    if (DW_WriteValue(DW_REG_AGC_CTRL, DW_SUB_AGC_TUNE1, prf64 ? 0x889B : 0x8870, 2) != HAL_OK) return HAL_ERROR;
+    if (DW_WriteValue(DW_REG_AGC_CTRL, DW_SUB_AGC_TUNE2, 0x2502A907, 4) != HAL_OK) return HAL_ERROR;
+    if (DW_WriteValue(DW_REG_AGC_CTRL, DW_SUB_AGC_TUNE3, 0x0035, 2) != HAL_OK) return HAL_ERROR;
+
+    /* 8. Leading edge detection */
+    uint16_t repc = lde_repc[cfg->preamble_code];
+    if (cfg->data_rate == DW_BR_110K) {
+        repc >>= 3;
+    }
+    if (DW_WriteValue(DW_REG_LDE_CTRL, DW_SUB_LDE_CFG1, 0x6D, 1) != HAL_OK) return HAL_ERROR;
+    if (DW_WriteValue(DW_REG_LDE_CTRL, DW_SUB_LDE_CFG2, prf64 ? 0x0607 : 0x1607, 2) != HAL_OK) return HAL_ERROR;
+    if (DW_WriteValue(DW_REG_LDE_CTRL, DW_SUB_LDE_REPC, repc, 2) != HAL_OK) return HAL_ERROR;
+
+    /* 9. Raise IRQ on the events serviced by DW_ProcessEvents */
+    if (DW_WriteValue(DW_REG_SYS_MASK, 0, DW_RxIrqMask(), 4) != HAL_OK) return HAL_ERROR;
+
+    dw_phy = *cfg;
+    return HAL_OK;
+}
+
+/**
+  * @brief  Returns the active physical layer configuration
+  * @retval Pointer to the configuration last applied by DW_Configure
+  */
+const DW_PhyConfig_t* DW_GetPhyConfig(void)
+{
+    return &dw_phy;
+}
+
+/**
+  * @brief  Sets the TX and RX antenna delays
+  * @param  tx_antd: TX_ANTD, added to every TX timestamp and to the
+  *         programmed delayed TX time
+  * @param  rx_antd: LDE_RXANTD, subtracted from every RX timestamp
+  * @note   Both in ticks (15.65 ps) and zero after reset. Modules that
+  *         predict TX timestamps read TX_ANTD in their init, so call this
+  *         before them. The delays depend on channel and PRF.
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_SetAntennaDelay(uint16_t tx_antd, uint16_t rx_antd)
+{
+    if (DW_WriteValue(DW_REG_TX_ANTD, 0, tx_antd, 2) != HAL_OK) return HAL_ERROR;
+    return DW_WriteValue(DW_REG_LDE_CTRL, DW_SUB_LDE_RXANTD, rx_antd, 2);
+}
+
+/**
+  * @brief  Reads the TX and RX antenna delays
+  * @param  tx_antd: Output TX_ANTD in ticks
+  * @param  rx_antd: Output LDE_RXANTD in ticks
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_GetAntennaDelay(uint16_t* tx_antd, uint16_t* rx_antd)
+{
+    if (!tx_antd || !rx_antd) return HAL_ERROR;
+
+    *tx_antd = 0;
+    *rx_antd = 0;
+    if (DW_ReadSubReg(DW_REG_TX_ANTD, 0, (uint8_t*)tx_antd, 2) != HAL_OK) return HAL_ERROR;
+    return DW_ReadSubReg(DW_REG_LDE_CTRL, DW_SUB_LDE_RXANTD, (uint8_t*)rx_antd, 2);
+}
+
+/**
+  * @brief  Computes the on-air duration of a frame
+  * @param  cfg: Physical layer configuration
+  * @param  frame_len: Frame length in bytes, including FCS
+  * @retval Duration in microseconds (rounded up)
+  */
+uint32_t DW_FrameAirtimeUs(const DW_PhyConfig_t* cfg, uint16_t frame_len)
+{
+    /* Symbol and bit durations in picoseconds, indexed by DW_DataRate_t */
+    static const uint32_t data_bit_ps[3] = {8205130, 1025640, 128210};
+
+    if (!cfg) return 0;
+
+    uint32_t psym_ps = (cfg->prf == DW_PRF_64M) ? 1017630 : 993590;
+    uint32_t phr_bit_ps = (cfg->data_rate == DW_BR_110K) ? 8205130 : 1025640;
+    uint32_t sfd_len = (cfg->data_rate == DW_BR_110K) ? 64 :
+                       (cfg->nonstd_sfd && cfg->data_rate == DW_BR_850K) ? 16 : 8;
 
-    if (DW_WriteReg(DW_REG_TX_FCTRL, tx_fctrl, 5) != HAL_OK) {
+    /* Data bits plus 48 Reed-Solomon parity bits per 330-bit block */
+    uint32_t bits = (uint32_t)frame_len * 8;
+    bits += ((bits + 329) / 330) * 48;
+
+    uint64_t t_ps = (uint64_t)(DW_PreambleSymbols(cfg->preamble_len) + sfd_len) * psym_ps +
+                    21u * phr_bit_ps +
+                    (uint64_t)bits * data_bit_ps[cfg->data_rate];
+
+    return (uint32_t)((t_ps + 999999) / 1000000);
+}
+
+/**
+  * @brief  Switches the SPI clock between init-safe and full speed
+  * @param  fast: true for 8 MHz (PLL locked), false for 2 MHz (below 3 MHz limit)
+  * @note   Prescalers 2 and 8 of PCLK2, which is the 16 MHz HSE (no PLL).
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_SpiSetFast(bool fast)
+{
+    hspi1.Init.BaudRatePrescaler = fast ? SPI_BAUDRATEPRESCALER_2 : SPI_BAUDRATEPRESCALER_8;
+    return HAL_SPI_Init(&hspi1);
+}
+
+/**
+  * @brief  Configures DW1000 for transmission
+  * @param  mode: Transmission mode (standard/delayed/response)
+  * @note   SYS_CTRL start bits are not touched here, writing them would start
+  *         a transmission with whatever is in the TX buffer. The selected mode
+  *         is applied when the frame is sent. In the response modes the
+  *         receiver is turned on automatically after the frame has been sent,
+  *         see DW_SetResponseDelay().
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_EnableTxMode(DW_TxMode_t mode)
+{
+    /* 1. Apply the default PHY configuration if none was set yet */
+    if (dw_phy.channel == 0 && DW_Configure(&DW_PHY_DEFAULT) != HAL_OK) {
         return HAL_ERROR;
     }
 
-    /* 3. Configure Channel and TX Power */
-    uint32_t chan_ctrl = DW_CHAN_CTRL_TX_CHAN_5 | DW_CHAN_CTRL_TX_PRF_64MHZ;
-    if (DW_WriteReg(DW_REG_CHAN_CTRL, (uint8_t*)&chan_ctrl, 4) != HAL_OK) {
+    dw_tx_mode = mode;
+
+    /* 2. Configure Frame Control Register (TX_FCTRL) */
+    dw_tx_fctrl &= ~(DW_TX_FCTRL_TFLEN_MASK | (0x3FFu << DW_TX_FCTRL_TXBOFFS_SHIFT));
+
+    return DW_WriteReg(DW_REG_TX_FCTRL, (uint8_t*)&dw_tx_fctrl, 4);
+}
+
+/**
+  * @brief  Sets the turn-on delay of the receiver in response modes
+  * @param  delay_us: Time from end of TX to RX enable, in microseconds
+  * @note   W4R_TIM counts UWB microseconds (512/499.2 MHz = 1.0256 us), so
+  *         the value is scaled by 39/40. Keeping the receiver off until the
+  *         reply is due saves power versus enabling it right after TX.
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_SetResponseDelay(uint32_t delay_us)
+{
+    uint32_t w4r_tim = (uint32_t)(((uint64_t)delay_us * 39) / 40);
+    uint32_t ack_resp_t = 0;
+
+    if (w4r_tim > DW_ACK_RESP_T_W4R_TIM_MASK) {
         return HAL_ERROR;
     }
 
-    uint8_t tx_power[4] = {0x1F, 0x1F, 0x1F, 0x1F}; // Max power
-    if (DW_WriteReg(DW_REG_TX_POWER, tx_power, 4) != HAL_OK) {
+    /* Keep the auto-ACK turnaround in the upper byte */
+    if (DW_ReadReg(DW_REG_ACK_RESP_T, (uint8_t*)&ack_resp_t, 4) != HAL_OK) {
         return HAL_ERROR;
     }
 
-    return HAL_OK;
+    ack_resp_t = (ack_resp_t & ~DW_ACK_RESP_T_W4R_TIM_MASK) | w4r_tim;
+
+    return DW_WriteReg(DW_REG_ACK_RESP_T, (uint8_t*)&ack_resp_t, 4);
+}
+
+/**
+  * @brief  Sets the time for the next delayed TX or RX (DX_TIME)
+  * @param  dx_time: 40-bit system time; the low 9 bits are ignored by the chip
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_SetDelayedTime(DW_Time_t dx_time)
+{
+    uint8_t raw[DW_TIME_BYTES];
+
+    DW_TimePack(raw, dx_time);
+    return DW_WriteReg(DW_REG_DX_TIME, raw, sizeof(raw));
+}
+
+/**
+  * @brief  Reads the 40-bit system time counter (SYS_TIME)
+  * @param  sys_time: Output time; the low 9 bits always read as 0
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_ReadSysTime(DW_Time_t* sys_time)
+{
+    if (!sys_time) return HAL_ERROR;
+    return DW_ReadTimestamp(DW_REG_SYS_TIME, 0, sys_time);
 }
 
 /**
   * @brief  Disables transmission mode
+  * @note   Forces the transceiver to idle, aborting any pending transmission
   * @retval HAL_OK if successful, HAL_ERROR on failure
   */
 HAL_StatusTypeDef DW_DisableTxMode(void)
 {
-    uint32_t sys_ctrl = 0;
-
-    if (DW_ReadReg(DW_REG_SYS_CTRL, (uint8_t*)&sys_ctrl, 4) != HAL_OK) {
-        return HAL_ERROR;
-    }
+    uint32_t sys_ctrl = SYS_CTRL_TRXOFF;
 
-    sys_ctrl &= ~(SYS_CTRL_TXEN | SYS_CTRL_TXDLYE);  // Clear TX bits
+    dw_tx_mode = DW_TX_MODE_STANDARD;
 
     return DW_WriteReg(DW_REG_SYS_CTRL, (uint8_t*)&sys_ctrl, 4);
 }
 
 /**
   * @brief  Transmits a data frame
-  * @param  frame_data: Pointer to frame data
-  * @param  length: Length of frame (up to 1024 bytes)
+  * @param  frame_data: Pointer to frame data (without FCS)
+  * @param  length: Length of frame data
+  * @note   Copies the frame into the TX frame builder. Callers that assemble
+  *         frames themselves should use DW_FrameBegin() to avoid the copy.
   * @retval HAL_OK if successful, HAL_ERROR on failure
   */
 HAL_StatusTypeDef DW_SendFrame(uint8_t* frame_data, uint16_t length)
 {
+    DW_FrameBuilder_t fb;
+
     /* 1. Validate parameters */
-    if (!frame_data || length == 0 || length > 1024) {
+    if (!frame_data || length == 0) {
+        return HAL_ERROR;
+    }
+
+    /* 2. Place the frame in the SPI TX buffer */
+    uint8_t* dst = DW_FrameBegin(&fb);
+    if (!DW_FrameReserve(&fb, length)) {
         return HAL_ERROR;
     }
+    memcpy(dst, frame_data, length);
+
+    /* 3. Trigger transmission */
+    return DW_FrameSend(&fb);
+}
+
+/**
+  * @brief  Starts a new frame in the SPI TX buffer
+  * @param  fb: Frame builder to initialise
+  * @retval Pointer to the first frame byte, NULL on error
+  */
+uint8_t* DW_FrameBegin(DW_FrameBuilder_t* fb)
+{
+    if (!fb) return NULL;
+
+    fb->data = &dw_spi_tx_buf[DW_SPI_HDR_MAX];
+    fb->length = 0;
+    fb->capacity = DW_TX_FRAME_MAX - DW_FCS_LEN;
+
+    return fb->data;
+}
+
+/**
+  * @brief  Reserves space at the end of the frame for in-place writing
+  * @param  fb: Frame builder
+  * @param  n: Number of bytes to reserve
+  * @retval Pointer to the reserved bytes, NULL if the frame would overflow
+  */
+uint8_t* DW_FrameReserve(DW_FrameBuilder_t* fb, uint16_t n)
+{
+    if (!fb || !fb->data || n > (uint16_t)(fb->capacity - fb->length)) {
+        return NULL;
+    }
+
+    uint8_t* p = fb->data + fb->length;
+    fb->length += n;
+    return p;
+}
+
+/**
+  * @brief  Writes an IEEE 802.15.4 header with short addresses in place
+  * @param  fb: Frame builder
+  * @param  frame_ctrl: Frame control field (DW_FC_xxx)
+  * @param  seq: Sequence number
+  * @param  pan_id: Destination PAN identifier
+  * @param  dst_addr: Destination short address
+  * @param  src_addr: Source short address
+  * @retval HAL_OK on success, HAL_ERROR if the frame would overflow
+  */
+HAL_StatusTypeDef DW_FrameWriteMacHeader(DW_FrameBuilder_t* fb, uint16_t frame_ctrl,
+                                         uint8_t seq, uint16_t pan_id,
+                                         uint16_t dst_addr, uint16_t src_addr)
+{
+    uint8_t* p = DW_FrameReserve(fb, DW_MAC_HDR_SHORT_LEN);
+    if (!p) return HAL_ERROR;
+
+    frame_ctrl |= DW_FC_PANID_COMP | DW_FC_DST_SHORT | DW_FC_SRC_SHORT;
+
+    p[0] = (uint8_t)frame_ctrl;
+    p[1] = (uint8_t)(frame_ctrl >> 8);
+    p[2] = seq;
+    p[3] = (uint8_t)pan_id;
+    p[4] = (uint8_t)(pan_id >> 8);
+    p[5] = (uint8_t)dst_addr;
+    p[6] = (uint8_t)(dst_addr >> 8);
+    p[7] = (uint8_t)src_addr;
+    p[8] = (uint8_t)(src_addr >> 8);
+
+    return HAL_OK;
+}
 
-    /* 2. Set frame length in TX_FCTRL */
-    uint8_t tx_fctrl[5];
-    if (DW_ReadReg(DW_REG_TX_FCTRL, tx_fctrl, 5) != HAL_OK) {
+/**
+  * @brief  Transmits the frame held by the builder
+  * @param  fb: Frame builder filled via DW_FrameReserve()
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_FrameSend(DW_FrameBuilder_t* fb)
+{
+    if (DW_FrameUpload(fb, 0) != HAL_OK) {
         return HAL_ERROR;
     }
 
-    tx_fctrl[0] = (length & 0xFF);        // LSB of length
-    tx_fctrl[1] = ((length >> 8) & 0x03); // 2 MSBs of length (max 1024)
+    return DW_FrameStart(fb->length, 0);
+}
+
+/**
+  * @brief  Copies the frame held by the builder into the DW1000 TX buffer
+  * @param  fb: Frame builder filled via DW_FrameReserve()
+  * @param  tx_offset: Destination offset in the 1024-byte TX buffer
+  * @note   The SPI header is placed directly in front of the frame, so header
+  *         and frame go out in a single SPI transaction without a copy.
+  *         Uploading to an offset not used by the frame on air is allowed
+  *         while a transmission is in progress.
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_FrameUpload(DW_FrameBuilder_t* fb, uint16_t tx_offset)
+{
+    uint8_t header[DW_SPI_HDR_MAX];
 
-    if (DW_WriteReg(DW_REG_TX_FCTRL, tx_fctrl, 5) != HAL_OK) {
+    /* 1. Validate parameters */
+    if (!fb || fb->data != &dw_spi_tx_buf[DW_SPI_HDR_MAX] || fb->length == 0 ||
+        (uint32_t)tx_offset + fb->length + DW_FCS_LEN > DW_TX_BUFFER_SIZE) {
         return HAL_ERROR;
     }
 
-    /* 3. Write frame to TX buffer */
-    if (DW_WriteReg(DW_REG_TX_BUFFER, frame_data, length) != HAL_OK) {
+    /* 2. Place the SPI header right before the frame */
+    uint8_t hlen = DW_BuildHeader(header, DW_REG_TX_BUFFER, tx_offset, true);
+    uint8_t* start = fb->data - hlen;
+    memcpy(start, header, hlen);
+
+    /* 3. Header and frame go out in a single SPI transaction */
+    return DW_SpiTransmit(start, hlen + fb->length);
+}
+
+/**
+  * @brief  Starts transmission of a frame already in the TX buffer
+  * @param  length: Frame length in bytes, excluding FCS
+  * @param  tx_offset: Offset of the frame in the TX buffer
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_FrameStart(uint16_t length, uint16_t tx_offset)
+{
+    /* 1. Set frame length (including FCS) and buffer offset in TX_FCTRL */
+    uint32_t flen = (uint32_t)length + DW_FCS_LEN;
+    dw_tx_fctrl &= ~(DW_TX_FCTRL_TFLEN_MASK | (0x3FFu << DW_TX_FCTRL_TXBOFFS_SHIFT));
+    dw_tx_fctrl |= (flen & DW_TX_FCTRL_TFLEN_MASK) |
+                   ((uint32_t)(tx_offset & 0x3FF) << DW_TX_FCTRL_TXBOFFS_SHIFT);
+
+    if (DW_WriteReg(DW_REG_TX_FCTRL, (uint8_t*)&dw_tx_fctrl, 4) != HAL_OK) {
         return HAL_ERROR;
     }
 
-    /* 4. Trigger transmission */
-    uint32_t sys_ctrl = 0;
-    if (DW_ReadReg(DW_REG_SYS_CTRL, (uint8_t*)&sys_ctrl, 4) != HAL_OK) {
+    /* 2. Trigger transmission */
+    uint32_t sys_ctrl = SYS_CTRL_TXSTRT;
+    switch (dw_tx_mode) {
+        case DW_TX_MODE_DELAYED:
+            sys_ctrl |= SYS_CTRL_TXDLYS;
+            break;
+        case DW_TX_MODE_RESPONSE:
+            sys_ctrl |= SYS_CTRL_WAIT4RESP;
+            break;
+        case DW_TX_MODE_DELAYED_RESPONSE:
+            sys_ctrl |= SYS_CTRL_TXDLYS | SYS_CTRL_WAIT4RESP;
+            break;
+        default: // Standard mode
+            break;
+    }
+
+    if (DW_WriteReg(DW_REG_SYS_CTRL, (uint8_t*)&sys_ctrl, 4) != HAL_OK) {
         return HAL_ERROR;
     }
 
-    sys_ctrl |= SYS_CTRL_TXSTRT;  // Set TX start bit
+    /* 3. Track the frame until TXFRS */
+    dw_tx.handle++;
+    dw_tx.pending = true;
+    dw_tx.start_tick = HAL_GetTick();
 
-    return DW_WriteReg(DW_REG_SYS_CTRL, (uint8_t*)&sys_ctrl, 4);
+    /* The receiver comes up by itself after a response-mode frame */
+    if (dw_tx_mode == DW_TX_MODE_RESPONSE || dw_tx_mode == DW_TX_MODE_DELAYED_RESPONSE) {
+        dw_rx.enabled = true;
+    }
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Returns the handle of the frame started last
+  * @retval Handle reported in the matching DW_EVENT_TX_DONE event
+  */
+DW_TxHandle_t DW_GetLastTxHandle(void)
+{
+    return dw_tx.handle;
+}
+
+/**
+  * @brief  Enables or disables TX_STAMP capture on completion
+  * @param  enable: false skips the TX_TIME read (e.g. for streaming)
+  * @note   DW_EVENT_TX_DONE is still posted, with tx_time left at 0.
+  */
+void DW_SetTxTimestamping(bool enable)
+{
+    dw_tx.timestamping = enable;
+}
+
+/**
+  * @brief  Busy-waits for the pending transmission to complete
+  * @param  timeout_ms: Maximum wait in milliseconds
+  * @retval HAL_OK when sent (or nothing pending), HAL_ERROR on timeout
+  *         or a delayed start time that had already passed
+  */
+HAL_StatusTypeDef DW_WaitTxDone(uint32_t timeout_ms)
+{
+    uint32_t start = HAL_GetTick();
+
+    while (dw_tx.pending) {
+        uint32_t status = DW_ReadStatus();
+
+        if (status & SYS_STATUS_TXFRS) {
+            DW_TxComplete(DW_TX_OK);
+            return HAL_OK;
+        }
+        if (status & SYS_STATUS_HPDWARN) {
+            DW_TxAbortLate();
+            return HAL_ERROR;
+        }
+        if (HAL_GetTick() - start > timeout_ms) {
+            DW_TxComplete(DW_TX_TIMEOUT);
+            return HAL_ERROR;
+        }
+    }
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Services the DW1000 and queues completion events
+  * @note   Call from the main loop. SYS_STATUS is only read while the IRQ
+  *         line is asserted, so an idle radio costs no SPI traffic.
+  */
+void DW_ProcessEvents(void)
+{
+    if (!dw_tx.pending && !dw_rx.enabled) {
+        return;
+    }
+
+    bool timed_out = dw_tx.pending && (HAL_GetTick() - dw_tx.start_tick) > DW_TX_TIMEOUT_MS;
+    if (!timed_out && HAL_GPIO_ReadPin(SPIRQ_GPIO_Port, SPIRQ_Pin) == GPIO_PIN_RESET) {
+        return;
+    }
+
+    uint32_t status = DW_ReadStatus();
+
+    if (dw_tx.pending) {
+        if (status & SYS_STATUS_TXFRS) {
+            DW_TxComplete(DW_TX_OK);
+        } else if (status & SYS_STATUS_HPDWARN) {
+            DW_TxAbortLate();
+        } else if (timed_out) {
+            DW_TxComplete(DW_TX_TIMEOUT);
+        }
+    }
+
+    if (dw_rx.enabled && !dw_tx.pending) {
+        DW_RxService(status);
+    }
 }
 
+/**
+  * @brief  Removes the oldest event from the queue
+  * @param  evt: Output event
+  * @retval true if an event was returned
+  */
+bool DW_GetEvent(DW_Event_t* evt)
+{
+    uint8_t tail = dw_event_tail;
+
+    if (!evt || tail == dw_event_head) {
+        return false;
+    }
+
+    *evt = dw_event_queue[tail];
+    dw_event_tail = (tail + 1) & (DW_EVENT_QUEUE_LEN - 1);
+    return true;
+}
+
+/**
+  * @brief  Registers a callback receiving events instead of the queue
+  * @param  cb: Callback, NULL to go back to queueing
+  */
+void DW_SetEventCallback(DW_EventCallback_t cb)
+{
+    dw_event_cb = cb;
+}
+
+/**
+  * @brief  Returns the number of events lost because the queue was full
+  */
+uint32_t DW_GetEventDrops(void)
+{
+    return dw_event_drops;
+}
+
+/**
+  * @brief  Turns the receiver on immediately
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_RxEnable(void)
+{
+    uint32_t sys_ctrl = SYS_CTRL_RXENAB;
+
+    if (dw_rx.double_buffer && DW_RxSyncBufferPointers() != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    if (DW_WriteReg(DW_REG_SYS_CTRL, (uint8_t*)&sys_ctrl, 4) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    dw_rx.enabled = true;
+    DW_RxMarkListening();
+    return HAL_OK;
+}
+
+/**
+  * @brief  Turns the receiver on at a given system time
+  * @param  rx_time: 40-bit system time; the low 9 bits are ignored by the chip
+  * @retval HAL_OK if successful, HAL_ERROR on failure or if the time has passed
+  */
+HAL_StatusTypeDef DW_RxEnableDelayed(DW_Time_t rx_time)
+{
+    uint32_t sys_ctrl = SYS_CTRL_RXENAB | SYS_CTRL_RXDLYE;
+
+    if (DW_SetDelayedTime(rx_time) != HAL_OK ||
+        DW_WriteReg(DW_REG_SYS_CTRL, (uint8_t*)&sys_ctrl, 4) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    /* A start time already in the past would turn RX on ~17 s later */
+    if (DW_ReadStatus() & SYS_STATUS_HPDWARN) {
+        DW_RxDisable();
+        DW_ClearStatus(SYS_STATUS_HPDWARN);
+        return HAL_ERROR;
+    }
+
+    dw_rx.enabled = true;
+    return HAL_OK;
+}
+
+/**
+  * @brief  Turns the transceiver off
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_RxDisable(void)
+{
+    uint32_t sys_ctrl = SYS_CTRL_TRXOFF;
+
+    dw_rx.enabled = false;
+    return DW_WriteReg(DW_REG_SYS_CTRL, (uint8_t*)&sys_ctrl, 4);
+}
+
+/**
+  * @brief  Programs the receive frame wait and preamble detection timeouts
+  * @param  frame_wait_us: RX enable to frame received (RX_FWTO), 0 disables
+  * @param  preamble_us: RX enable to preamble detected (DRX_PRETOC), 0 disables
+  * @note   Both are rounded up so the receiver never gives up early. RX_FWTO
+  *         counts UWB microseconds (1.0256 us, ~67 ms maximum), DRX_PRETOC
+  *         counts PACs of the configured PHY. The timeouts stay in effect for
+  *         every RX enable, including the one after a response-mode TX. The
+  *         receiver then turns itself off and a DW_EVENT_RX_TIMEOUT is posted.
+  * @retval HAL_OK if successful, HAL_ERROR on failure or value out of range
+  */
+HAL_StatusTypeDef DW_RxSetTimeouts(uint32_t frame_wait_us, uint32_t preamble_us)
+{
+    uint32_t sys_cfg = 0;
+    uint32_t sym_ps = (dw_phy.prf == DW_PRF_64M) ? 1017630 : 993590;
+    uint32_t pac_ps = sym_ps * (8u << dw_phy.pac);
+    uint32_t fwto = (uint32_t)(((uint64_t)frame_wait_us * 39 + 39) / 40);
+    uint64_t pretoc = ((uint64_t)preamble_us * 1000000 + pac_ps - 1) / pac_ps;
+
+    /* Continuous listening must not be ended by a frame wait timeout */
+    if (fwto > 0xFFFF || pretoc > 0xFFFF || (frame_wait_us && dw_rx.continuous)) {
+        return HAL_ERROR;
+    }
+
+    if (DW_ReadReg(DW_REG_SYS_CFG, (uint8_t*)&sys_cfg, 4) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    if (frame_wait_us) {
+        sys_cfg |= DW_SYS_CFG_RXWTOE;
+    } else {
+        sys_cfg &= ~DW_SYS_CFG_RXWTOE;
+    }
+
+    if (DW_WriteValue(DW_REG_RX_FWTO, 0, fwto, 2) != HAL_OK ||
+        DW_WriteValue(DW_REG_DRX_CONF, DW_SUB_DRX_PRETOC, (uint32_t)pretoc, 2) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    return DW_WriteReg(DW_REG_SYS_CFG, (uint8_t*)&sys_cfg, 4);
+}
+
+/**
+  * @brief  Turns the receiver on for a bounded listen window
+  * @param  window_us: Time in which a preamble must be detected
+  * @param  frame_len: Longest frame expected (excluding FCS), 0 for DW_TX_FRAME_MAX
+  * @note   The frame wait timeout is the window plus the airtime of the
+  *         longest frame, so a frame that starts at the end of the window
+  *         is still received. Without a preamble the radio is off after
+  *         window_us; a timeout event is posted by DW_ProcessEvents().
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_RxListenWindow(uint32_t window_us, uint16_t frame_len)
+{
+    uint16_t len = frame_len ? frame_len + DW_FCS_LEN : DW_TX_FRAME_MAX;
+    uint32_t airtime_us = DW_FrameAirtimeUs(&dw_phy, len);
+
+    if (window_us == 0 ||
+        DW_RxSetTimeouts(window_us + airtime_us, window_us) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    return DW_RxEnable();
+}
+
+/**
+  * @brief  Reads and parses RX_FINFO of the received frame
+  * @param  info: Output frame information
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_RxReadInfo(DW_RxFrameInfo_t* info)
+{
+    uint32_t finfo = 0;
+
+    if (!info || DW_ReadReg(DW_REG_RX_FINFO, (uint8_t*)&finfo, 4) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    uint16_t flen = finfo & DW_RX_FINFO_RXFLEN_MASK;
+    info->length = (flen > DW_FCS_LEN) ? flen - DW_FCS_LEN : 0;
+    info->data_rate = (DW_DataRate_t)((finfo >> DW_RX_FINFO_RXBR_SHIFT) & 0x03);
+    info->prf = (DW_Prf_t)((finfo >> DW_RX_FINFO_RXPRFR_SHIFT) & 0x03);
+    info->ranging = (finfo & DW_RX_FINFO_RNG) != 0;
+    info->preamble_count = (uint16_t)(finfo >> DW_RX_FINFO_RXPACC_SHIFT);
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Reads the received frame
+  * @param  buf: Output buffer
+  * @param  size: Size of buf
+  * @param  info: Output frame information
+  * @note   Only the length reported in RX_FINFO is transferred (FCS excluded),
+  *         never the whole 1024-byte RX buffer.
+  * @retval HAL_OK if successful, HAL_ERROR on failure or if buf is too small
+  */
+HAL_StatusTypeDef DW_RxReadFrame(uint8_t* buf, uint16_t size, DW_RxFrameInfo_t* info)
+{
+    if (!buf || DW_RxReadInfo(info) != HAL_OK || info->length > size) {
+        return HAL_ERROR;
+    }
+
+    if (info->length == 0) {
+        return HAL_OK;
+    }
+
+    return DW_ReadSubReg(DW_REG_RX_BUFFER, 0, buf, info->length);
+}
+
+/**
+  * @brief  Reads the 40-bit RX timestamp (RX_STAMP) of the received frame
+  * @param  rx_time: Output timestamp
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_RxReadTimestamp(DW_Time_t* rx_time)
+{
+    if (!rx_time) return HAL_ERROR;
+    return DW_ReadTimestamp(DW_REG_RX_TIME, 0, rx_time);
+}
+
+/**
+  * @brief  Estimates the transmitter clock offset of the received frame
+  * @param  ppb: Output offset of the remote clock relative to ours,
+  *         DW_RX_OFFSET_INVALID on failure
+  * @note   The receiver tracks the incoming symbol timing: RXTOFS counts
+  *         the offset accumulated over RXTTCKI, and a positive RXTOFS means
+  *         our clock runs faster than the transmitter's (User Manual
+  *         7.2.21). The ratio is formed with a cached Q16 reciprocal, so
+  *         the per-frame cost is one 32x32 multiply.
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_RxReadClockOffset(int32_t* ppb)
+{
+    uint32_t ttcki = 0;
+    uint32_t ttcko = 0;
+
+    if (!ppb) return HAL_ERROR;
+    *ppb = DW_RX_OFFSET_INVALID;
+
+    if (DW_ReadReg(DW_REG_RX_TTCKI, (uint8_t*)&ttcki, 4) != HAL_OK ||
+        DW_ReadReg(DW_REG_RX_TTCKO, (uint8_t*)&ttcko, 3) != HAL_OK ||
+        ttcki == 0) {
+        return HAL_ERROR;
+    }
+
+    if (ttcki != dw_rx_ttck.ttcki) {
+        dw_rx_ttck.ttcki = ttcki;
+        dw_rx_ttck.ppb_q16 = (uint32_t)((1000000000ULL << 16) / ttcki);
+    }
+
+    /* Sign-extend the 19-bit offset */
+    int32_t tofs = (int32_t)(ttcko & DW_RX_TTCKO_RXTOFS_MASK);
+    if (tofs & DW_RX_TTCKO_RXTOFS_SIGN) {
+        tofs -= DW_RX_TTCKO_RXTOFS_MASK + 1;
+    }
+
+    *ppb = -(int32_t)(((int64_t)tofs * dw_rx_ttck.ppb_q16) >> 16);
+    return HAL_OK;
+}
+
+/**
+  * @brief  Reads the raw receive quality of the received frame
+  * @param  quality: Output quality values
+  * @note   RX_FQUAL and RX_TIME are swapped with the RX buffers; in
+  *         double-buffered mode read them before the buffer is handed back.
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_RxReadQuality(DW_RxQuality_t* quality)
+{
+    uint16_t fqual[4];
+    uint16_t fp[2];
+
+    if (!quality) return HAL_ERROR;
+
+    /* STD_NOISE, FP_AMPL2, FP_AMPL3, CIR_PWR / FP_INDEX, FP_AMPL1 */
+    if (DW_ReadReg(DW_REG_RX_FQUAL, (uint8_t*)fqual, 8) != HAL_OK ||
+        DW_ReadSubReg(DW_REG_RX_TIME, DW_SUB_RX_FP_INDEX, (uint8_t*)fp, 4) != HAL_OK ||
+        DW_ReadSubReg(DW_REG_DRX_CONF, DW_SUB_DRX_PACC_NOSAT, (uint8_t*)&quality->rxpacc_nosat, 2) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    quality->std_noise = fqual[0];
+    quality->fp_ampl2 = fqual[1];
+    quality->fp_ampl3 = fqual[2];
+    quality->cir_power = fqual[3];
+    quality->fp_index = fp[0];
+    quality->fp_ampl1 = fp[1];
+    return HAL_OK;
+}
+
+/**
+  * @brief  Enables or disables quality capture for received frames
+  * @param  enable: true to fill DW_RxEvent_t.quality of every good frame
+  * @note   Costs three short SPI reads per frame.
+  */
+void DW_RxSetQualityCapture(bool enable)
+{
+    dw_rx.quality = enable;
+}
+
+/**
+  * @brief  Maps SYS_STATUS error and timeout bits to a receive status
+  * @param  status: SYS_STATUS low 32 bits
+  * @retval Most significant cause, DW_RX_OK if none is set
+  */
+DW_RxStatus_t DW_RxClassifyStatus(uint32_t status)
+{
+    if (status & SYS_STATUS_RXOVRR)  return DW_RX_ERR_OVERRUN;
+    if (status & SYS_STATUS_RXPHE)   return DW_RX_ERR_PHR;
+    if (status & SYS_STATUS_RXRFSL)  return DW_RX_ERR_SYNC_LOSS;
+    if (status & SYS_STATUS_RXFCE)   return DW_RX_ERR_FCS;
+    if (status & SYS_STATUS_RXSFDTO) return DW_RX_ERR_SFD_TIMEOUT;
+    if (status & SYS_STATUS_AFFREJ)  return DW_RX_ERR_REJECTED;
+    if (status & SYS_STATUS_LDEERR)  return DW_RX_ERR_LDE;
+    if (status & SYS_STATUS_RXRFTO)  return DW_RX_TIMEOUT_FRAME;
+    if (status & SYS_STATUS_RXPTO)   return DW_RX_TIMEOUT_PREAMBLE;
+    return DW_RX_OK;
+}
+
+/**
+  * @brief  Enables or disables double-buffered reception
+  * @param  enable: true to use both DW1000 RX buffers
+  * @note   In double-buffered mode the driver re-arms the receiver as soon as
+  *         a frame is detected, before reading it out, so the next frame can
+  *         land in the other buffer. RX then stays on until DW_RxDisable().
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_RxSetDoubleBuffer(bool enable)
+{
+    uint32_t sys_cfg = 0;
+
+    if (DW_ReadReg(DW_REG_SYS_CFG, (uint8_t*)&sys_cfg, 4) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    if (enable) {
+        sys_cfg &= ~DW_SYS_CFG_DIS_DRXB;
+    } else {
+        sys_cfg |= DW_SYS_CFG_DIS_DRXB;
+    }
+
+    if (DW_WriteReg(DW_REG_SYS_CFG, (uint8_t*)&sys_cfg, 4) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    dw_rx.double_buffer = enable;
+    return HAL_OK;
+}
+
+/**
+  * @brief  Aligns the host side RX buffer pointer with the IC side pointer
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_RxSyncBufferPointers(void)
+{
+    uint32_t status = DW_ReadStatus();
+    uint32_t sys_ctrl = SYS_CTRL_HRBPT;
+
+    if (((status & SYS_STATUS_HSRBP) != 0) == ((status & SYS_STATUS_ICRBP) != 0)) {
+        return HAL_OK;
+    }
+
+    return DW_WriteReg(DW_REG_SYS_CTRL, (uint8_t*)&sys_ctrl, 4);
+}
+
+/**
+  * @brief  Enables header-first reception
+  * @param  classifier: Called with the first header_len bytes of each frame,
+  *         returns true to fetch the rest. NULL reads whole frames at once.
+  * @param  header_len: Bytes read before classification
+  * @note   Kept frames cost one extra SPI header (2-3 bytes); discarded
+  *         frames cost header_len bytes instead of the full payload.
+  *         The software filter still needs the whole frame.
+  * @retval HAL_OK if successful, HAL_ERROR if header_len is 0
+  */
+HAL_StatusTypeDef DW_RxSetClassifier(DW_RxClassifier_t classifier, uint8_t header_len)
+{
+    if (classifier && header_len == 0) {
+        return HAL_ERROR;
+    }
+
+    dw_rx.classifier = classifier;
+    dw_rx.header_len = header_len;
+    return HAL_OK;
+}
+
+/**
+  * @brief  Enables or disables continuous listening
+  * @param  enable: true to keep the receiver on indefinitely
+  * @note   Sets RXAUTR so the DW1000 re-enables itself after PHR, FCS,
+  *         sync loss, SFD timeout and LDE errors without involving the host;
+  *         these are no longer signalled and only show up in the counters.
+  *         Frame wait timeouts are disabled. After a good frame (single
+  *         buffer), a preamble timeout or an overrun the driver re-enables
+  *         the receiver itself and measures the time it was deaf.
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_RxSetContinuous(bool enable)
+{
+    uint32_t sys_cfg = 0;
+
+    if (DW_ReadReg(DW_REG_SYS_CFG, (uint8_t*)&sys_cfg, 4) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    if (enable) {
+        sys_cfg = (sys_cfg | DW_SYS_CFG_RXAUTR) & ~DW_SYS_CFG_RXWTOE;
+    } else {
+        sys_cfg &= ~DW_SYS_CFG_RXAUTR;
+    }
+
+    if (DW_WriteReg(DW_REG_SYS_CFG, (uint8_t*)&sys_cfg, 4) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    dw_rx.continuous = enable;
+    if (DW_WriteValue(DW_REG_SYS_MASK, 0, DW_RxIrqMask(), 4) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    if (enable) {
+        if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+            DW_CycleCounterInit();
+        }
+        if (DW_WriteValue(DW_REG_DIG_DIAG, DW_SUB_EVC_CTRL, DW_EVC_CTRL_EN, 4) != HAL_OK) {
+            return HAL_ERROR;
+        }
+        DW_RxResetCounters();
+    }
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Returns the per-cause receive counters and deaf time
+  * @param  counters: Output counters
+  * @note   The hardware counters wrap at 4096; call at least that often
+  *         (in events of any one kind) to keep the totals exact.
+  */
+void DW_RxGetCounters(DW_RxCounters_t* counters)
+{
+    uint8_t evc[2 * DW_EVC_RX_COUNT];
+    uint32_t cyc_per_us = SystemCoreClock / 1000000;
+
+    if (DW_ReadSubReg(DW_REG_DIG_DIAG, DW_SUB_EVC_PHE, evc, sizeof(evc)) == HAL_OK) {
+        for (uint8_t i = 0; i < DW_EVC_RX_COUNT; i++) {
+            uint16_t value = (evc[2 * i] | ((uint16_t)evc[2 * i + 1] << 8)) & DW_EVC_MASK;
+            dw_rx_cnt.evc_total[i] += (uint16_t)(value - dw_rx_cnt.evc_last[i]) & DW_EVC_MASK;
+            dw_rx_cnt.evc_last[i] = value;
+        }
+    }
+
+    if (!counters) return;
+
+    counters->phr_errors = dw_rx_cnt.evc_total[0];
+    counters->sync_loss = dw_rx_cnt.evc_total[1];
+    counters->fcs_good = dw_rx_cnt.evc_total[2];
+    counters->fcs_errors = dw_rx_cnt.evc_total[3];
+    counters->filter_rejects = dw_rx_cnt.evc_total[4];
+    counters->overruns = dw_rx_cnt.evc_total[5];
+    counters->sfd_timeouts = dw_rx_cnt.evc_total[6];
+    counters->preamble_timeouts = dw_rx_cnt.evc_total[7];
+    counters->frame_timeouts = dw_rx_cnt.evc_total[8];
+    counters->lde_errors = dw_rx_cnt.lde_errors;
+    counters->rx_resets = dw_rx_cnt.rx_resets;
+    counters->reenables = dw_rx_cnt.reenables;
+    counters->elapsed_ms = HAL_GetTick() - dw_rx_cnt.start_tick;
+    counters->deaf_us = cyc_per_us ? dw_rx_cnt.deaf_cycles / cyc_per_us : 0;
+    counters->deaf_max_us = cyc_per_us ? dw_rx_cnt.deaf_max_cycles / cyc_per_us : 0;
+}
+
+/**
+  * @brief  Clears the per-cause receive counters and restarts the elapsed time
+  */
+void DW_RxResetCounters(void)
+{
+    DW_RxGetCounters(NULL);
+
+    memset(dw_rx_cnt.evc_total, 0, sizeof(dw_rx_cnt.evc_total));
+    dw_rx_cnt.lde_errors = 0;
+    dw_rx_cnt.rx_resets = 0;
+    dw_rx_cnt.reenables = 0;
+    dw_rx_cnt.deaf_cycles = 0;
+    dw_rx_cnt.deaf_max_cycles = 0;
+    dw_rx_cnt.start_tick = HAL_GetTick();
+}
+
+/**
+  * @brief  Returns receive statistics
+  * @param  stats: Output statistics
+  */
+void DW_RxGetStats(DW_RxStats_t* stats)
+{
+    if (stats) {
+        *stats = dw_rx.stats;
+    }
+}
+
+/**
+  * @brief  Clears receive statistics
+  */
+void DW_RxResetStats(void)
+{
+    memset(&dw_rx.stats, 0, sizeof(dw_rx.stats));
+}
+
+/**
+  * @brief  Parses an IEEE 802.15.4 MAC header
+  * @param  data: Frame data
+  * @param  length: Frame length excluding FCS
+  * @param  hdr: Output header
+  * @retval HAL_OK if successful, HAL_ERROR if the frame is too short
+  */
+HAL_StatusTypeDef DW_MacParseHeader(const uint8_t* data, uint16_t length, DW_MacHeader_t* hdr)
+{
+    uint8_t pos = 3;
+
+    if (!data || !hdr || length < 3) {
+        return HAL_ERROR;
+    }
+
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->frame_ctrl = data[0] | ((uint16_t)data[1] << 8);
+    hdr->seq = data[2];
+
+    uint16_t dst_mode = hdr->frame_ctrl & DW_FC_DST_MODE_MASK;
+    uint16_t src_mode = hdr->frame_ctrl & DW_FC_SRC_MODE_MASK;
+    uint8_t dst_len = (dst_mode == DW_FC_DST_EXT) ? 8 : (dst_mode == DW_FC_DST_SHORT) ? 2 : 0;
+    uint8_t src_len = (src_mode == DW_FC_SRC_EXT) ? 8 : (src_mode == DW_FC_SRC_SHORT) ? 2 : 0;
+    bool src_pan = src_len && !(dst_len && (hdr->frame_ctrl & DW_FC_PANID_COMP));
+
+    if (length < pos + (dst_len ? 2 + dst_len : 0) + (src_pan ? 2 : 0) + src_len) {
+        return HAL_ERROR;
+    }
+
+    if (dst_len) {
+        hdr->dst_pan = data[pos] | ((uint16_t)data[pos + 1] << 8);
+        pos += 2;
+        for (uint8_t i = 0; i < dst_len; i++) {
+            hdr->dst_addr |= (uint64_t)data[pos++] << (8 * i);
+        }
+    }
+
+    hdr->src_pan = hdr->dst_pan;
+    if (src_pan) {
+        hdr->src_pan = data[pos] | ((uint16_t)data[pos + 1] << 8);
+        pos += 2;
+    }
+    for (uint8_t i = 0; i < src_len; i++) {
+        hdr->src_addr |= (uint64_t)data[pos++] << (8 * i);
+    }
+
+    hdr->length = pos;
+    return HAL_OK;
+}
+
+/**
+  * @brief  Enables hardware frame filtering
+  * @param  cfg: PAN ID, short address and accepted frame types
+  * @note   Rejected frames are dropped by the DW1000 without interrupting
+  *         the host and the receiver keeps listening. They are only visible
+  *         through the EVC_FFR event counter, see DW_GetFilterStats().
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_SetFrameFilter(const DW_FilterConfig_t* cfg)
+{
+    uint32_t sys_cfg = 0;
+
+    if (!cfg) {
+        return HAL_ERROR;
+    }
+
+    /* 1. Own address: short address in bytes 0-1, PAN ID in bytes 2-3 */
+    uint32_t panadr = cfg->short_addr | ((uint32_t)cfg->pan_id << 16);
+    if (DW_WriteReg(DW_REG_PANADR, (uint8_t*)&panadr, 4) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    /* 2. Start the event counters so hardware rejections can be counted */
+    if (DW_WriteValue(DW_REG_DIG_DIAG, DW_SUB_EVC_CTRL, DW_EVC_CTRL_EN, 4) != HAL_OK ||
+        DW_ReadSubReg(DW_REG_DIG_DIAG, DW_SUB_EVC_FFR, (uint8_t*)&dw_filter.evc_ffr, 2) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    /* 3. Accepted frame types */
+    if (DW_ReadReg(DW_REG_SYS_CFG, (uint8_t*)&sys_cfg, 4) != HAL_OK) {
+        return HAL_ERROR;
+    }
+    sys_cfg &= ~DW_SYS_CFG_FF_MASK;
+    sys_cfg |= DW_SYS_CFG_FFEN | (cfg->frame_types & (DW_SYS_CFG_FF_MASK & ~(DW_SYS_CFG_FFEN | DW_SYS_CFG_FFBC)));
+    if (cfg->coordinator) {
+        sys_cfg |= DW_SYS_CFG_FFBC;
+    }
+
+    return DW_WriteReg(DW_REG_SYS_CFG, (uint8_t*)&sys_cfg, 4);
+}
+
+/**
+  * @brief  Disables hardware frame filtering, all frames are received
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_DisableFrameFilter(void)
+{
+    uint32_t sys_cfg = 0;
+
+    if (DW_ReadReg(DW_REG_SYS_CFG, (uint8_t*)&sys_cfg, 4) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    sys_cfg &= ~DW_SYS_CFG_FF_MASK;
+    return DW_WriteReg(DW_REG_SYS_CFG, (uint8_t*)&sys_cfg, 4);
+}
+
+/**
+  * @brief  Sets the software filter applied to frames that passed the hardware
+  * @param  filter: Filter settings, NULL accepts every frame
+  */
+void DW_SetSoftwareFilter(const DW_SwFilter_t* filter)
+{
+    memset(&dw_filter.sw, 0, sizeof(dw_filter.sw));
+    memset(dw_filter.dup, 0, sizeof(dw_filter.dup));
+    dw_filter.dup_next = 0;
+
+    if (filter) {
+        dw_filter.sw = *filter;
+        if (dw_filter.sw.src_allow_count > DW_SW_FILTER_MAX_SRC) {
+            dw_filter.sw.src_allow_count = DW_SW_FILTER_MAX_SRC;
+        }
+    }
+}
+
+/**
+  * @brief  Returns the frame filter counters
+  * @param  stats: Output statistics
+  * @note   EVC_FFR is only 12 bits wide; call at least every 4095 rejected
+  *         frames to keep hw_rejected exact.
+  */
+void DW_GetFilterStats(DW_FilterStats_t* stats)
+{
+    uint16_t ffr = 0;
+
+    if (DW_ReadSubReg(DW_REG_DIG_DIAG, DW_SUB_EVC_FFR, (uint8_t*)&ffr, 2) == HAL_OK) {
+        dw_filter.stats.hw_rejected += (uint16_t)(ffr - dw_filter.evc_ffr) & DW_EVC_MASK;
+        dw_filter.evc_ffr = ffr;
+    }
+
+    if (stats) {
+        *stats = dw_filter.stats;
+    }
+}
+
+/**
+  * @brief  Clears the frame filter counters
+  */
+void DW_ResetFilterStats(void)
+{
+    DW_GetFilterStats(NULL);
+    memset(&dw_filter.stats, 0, sizeof(dw_filter.stats));
+}
+
+/**
+  * @brief  Clocks a prepared buffer (SPI header + data) out to the DW1000
+  * @param  buf: Buffer starting with the transaction header
+  * @param  length: Total number of bytes including the header
+  * @note   Uses the SPI TX DMA channel when one is linked to hspi1
+  * @retval HAL_OK on success, HAL_ERROR on failure
+  */
+static HAL_StatusTypeDef DW_SpiTransmit(const uint8_t* buf, uint16_t length)
+{
+    HAL_StatusTypeDef status;
+
+    HAL_GPIO_WritePin(SPICS_GPIO_Port, SPICS_Pin, GPIO_PIN_RESET);
+    if (hspi1.hdmatx != NULL) {
+        status = HAL_SPI_Transmit_DMA(&hspi1, (uint8_t*)buf, length);
+        if (status == HAL_OK) {
+            status = DW_SpiDmaWait();
+        }
+    } else {
+        status = HAL_SPI_Transmit(&hspi1, (uint8_t*)buf, length, HAL_MAX_DELAY);
+    }
+    HAL_GPIO_WritePin(SPICS_GPIO_Port, SPICS_Pin, GPIO_PIN_SET);
+
+    return (status == HAL_OK) ? HAL_OK : HAL_ERROR;
+}
+
+/**
+  * @brief  Clocks data in from the DW1000 (chip select already asserted)
+  * @param  buf: Output buffer
+  * @param  length: Number of bytes to read
+  * @note   Long reads use the SPI DMA channels when both are linked to hspi1
+  *         (the master clocks dummy bytes out through the TX channel).
+  * @retval HAL_OK on success, HAL_ERROR on failure
+  */
+static HAL_StatusTypeDef DW_SpiReceive(uint8_t* buf, uint16_t length)
+{
+    HAL_StatusTypeDef status;
+
+    if (length >= DW_SPI_DMA_MIN && hspi1.hdmarx != NULL && hspi1.hdmatx != NULL) {
+        status = HAL_SPI_Receive_DMA(&hspi1, buf, length);
+        if (status == HAL_OK) {
+            status = DW_SpiDmaWait();
+        }
+    } else {
+        status = HAL_SPI_Receive(&hspi1, buf, length, HAL_MAX_DELAY);
+    }
+
+    return (status == HAL_OK) ? HAL_OK : HAL_ERROR;
+}
+
+/**
+  * @brief  Waits for the DMA transfer started on hspi1 to complete
+  * @note   The transfer is aborted if it does not complete in time, e.g.
+  *         when the DMA interrupt is not enabled.
+  * @retval HAL_OK on completion, HAL_TIMEOUT if aborted
+  */
+static HAL_StatusTypeDef DW_SpiDmaWait(void)
+{
+    uint32_t start = HAL_GetTick();
+
+    while (HAL_SPI_GetState(&hspi1) != HAL_SPI_STATE_READY) {
+        if (HAL_GetTick() - start > DW_SPI_DMA_TIMEOUT_MS) {
+            HAL_SPI_Abort(&hspi1);
+            return HAL_TIMEOUT;
+        }
+    }
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Converts a TXPSR/PE preamble length code to symbols
+  * @param  plen: Preamble length code
+  * @retval Preamble length in symbols
+  */
+static uint16_t DW_PreambleSymbols(DW_PreambleLen_t plen)
+{
+    switch (plen) {
+        case DW_PLEN_64:   return 64;
+        case DW_PLEN_128:  return 128;
+        case DW_PLEN_256:  return 256;
+        case DW_PLEN_512:  return 512;
+        case DW_PLEN_1024: return 1024;
+        case DW_PLEN_1536: return 1536;
+        case DW_PLEN_2048: return 2048;
+        default:           return 4096;
+    }
+}
+
+/**
+  * @brief  Reads a 40-bit timestamp
+  * @param  reg_addr: Register holding the timestamp
+  * @param  offset: Sub-address of the timestamp
+  * @param  ts: Output timestamp
+  * @retval HAL_OK on success, HAL_ERROR on failure
+  */
+static HAL_StatusTypeDef DW_ReadTimestamp(uint8_t reg_addr, uint16_t offset, DW_Time_t* ts)
+{
+    uint8_t raw[DW_TIME_BYTES];
+
+    if (DW_ReadSubReg(reg_addr, offset, raw, sizeof(raw)) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    *ts = DW_TimeUnpack(raw);
+    return HAL_OK;
+}
+
+/**
+  * @brief  Finishes the pending transmission and reports it
+  * @param  status: Completion status
+  */
+static void DW_TxComplete(DW_TxStatus_t status)
+{
+    DW_Event_t evt = { .type = DW_EVENT_TX_DONE };
+
+    dw_tx.pending = false;
+    DW_ClearStatus(SYS_STATUS_ALL_TX);
+
+    evt.tx.handle = dw_tx.handle;
+    evt.tx.status = status;
+    evt.tx.tx_time = 0;
+    if (status == DW_TX_OK && dw_tx.timestamping &&
+        DW_ReadTimestamp(DW_REG_TX_TIME, 0, &evt.tx.tx_time) != HAL_OK) {
+        evt.tx.status = DW_TX_NO_STAMP;
+    }
+
+    DW_PostEvent(&evt);
+}
+
+/**
+  * @brief  Cancels a delayed TX whose start time had already passed
+  * @note   Left alone, the frame would go out one counter wrap (~17 s) later.
+  *         TRXOFF also turns off a receiver enabled after the frame.
+  */
+static void DW_TxAbortLate(void)
+{
+    uint32_t sys_ctrl = SYS_CTRL_TRXOFF;
+
+    DW_WriteReg(DW_REG_SYS_CTRL, (uint8_t*)&sys_ctrl, 4);
+    DW_ClearStatus(SYS_STATUS_HPDWARN);
+    dw_rx.enabled = false;
+    DW_TxComplete(DW_TX_LATE);
+}
+
+/**
+  * @brief  Delivers an event to the callback or the queue
+  * @param  evt: Event to deliver
+  */
+static void DW_PostEvent(const DW_Event_t* evt)
+{
+    if (dw_event_cb) {
+        dw_event_cb(evt);
+        return;
+    }
+
+    uint8_t head = dw_event_head;
+    uint8_t next = (head + 1) & (DW_EVENT_QUEUE_LEN - 1);
+    if (next == dw_event_tail) {
+        dw_event_drops++;
+        if (evt->type == DW_EVENT_RX_FRAME) {
+            DW_PoolFree(evt->rx.frame);
+        }
+        return;
+    }
+
+    dw_event_queue[head] = *evt;
+    dw_event_head = next;
+}
+
+/**
+  * @brief  Handles receiver status bits and posts RX events
+  * @param  status: SYS_STATUS low 32 bits
+  * @note   In double-buffered mode frames are drained in order: after each
+  *         frame the host side pointer is toggled and the other buffer is
+  *         checked before returning.
+  */
+static void DW_RxService(uint32_t status)
+{
+    uint32_t sys_ctrl;
+
+    while (dw_rx.enabled) {
+        DW_Event_t evt = { .type = DW_EVENT_NONE };
+        bool deliver = true;
+
+        if (status & SYS_STATUS_AFFREJ) {
+            /* Dropped by the frame filter, the receiver is still listening */
+            DW_ClearStatus(SYS_STATUS_AFFREJ);
+            status &= ~SYS_STATUS_AFFREJ;
+        }
+
+        if (status & SYS_STATUS_RXOVRR) {
+            /* 1. Both buffers were full: frames lost, pointers out of step */
+            evt.type = DW_EVENT_RX_ERROR;
+            evt.rx.status = DW_RX_ERR_OVERRUN;
+            dw_rx.stats.overruns++;
+
+            DW_RxMarkDeaf();
+            DW_RxReset();
+            DW_ClearStatus(SYS_STATUS_ALL_RX_GOOD | SYS_STATUS_ALL_RX_ERR | SYS_STATUS_ALL_RX_TO);
+            if (dw_rx.double_buffer) {
+                DW_RxEnable();
+            }
+            DW_PostEvent(&evt);
+            return;
+        }
+
+        if (status & SYS_STATUS_RXFCG) {
+            /* 2. Good frame: keep listening into the other buffer first */
+            if (dw_rx.double_buffer) {
+                DW_RxRearm();
+            } else {
+                DW_RxMarkDeaf();
+            }
+
+            /* Read only the reported length, straight into a pool buffer */
+            evt.type = DW_EVENT_RX_FRAME;
+            evt.rx.status = (status & SYS_STATUS_LDEERR) ? DW_RX_ERR_LDE : DW_RX_OK;
+            evt.rx.rx_time = 0;
+            evt.rx.clock_offset_ppb = DW_RX_OFFSET_INVALID;
+
+            if (DW_RxFetchFrame(&evt.rx, &deliver) != HAL_OK) {
+                evt.type = DW_EVENT_RX_ERROR;
+                evt.rx.status = DW_RX_ERR_BUFFER;
+                dw_rx.stats.errors++;
+            } else if (deliver) {
+                if (evt.rx.status == DW_RX_OK) {
+                    DW_RxReadTimestamp(&evt.rx.rx_time);
+                    DW_RxReadClockOffset(&evt.rx.clock_offset_ppb);
+                    if (dw_rx.quality) {
+                        DW_RxReadQuality(&evt.rx.quality);
+                    }
+                }
+                dw_rx.stats.frames++;
+            }
+
+            DW_ClearStatus(SYS_STATUS_ALL_RX_GOOD | SYS_STATUS_LDEERR);
+        } else if (status & (SYS_STATUS_ALL_RX_ERR | SYS_STATUS_ALL_RX_TO)) {
+            /* 3. Error or timeout: the receiver is off now */
+            evt.rx.status = DW_RxClassifyStatus(status);
+            if (evt.rx.status >= DW_RX_TIMEOUT_FRAME) {
+                evt.type = DW_EVENT_RX_TIMEOUT;
+                dw_rx.stats.timeouts++;
+            } else {
+                evt.type = DW_EVENT_RX_ERROR;
+                dw_rx.stats.errors++;
+                if (evt.rx.status == DW_RX_ERR_LDE) {
+                    dw_rx_cnt.lde_errors++;
+                }
+            }
+
+            DW_ClearStatus(SYS_STATUS_ALL_RX_GOOD | SYS_STATUS_ALL_RX_ERR | SYS_STATUS_ALL_RX_TO);
+
+            if (dw_rx.continuous) {
+                /* RXAUTR has re-enabled the receiver after an error; only
+                 * a timeout leaves it off. Nothing is reported either way. */
+                if (evt.type == DW_EVENT_RX_TIMEOUT) {
+                    DW_RxMarkDeaf();
+                    DW_RxRearm();
+                }
+                return;
+            }
+
+            if (evt.rx.status == DW_RX_ERR_LDE) {
+                /* The reset turned RX off: resync the pointers and the flag */
+                DW_RxReset();
+                if (dw_rx.double_buffer) {
+                    DW_RxEnable();
+                }
+            } else if (dw_rx.double_buffer) {
+                DW_RxRearm();
+            }
+        } else {
+            return;
+        }
+
+        if (!dw_rx.double_buffer) {
+            dw_rx.enabled = false;
+            if (deliver) {
+                DW_PostEvent(&evt);
+            }
+            if (!deliver || dw_rx.continuous) {
+                DW_RxEnable();  // Filtered in software or continuous listen
+            }
+            return;
+        }
+
+        /* 4. Errors do not consume a buffer, the receiver is re-armed */
+        if (deliver) {
+            DW_PostEvent(&evt);
+        }
+        if (evt.type != DW_EVENT_RX_FRAME && evt.rx.status != DW_RX_ERR_BUFFER) {
+            return;
+        }
+
+        /* 5. Hand the buffer back to the IC and look at the other one */
+        sys_ctrl = SYS_CTRL_HRBPT;
+        DW_WriteReg(DW_REG_SYS_CTRL, (uint8_t*)&sys_ctrl, 4);
+        status = DW_ReadStatus();
+    }
+}
+
+/**
+  * @brief  Issues RXENAB while the driver already considers RX enabled
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+static HAL_StatusTypeDef DW_RxRearm(void)
+{
+    uint32_t sys_ctrl = SYS_CTRL_RXENAB;
+
+    if (DW_WriteReg(DW_REG_SYS_CTRL, (uint8_t*)&sys_ctrl, 4) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    dw_rx_cnt.reenables++;
+    DW_RxMarkListening();
+    return HAL_OK;
+}
+
+/**
+  * @brief  Starts a deaf interval (receiver found off) in continuous mode
+  */
+static void DW_RxMarkDeaf(void)
+{
+    if (dw_rx.continuous && !dw_rx_cnt.deaf) {
+        dw_rx_cnt.deaf = true;
+        dw_rx_cnt.deaf_start = DW_Cycles();
+    }
+}
+
+/**
+  * @brief  Ends the current deaf interval, if any
+  */
+static void DW_RxMarkListening(void)
+{
+    if (!dw_rx_cnt.deaf) {
+        return;
+    }
+
+    uint32_t cycles = DW_Cycles() - dw_rx_cnt.deaf_start;
+    dw_rx_cnt.deaf = false;
+    dw_rx_cnt.deaf_cycles += cycles;
+    if (cycles > dw_rx_cnt.deaf_max_cycles) {
+        dw_rx_cnt.deaf_max_cycles = cycles;
+    }
+}
+
+/**
+  * @brief  Returns the SYS_MASK value for the current receive mode
+  * @note   Frames rejected by the frame filter never wake the host. In
+  *         continuous mode neither do errors the DW1000 recovers from itself.
+  * @retval SYS_MASK bits
+  */
+static uint32_t DW_RxIrqMask(void)
+{
+    uint32_t mask = SYS_STATUS_TXFRS | SYS_STATUS_RXFCG | SYS_STATUS_ALL_RX_TO;
+
+    if (dw_rx.continuous) {
+        return mask | SYS_STATUS_RXOVRR;
+    }
+    return mask | (SYS_STATUS_ALL_RX_ERR & ~SYS_STATUS_AFFREJ);
+}
+
+/**
+  * @brief  Reads the received frame into a pool buffer
+  * @param  rx: Event to fill in (info and frame)
+  * @param  keep: Set to false if the frame was filtered out and freed
+  * @note   With a classifier set, only the header is read first and the
+  *         classifier decides on those bytes. The software filter runs on
+  *         the whole frame, as header_len may not cover the MAC header.
+  * @retval HAL_OK if successful, HAL_ERROR if no buffer or SPI failure
+  */
+static HAL_StatusTypeDef DW_RxFetchFrame(DW_RxEvent_t* rx, bool* keep)
+{
+    rx->frame = NULL;
+    *keep = true;
+
+    if (DW_RxReadInfo(&rx->info) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    rx->frame = DW_PoolAlloc(rx->info.length);
+    if (!rx->frame) {
+        return HAL_ERROR;
+    }
+
+    uint16_t head = rx->info.length;
+    if (dw_rx.classifier && dw_rx.header_len < head) {
+        head = dw_rx.header_len;
+    }
+
+    /* 1. Header (or whole frame) */
+    if (head > 0 && DW_ReadSubReg(DW_REG_RX_BUFFER, 0, rx->frame->data, head) != HAL_OK) {
+        DW_PoolFree(rx->frame);
+        rx->frame = NULL;
+        return HAL_ERROR;
+    }
+
+    /* 2. Classify on what has been read so far */
+    if (dw_rx.classifier && !dw_rx.classifier(rx->frame->data, (uint8_t)head, &rx->info)) {
+        dw_rx.stats.discarded++;
+        DW_PoolFree(rx->frame);
+        rx->frame = NULL;
+        *keep = false;
+        return HAL_OK;
+    }
+
+    /* 3. Remainder of the frame */
+    if (head < rx->info.length &&
+        DW_ReadSubReg(DW_REG_RX_BUFFER, head, rx->frame->data + head, rx->info.length - head) != HAL_OK) {
+        DW_PoolFree(rx->frame);
+        rx->frame = NULL;
+        return HAL_ERROR;
+    }
+
+    /* 4. Software filter on the complete MAC header */
+    if (!DW_SwFilterAccept(rx->frame->data, rx->info.length)) {
+        DW_PoolFree(rx->frame);
+        rx->frame = NULL;
+        *keep = false;
+    }
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Applies the software filter to a received frame
+  * @param  data: Frame data
+  * @param  length: Frame length excluding FCS
+  * @retval true to deliver the frame, false to drop it
+  */
+static bool DW_SwFilterAccept(const uint8_t* data, uint16_t length)
+{
+    DW_MacHeader_t hdr;
+    uint8_t i;
+
+    if (dw_filter.sw.src_allow_count == 0 && !dw_filter.sw.drop_duplicates) {
+        dw_filter.stats.accepted++;
+        return true;
+    }
+
+    /* Without a short source address neither check applies */
+    if (DW_MacParseHeader(data, length, &hdr) != HAL_OK ||
+        (hdr.frame_ctrl & DW_FC_SRC_MODE_MASK) != DW_FC_SRC_SHORT) {
+        if (dw_filter.sw.src_allow_count) {
+            dw_filter.stats.sw_rejected++;
+            return false;
+        }
+        dw_filter.stats.accepted++;
+        return true;
+    }
+
+    uint16_t src = (uint16_t)hdr.src_addr;
+
+    /* 1. Source allow-list */
+    if (dw_filter.sw.src_allow_count) {
+        for (i = 0; i < dw_filter.sw.src_allow_count; i++) {
+            if (dw_filter.sw.src_allow[i] == src) break;
+        }
+        if (i == dw_filter.sw.src_allow_count) {
+            dw_filter.stats.sw_rejected++;
+            return false;
+        }
+    }
+
+    /* 2. Retransmission of the last frame seen from this source */
+    if (dw_filter.sw.drop_duplicates) {
+        for (i = 0; i < DW_SW_FILTER_DUP_CACHE; i++) {
+            if (dw_filter.dup[i].valid && dw_filter.dup[i].src == src) break;
+        }
+        if (i < DW_SW_FILTER_DUP_CACHE) {
+            if (dw_filter.dup[i].seq == hdr.seq) {
+                dw_filter.stats.sw_duplicates++;
+                return false;
+            }
+        } else {
+            i = dw_filter.dup_next;
+            dw_filter.dup_next = (uint8_t)((i + 1) % DW_SW_FILTER_DUP_CACHE);
+            dw_filter.dup[i].src = src;
+            dw_filter.dup[i].valid = true;
+        }
+        dw_filter.dup[i].seq = hdr.seq;
+    }
+
+    dw_filter.stats.accepted++;
+    return true;
+}
+
+/**
+  * @brief  Turns the transceiver off and soft-resets the receiver
+  * @note   Used to recover the receiver after an overrun or LDE error
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+static HAL_StatusTypeDef DW_RxReset(void)
+{
+    uint8_t softreset;
+
+    if (DW_RxDisable() != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    dw_rx_cnt.rx_resets++;
+
+    softreset = 0xE0;  // Clear RX reset bit (SOFTRESET[28])
+    if (DW_WriteSubReg(DW_REG_PMSC, DW_SUB_PMSC_CTRL0 + 3, &softreset, 1) != HAL_OK) {
+        return HAL_ERROR;
+    }
+    softreset = 0xF0;
+    return DW_WriteSubReg(DW_REG_PMSC, DW_SUB_PMSC_CTRL0 + 3, &softreset, 1);
+}
@@ -0,0 +1,535 @@
+/**
+  * @file    DW_AntCal.c
+  * @brief   Three-node antenna delay calibration and its flash storage
+  * @author  36dhe
+  * @date    Jul 18, 2025
+  */
+
+#include "DW_AntCal.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Private Variables */
+
+/* Flash record, programmed as half-words */
+typedef struct {
+    uint16_t magic;             // DW_ANTCAL_MAGIC
+    uint8_t channel;            // PHY the delays were measured with
+    uint8_t prf;
+    uint16_t tx_antd;
+    uint16_t rx_antd;
+    uint16_t check;             // ~sum of the half-words above
+} DW_AntCalRecord_t;
+
+static struct {
+    DW_AntCalConfig_t cfg;
+    DW_AntCalState_t state;
+    bool started;               // Start() called or a report seen
+    uint32_t progress_tick;     // Start or last report, for the timeout
+    bool handover;              // Previous node reported, our turn is next
+    uint32_t handover_tick;
+    /* Own measurement */
+    uint8_t peer;               // Node being ranged to
+    uint16_t got;
+    uint16_t tries;
+    int64_t tof_sum;
+    /* Mean ToF in 1/16 ticks, row: measuring node, column: peer */
+    bool have[DW_ANTCAL_NODES];
+    int32_t tof_q4[DW_ANTCAL_NODES][DW_ANTCAL_NODES];
+    DW_AntCalResult_t result;
+} dw_antcal;
+
+/* Private Function Prototypes */
+static HAL_StatusTypeDef DW_AntCalRangeTo(uint8_t peer);
+static HAL_StatusTypeDef DW_AntCalListen(void);
+static HAL_StatusTypeDef DW_AntCalMeasure(void);
+static HAL_StatusTypeDef DW_AntCalSendReport(void);
+static bool DW_AntCalReport(const DW_RxEvent_t* rx);
+static void DW_AntCalSolve(void);
+static uint8_t DW_AntCalPair(uint8_t a, uint8_t b);
+static uint16_t DW_AntCalCheck(const DW_AntCalRecord_t* rec);
+
+/* Exported Functions */
+
+/**
+  * @brief  Prepares this node for calibration
+  * @param  cfg: Node index, addresses and surveyed distances, the same on
+  *         all three nodes except for the index
+  * @note   Call after DW_AntCalLoad() or DW_SetAntennaDelay(): the current
+  *         delays are the starting point and any starting point works.
+  *         Nodes 1 and 2 answer polls from here on and start ranging by
+  *         themselves when their turn comes.
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_AntCalInit(const DW_AntCalConfig_t* cfg)
+{
+    if (!cfg || cfg->node >= DW_ANTCAL_NODES) return HAL_ERROR;
+
+    memset(&dw_antcal, 0, sizeof(dw_antcal));
+    dw_antcal.cfg = *cfg;
+    if (dw_antcal.cfg.ranges == 0) {
+        dw_antcal.cfg.ranges = DW_ANTCAL_RANGES;
+    }
+
+    if (DW_GetAntennaDelay(&dw_antcal.result.tx_antd, &dw_antcal.result.rx_antd) != HAL_OK ||
+        DW_AntCalListen() != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    dw_antcal.state = (cfg->node == 0) ? DW_ANTCAL_IDLE : DW_ANTCAL_WAIT;
+    return HAL_OK;
+}
+
+/**
+  * @brief  Starts the procedure (node 0, once the other nodes are listening)
+  * @retval HAL_OK if started, HAL_ERROR if not node 0 or already started
+  */
+HAL_StatusTypeDef DW_AntCalStart(void)
+{
+    if (dw_antcal.cfg.node != 0 || dw_antcal.state != DW_ANTCAL_IDLE) {
+        return HAL_ERROR;
+    }
+
+    dw_antcal.started = true;
+    dw_antcal.progress_tick = HAL_GetTick();
+    return DW_AntCalRangeTo(1);
+}
+
+/**
+  * @brief  Runs the procedure; call from the main loop
+  * @note   Polls are answered from here, so the loop must come round
+  *         within the reply delay.
+  * @retval HAL_OK while running or finished, HAL_ERROR once it has failed
+  */
+HAL_StatusTypeDef DW_AntCalRun(void)
+{
+    DW_Event_t evt;
+    DW_RangeResult_t range;
+
+    if (dw_antcal.state == DW_ANTCAL_FAILED) return HAL_ERROR;
+
+    /* 1. Nothing moves for too long: a node or a report is missing */
+    if (dw_antcal.started && dw_antcal.state != DW_ANTCAL_DONE &&
+        HAL_GetTick() - dw_antcal.progress_tick > DW_ANTCAL_TIMEOUT_MS) {
+        dw_antcal.state = DW_ANTCAL_FAILED;
+        DW_RxDisable();
+        return HAL_ERROR;
+    }
+
+    /* 2. Reports first, everything else goes to the ranging state machine */
+    DW_ProcessEvents();
+    while (DW_GetEvent(&evt)) {
+        if (evt.type == DW_EVENT_RX_FRAME && DW_AntCalReport(&evt.rx)) {
+            DW_PoolFree(evt.rx.frame);
+            continue;
+        }
+        if (dw_antcal.state != DW_ANTCAL_DONE && dw_antcal.state != DW_ANTCAL_FAILED &&
+            DW_RangingHandleEvent(&evt, &range) && dw_antcal.state == DW_ANTCAL_MEASURE &&
+            range.peer == dw_antcal.cfg.addr[dw_antcal.peer]) {
+            dw_antcal.tof_sum += range.tof_ticks;
+            dw_antcal.got++;
+        }
+        if (evt.type == DW_EVENT_RX_FRAME) {
+            DW_PoolFree(evt.rx.frame);
+        }
+    }
+
+    /* 3. Our turn, once the previous node has switched to answering */
+    if (dw_antcal.state == DW_ANTCAL_WAIT && dw_antcal.handover &&
+        HAL_GetTick() - dw_antcal.handover_tick >= DW_ANTCAL_HANDOVER_MS) {
+        dw_antcal.handover = false;
+        if (DW_AntCalRangeTo(dw_antcal.cfg.node == 0 ? 1 : 0) != HAL_OK) {
+            dw_antcal.state = DW_ANTCAL_FAILED;
+        }
+    }
+
+    if (dw_antcal.state == DW_ANTCAL_MEASURE && !DW_RangingBusy() &&
+        DW_AntCalMeasure() != HAL_OK) {
+        dw_antcal.state = DW_ANTCAL_FAILED;
+        DW_RxDisable();
+    }
+
+    return (dw_antcal.state == DW_ANTCAL_FAILED) ? HAL_ERROR : HAL_OK;
+}
+
+/**
+  * @brief  Returns the state and, once done, the new delays
+  * @param  result: Output result
+  */
+void DW_AntCalGetResult(DW_AntCalResult_t* result)
+{
+    if (result) {
+        *result = dw_antcal.result;
+        result->state = dw_antcal.state;
+    }
+}
+
+/**
+  * @brief  Prints the calibration result
+  */
+void DW_AntCalPrintResult(void)
+{
+    static const char* const pair_names[DW_ANTCAL_NODES] = { "0-1", "0-2", "1-2" };
+    DW_AntCalResult_t res;
+
+    DW_AntCalGetResult(&res);
+
+    if (res.state != DW_ANTCAL_DONE) {
+        printf("Antenna calibration node %u: %s, %lu ranges, %lu failed\n",
+               dw_antcal.cfg.node, res.state == DW_ANTCAL_FAILED ? "failed" : "running",
+               (unsigned long)res.ranges, (unsigned long)res.failed);
+        return;
+    }
+
+    printf("Antenna calibration node %u: TX_ANTD %u, RX_ANTD %u (correction %ld ticks)\n",
+           dw_antcal.cfg.node, res.tx_antd, res.rx_antd, (long)res.correction_ticks);
+    for (uint8_t p = 0; p < DW_ANTCAL_NODES; p++) {
+        printf("  Pair %s: error %ld mm, asymmetry %ld mm\n", pair_names[p],
+               (long)res.pair_error_mm[p], (long)res.pair_asym_mm[p]);
+    }
+    printf("  Ranges %lu, failed %lu\n", (unsigned long)res.ranges, (unsigned long)res.failed);
+}
+
+/**
+  * @brief  Applies the stored antenna delays, or the defaults without any
+  * @note   Call at boot after DW_Configure(). A record made on another
+  *         channel or PRF is not used.
+  * @retval true if calibrated delays were applied
+  */
+bool DW_AntCalLoad(void)
+{
+    const DW_AntCalRecord_t* rec = (const DW_AntCalRecord_t*)DW_ANTCAL_FLASH_ADDR;
+    const DW_PhyConfig_t* phy = DW_GetPhyConfig();
+
+    if (rec->magic == DW_ANTCAL_MAGIC && rec->check == DW_AntCalCheck(rec) &&
+        rec->channel == phy->channel && rec->prf == (uint8_t)phy->prf &&
+        DW_SetAntennaDelay(rec->tx_antd, rec->rx_antd) == HAL_OK) {
+        return true;
+    }
+
+    DW_SetAntennaDelay(DW_ANTCAL_DEFAULT_ANTD, DW_ANTCAL_DEFAULT_ANTD);
+    return false;
+}
+
+/**
+  * @brief  Writes antenna delays for the current channel and PRF to flash
+  * @param  tx_antd: TX_ANTD in ticks
+  * @param  rx_antd: LDE_RXANTD in ticks
+  * @note   The page is only erased when the record changes. Flash is not
+  *         readable while it is written (~20 ms for the erase).
+  * @retval HAL_OK if stored and verified, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_AntCalSave(uint16_t tx_antd, uint16_t rx_antd)
+{
+    const DW_PhyConfig_t* phy = DW_GetPhyConfig();
+    DW_AntCalRecord_t rec = {
+        .magic = DW_ANTCAL_MAGIC,
+        .channel = phy->channel,
+        .prf = (uint8_t)phy->prf,
+        .tx_antd = tx_antd,
+        .rx_antd = rx_antd
+    };
+    FLASH_EraseInitTypeDef erase = {
+        .TypeErase = FLASH_TYPEERASE_PAGES,
+        .PageAddress = DW_ANTCAL_FLASH_ADDR,
+        .NbPages = 1
+    };
+    const uint16_t* hw = (const uint16_t*)&rec;
+    uint32_t page_error = 0;
+    HAL_StatusTypeDef status;
+
+    rec.check = DW_AntCalCheck(&rec);
+    if (memcmp((const void*)DW_ANTCAL_FLASH_ADDR, &rec, sizeof(rec)) == 0) {
+        return HAL_OK;
+    }
+
+    HAL_FLASH_Unlock();
+    status = HAL_FLASHEx_Erase(&erase, &page_error);
+    for (uint32_t i = 0; status == HAL_OK && i < sizeof(rec) / 2; i++) {
+        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, DW_ANTCAL_FLASH_ADDR + 2 * i, hw[i]);
+    }
+    HAL_FLASH_Lock();
+
+    if (status != HAL_OK || memcmp((const void*)DW_ANTCAL_FLASH_ADDR, &rec, sizeof(rec)) != 0) {
+        return HAL_ERROR;
+    }
+    return HAL_OK;
+}
+
+/* Private Functions */
+
+/**
+  * @brief  Starts ranging to one peer as initiator
+  * @param  peer: Node index
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+static HAL_StatusTypeDef DW_AntCalRangeTo(uint8_t peer)
+{
+    const DW_RangingConfig_t rng_cfg = {
+        .role = DW_RNG_ROLE_INITIATOR,
+        .method = DW_RNG_SS_TWR,
+        .pan_id = dw_antcal.cfg.pan_id,
+        .short_addr = dw_antcal.cfg.addr[dw_antcal.cfg.node],
+        .peer_addr = dw_antcal.cfg.addr[peer],
+        .reply_delay_us = dw_antcal.cfg.reply_delay_us,
+        .bias_correction = true
+    };
+
+    DW_RxDisable();
+    dw_antcal.peer = peer;
+    dw_antcal.got = 0;
+    dw_antcal.tries = 0;
+    dw_antcal.tof_sum = 0;
+    dw_antcal.state = DW_ANTCAL_MEASURE;
+    return DW_RangingInit(&rng_cfg);
+}
+
+/**
+  * @brief  Answers polls of the other nodes (SS-TWR responder)
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+static HAL_StatusTypeDef DW_AntCalListen(void)
+{
+    const DW_RangingConfig_t rng_cfg = {
+        .role = DW_RNG_ROLE_RESPONDER,
+        .method = DW_RNG_SS_TWR,
+        .pan_id = dw_antcal.cfg.pan_id,
+        .short_addr = dw_antcal.cfg.addr[dw_antcal.cfg.node],
+        .reply_delay_us = dw_antcal.cfg.reply_delay_us
+    };
+
+    return DW_RangingInit(&rng_cfg);
+}
+
+/**
+  * @brief  Starts the next exchange, or moves on once a peer is done
+  * @note   Called whenever no exchange is in progress.
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+static HAL_StatusTypeDef DW_AntCalMeasure(void)
+{
+    uint8_t self = dw_antcal.cfg.node;
+
+    if (dw_antcal.got < dw_antcal.cfg.ranges) {
+        if (dw_antcal.tries >= (uint32_t)dw_antcal.cfg.ranges * DW_ANTCAL_ATTEMPTS) {
+            return HAL_ERROR;
+        }
+        /* A poll that does not start is a failed try like a timeout */
+        dw_antcal.tries++;
+        DW_RangingStart();
+        return HAL_OK;
+    }
+
+    /* 1. Mean ToF to this peer, rounded to 1/16 tick */
+    int64_t sum_q4 = dw_antcal.tof_sum * 16;
+    dw_antcal.tof_q4[self][dw_antcal.peer] =
+        (int32_t)((sum_q4 + (sum_q4 >= 0 ? 1 : -1) * (dw_antcal.got / 2)) / dw_antcal.got);
+    dw_antcal.result.ranges += dw_antcal.got;
+    dw_antcal.result.failed += dw_antcal.tries - dw_antcal.got;
+
+    /* 2. Next peer, the one that is neither us nor the current one */
+    uint8_t next = (uint8_t)(DW_ANTCAL_NODES - self - dw_antcal.peer);
+    if (next > dw_antcal.peer) {
+        return DW_AntCalRangeTo(next);
+    }
+
+    /* 3. Both peers done: report, which hands over to the next node */
+    dw_antcal.have[self] = true;
+    dw_antcal.progress_tick = HAL_GetTick();
+    if (DW_AntCalSendReport() != HAL_OK || DW_AntCalListen() != HAL_OK) {
+        return HAL_ERROR;
+    }
+    dw_antcal.state = DW_ANTCAL_WAIT;
+
+    /* Node 1's report alone hands over to us; node 0's may still be missing */
+    if (dw_antcal.have[0] && dw_antcal.have[1] && dw_antcal.have[2]) {
+        DW_AntCalSolve();
+    }
+    return HAL_OK;
+}
+
+/**
+  * @brief  Broadcasts our mean times of flight, DW_ANTCAL_REPORT_REPEAT times
+  * @note   Blocks for a few milliseconds; nobody polls us meanwhile.
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+static HAL_StatusTypeDef DW_AntCalSendReport(void)
+{
+    DW_FrameBuilder_t fb;
+    DW_Event_t evt;
+    uint8_t self = dw_antcal.cfg.node;
+    uint8_t* p;
+
+    DW_RxDisable();
+    if (DW_EnableTxMode(DW_TX_MODE_STANDARD) != HAL_OK) return HAL_ERROR;
+
+    for (uint8_t r = 0; r < DW_ANTCAL_REPORT_REPEAT; r++) {
+        DW_FrameBegin(&fb);
+        if (DW_FrameWriteMacHeader(&fb, DW_FC_TYPE_DATA, r, dw_antcal.cfg.pan_id,
+                                   0xFFFF, dw_antcal.cfg.addr[self]) != HAL_OK ||
+            (p = DW_FrameReserve(&fb, DW_ANTCAL_REPORT_LEN - DW_MAC_HDR_SHORT_LEN)) == NULL) {
+            return HAL_ERROR;
+        }
+
+        *p++ = DW_ANTCAL_FC_REPORT;
+        *p++ = self;
+        for (uint8_t n = 0; n < DW_ANTCAL_NODES; n++) {
+            if (n == self) continue;
+            uint32_t v = (uint32_t)dw_antcal.tof_q4[self][n];
+            for (uint8_t i = 0; i < 4; i++) {
+                *p++ = (uint8_t)(v >> (8 * i));
+            }
+        }
+
+        if (DW_FrameSend(&fb) != HAL_OK || DW_WaitTxDone(5) != HAL_OK) {
+            return HAL_ERROR;
+        }
+        /* Receivers re-enable from their main loop between repeats */
+        HAL_Delay(1);
+    }
+
+    /* The completions are ours, not the responder's */
+    while (DW_GetEvent(&evt)) {
+        if (evt.type == DW_EVENT_RX_FRAME) {
+            DW_PoolFree(evt.rx.frame);
+        }
+    }
+    return HAL_OK;
+}
+
+/**
+  * @brief  Takes a report from another node
+  * @param  rx: RX frame event
+  * @note   The first report of the previous node starts our turn; the
+  *         last missing report completes the table.
+  * @retval true if the frame was a report (frame stays owned by the caller)
+  */
+static bool DW_AntCalReport(const DW_RxEvent_t* rx)
+{
+    DW_MacHeader_t hdr;
+
+    if (!rx->frame || rx->status != DW_RX_OK || rx->info.length < DW_ANTCAL_REPORT_LEN ||
+        DW_MacParseHeader(rx->frame->data, rx->info.length, &hdr) != HAL_OK ||
+        hdr.length != DW_MAC_HDR_SHORT_LEN ||
+        (hdr.frame_ctrl & DW_FC_TYPE_MASK) != DW_FC_TYPE_DATA ||
+        rx->frame->data[hdr.length] != DW_ANTCAL_FC_REPORT) {
+        return false;
+    }
+
+    /* 1. Single buffering: the receiver stays off after a frame */
+    if (dw_antcal.state == DW_ANTCAL_WAIT || dw_antcal.state == DW_ANTCAL_IDLE) {
+        DW_RxEnable();
+    }
+
+    const uint8_t* p = &rx->frame->data[hdr.length + 1];
+    uint8_t from = *p++;
+
+    if (hdr.dst_pan != dw_antcal.cfg.pan_id || from >= DW_ANTCAL_NODES ||
+        from == dw_antcal.cfg.node || (uint16_t)hdr.src_addr != dw_antcal.cfg.addr[from] ||
+        dw_antcal.have[from]) {
+        return true;
+    }
+
+    for (uint8_t n = 0; n < DW_ANTCAL_NODES; n++) {
+        if (n == from) continue;
+        dw_antcal.tof_q4[from][n] = (int32_t)((uint32_t)p[0] | (uint32_t)p[1] << 8 |
+                                              (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+        p += 4;
+    }
+    dw_antcal.have[from] = true;
+    dw_antcal.started = true;
+    dw_antcal.progress_tick = HAL_GetTick();
+
+    /* 2. Handover or completion */
+    if (from + 1 == dw_antcal.cfg.node && dw_antcal.state == DW_ANTCAL_WAIT) {
+        dw_antcal.handover = true;
+        dw_antcal.handover_tick = HAL_GetTick();
+    }
+    if (dw_antcal.have[0] && dw_antcal.have[1] && dw_antcal.have[2] &&
+        dw_antcal.state == DW_ANTCAL_WAIT) {
+        DW_AntCalSolve();
+    }
+    return true;
+}
+
+/**
+  * @brief  Solves our delay correction from the complete table, then
+  *         applies and stores the new delays
+  */
+static void DW_AntCalSolve(void)
+{
+    int32_t err_q4[DW_ANTCAL_NODES];
+    uint8_t self = dw_antcal.cfg.node;
+    uint8_t a = (self == 0) ? 1 : 0;
+    uint8_t b = (self == 2) ? 1 : 2;
+
+    DW_RxDisable();
+
+    /* 1. Per pair: mean of both directions against the surveyed distance */
+    for (uint8_t i = 0; i < DW_ANTCAL_NODES; i++) {
+        for (uint8_t j = i + 1; j < DW_ANTCAL_NODES; j++) {
+            uint8_t p = DW_AntCalPair(i, j);
+            int64_t mean_q4 = ((int64_t)dw_antcal.tof_q4[i][j] + dw_antcal.tof_q4[j][i]) / 2;
+            int64_t asym_q4 = (int64_t)dw_antcal.tof_q4[i][j] - dw_antcal.tof_q4[j][i];
+
+            err_q4[p] = (int32_t)(mean_q4 - DW_TimeFromMm((int64_t)dw_antcal.cfg.dist_mm[p] * 16));
+            dw_antcal.result.pair_error_mm[p] = DW_TimeToMm(err_q4[p]) / 16;
+            dw_antcal.result.pair_asym_mm[p] = DW_TimeToMm(asym_q4) / 16;
+        }
+    }
+
+    /* 2. D_self = e_sa + e_sb - e_ab, whole ticks */
+    int32_t corr_q4 = err_q4[DW_AntCalPair(self, a)] + err_q4[DW_AntCalPair(self, b)] -
+                      err_q4[DW_AntCalPair(a, b)];
+    int32_t corr = (corr_q4 + (corr_q4 >= 0 ? 8 : -8)) / 16;
+    int32_t total = (int32_t)dw_antcal.result.tx_antd + dw_antcal.result.rx_antd + corr;
+
+    dw_antcal.result.correction_ticks = corr;
+    if (corr > DW_ANTCAL_MAX_CORR_TICKS || corr < -DW_ANTCAL_MAX_CORR_TICKS ||
+        total < 0 || total > 2 * 0xFFFF) {
+        dw_antcal.state = DW_ANTCAL_FAILED;
+        return;
+    }
+
+    /* 3. Split evenly between TX and RX */
+    uint16_t tx_antd = (uint16_t)(total / 2);
+    uint16_t rx_antd = (uint16_t)(total - tx_antd);
+
+    if (DW_SetAntennaDelay(tx_antd, rx_antd) != HAL_OK ||
+        DW_AntCalSave(tx_antd, rx_antd) != HAL_OK) {
+        dw_antcal.state = DW_ANTCAL_FAILED;
+        return;
+    }
+
+    dw_antcal.result.tx_antd = tx_antd;
+    dw_antcal.result.rx_antd = rx_antd;
+    dw_antcal.state = DW_ANTCAL_DONE;
+}
+
+/**
+  * @brief  Index of a node pair in dist_mm
+  * @param  a: Node index
+  * @param  b: Other node index
+  * @retval 0 for 0-1, 1 for 0-2, 2 for 1-2
+  */
+static uint8_t DW_AntCalPair(uint8_t a, uint8_t b)
+{
+    return (uint8_t)(a + b - 1);
+}
+
+/**
+  * @brief  Check half-word of a flash record
+  * @param  rec: Record
+  * @retval One's complement of the sum of the other half-words
+  */
+static uint16_t DW_AntCalCheck(const DW_AntCalRecord_t* rec)
+{
+    const uint16_t* hw = (const uint16_t*)rec;
+    uint16_t sum = 0;
+
+    for (uint32_t i = 0; i < offsetof(DW_AntCalRecord_t, check) / 2; i++) {
+        sum += hw[i];
+    }
+    return (uint16_t)~sum;
+}
@@ -0,0 +1,174 @@
+/**
+  * @file    DW_Cir.c
+  * @brief   Channel impulse response capture from the DW1000 accumulator
+  * @author  36dhe
+  * @date    Jun 28, 2025
+  */
+
+#include "DW_Cir.h"
+#include <string.h>
+
+/* Private Variables */
+
+/* Packet buffer: header, one chunk of samples and the checksum. ACC_MEM
+ * reads start with a dummy byte, which lands on the last header byte and
+ * is overwritten when the header is filled in. */
+static uint8_t dw_cir_buf[sizeof(DW_CirChunkHdr_t) + DW_CIR_CHUNK_SAMPLES * DW_CIR_SAMPLE_SIZE +
+                          DW_LINK_CHECKSUM_LEN];
+
+static uint16_t dw_cir_id;
+static DW_CirStats_t dw_cir_stats;
+
+/* Private Function Prototypes */
+static HAL_StatusTypeDef DW_CirClocks(bool enable);
+
+/* Exported Functions */
+
+/**
+  * @brief  Streams a window of the channel impulse response to the host link
+  * @param  rx: RX frame event the accumulator belongs to
+  * @param  cfg: Window around the first path
+  * @note   Call right after the frame event, before the receiver takes the
+  *         next frame. The accumulator is not double-buffered: if RX_STAMP
+  *         changes during the capture the window is closed with
+  *         DW_CIR_FLAG_ABORTED.
+  * @retval HAL_OK if the whole window was sent, HAL_ERROR otherwise
+  */
+HAL_StatusTypeDef DW_CirCapture(const DW_RxEvent_t* rx, const DW_CirConfig_t* cfg)
+{
+    DW_CirChunkHdr_t hdr;
+    DW_Time_t rx_time = 0;
+    HAL_StatusTypeDef status = HAL_OK;
+
+    if (!rx || !cfg || cfg->samples == 0) {
+        return HAL_ERROR;
+    }
+
+    uint32_t t0 = DW_Cycles();
+
+    /* 1. First path index of the frame (10.6 fixed point) */
+    if (DW_ReadSubReg(DW_REG_RX_TIME, DW_SUB_RX_FP_INDEX, (uint8_t*)&hdr.fp_index, 2) != HAL_OK ||
+        DW_RxReadTimestamp(&rx_time) != HAL_OK) {
+        return HAL_ERROR;
+    }
+    if (rx->rx_time && rx_time != rx->rx_time) {
+        dw_cir_stats.aborted++;
+        return HAL_ERROR;
+    }
+
+    /* 2. Clip the window to the accumulator; the dummy byte needs one more */
+    uint16_t acc_len = (DW_GetPhyConfig()->prf == DW_PRF_64M) ? DW_CIR_SAMPLES_64M : DW_CIR_SAMPLES_16M;
+    uint16_t fp = hdr.fp_index >> 6;
+    uint16_t first = (fp > cfg->pre_samples) ? fp - cfg->pre_samples : 0;
+    uint16_t end = first + cfg->samples;
+    if (end > acc_len - 1) {
+        end = acc_len - 1;
+    }
+
+    if (DW_CirClocks(true) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    hdr.magic = DW_CIR_MAGIC;
+    hdr.capture_id = dw_cir_id++;
+    hdr.flags = DW_CIR_FLAG_FIRST;
+
+    for (uint16_t pos = first; pos < end; pos += hdr.samples) {
+        DW_Time_t check = 0;
+
+        hdr.first_sample = pos;
+        hdr.samples = (end - pos > DW_CIR_CHUNK_SAMPLES) ? DW_CIR_CHUNK_SAMPLES : end - pos;
+        if (pos + hdr.samples >= end) {
+            hdr.flags |= DW_CIR_FLAG_LAST;
+        }
+
+        /* 3. One chunk straight behind the header */
+        if (DW_ReadSubReg(DW_REG_ACC_MEM, pos * DW_CIR_SAMPLE_SIZE,
+                          &dw_cir_buf[sizeof(hdr) - 1],
+                          hdr.samples * DW_CIR_SAMPLE_SIZE + 1) != HAL_OK) {
+            status = HAL_ERROR;
+            break;
+        }
+
+        /* 4. Samples are only valid if no new frame has arrived meanwhile */
+        if (DW_RxReadTimestamp(&check) != HAL_OK || check != rx_time) {
+            hdr.flags |= DW_CIR_FLAG_ABORTED | DW_CIR_FLAG_LAST;
+            hdr.samples = 0;
+            dw_cir_stats.aborted++;
+            status = HAL_ERROR;
+        }
+
+        /* 5. Header in front, checksum behind */
+        uint16_t length = sizeof(hdr) + hdr.samples * DW_CIR_SAMPLE_SIZE;
+        memcpy(dw_cir_buf, &hdr, sizeof(hdr));
+        uint16_t sum = DW_LinkChecksum(dw_cir_buf, length);
+        dw_cir_buf[length] = (uint8_t)sum;
+        dw_cir_buf[length + 1] = (uint8_t)(sum >> 8);
+        if (DW_CirLinkWrite(dw_cir_buf, length + DW_LINK_CHECKSUM_LEN) != HAL_OK) {
+            dw_cir_stats.link_errors++;
+            status = HAL_ERROR;
+        }
+        if (status != HAL_OK) {
+            break;
+        }
+        hdr.flags = 0;
+    }
+
+    DW_CirClocks(false);
+
+    if (status == HAL_OK) {
+        dw_cir_stats.captures++;
+    }
+    dw_cir_stats.last_cycles = DW_Cycles() - t0;
+    return status;
+}
+
+/**
+  * @brief  Returns capture statistics
+  * @param  stats: Output statistics
+  */
+void DW_CirGetStats(DW_CirStats_t* stats)
+{
+    if (stats) {
+        *stats = dw_cir_stats;
+    }
+}
+
+/**
+  * @brief  Sends one CIR packet to the host
+  * @param  data: Packet (DW_CirChunkHdr_t, samples, checksum)
+  * @param  length: Packet length in bytes
+  * @note   Weak default writes to stdout (the printf channel), where the
+  *         host tells packets from text by magic, length and checksum;
+  *         override to use a dedicated link.
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+__attribute__((weak)) HAL_StatusTypeDef DW_CirLinkWrite(const uint8_t* data, uint16_t length)
+{
+    extern int _write(int file, char* ptr, int len);
+
+    return (_write(1, (char*)data, length) == length) ? HAL_OK : HAL_ERROR;
+}
+
+/* Private Functions */
+
+/**
+  * @brief  Switches the accumulator clocks needed to read ACC_MEM
+  * @param  enable: true before reading, false afterwards
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+static HAL_StatusTypeDef DW_CirClocks(bool enable)
+{
+    uint16_t ctrl0 = 0;
+
+    if (DW_ReadSubReg(DW_REG_PMSC, DW_SUB_PMSC_CTRL0, (uint8_t*)&ctrl0, 2) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    ctrl0 &= ~(DW_PMSC_CTRL0_RXCLKS_MASK | DW_PMSC_CTRL0_FACE | DW_PMSC_CTRL0_AMCE);
+    if (enable) {
+        ctrl0 |= DW_PMSC_CTRL0_RXCLKS_PLL | DW_PMSC_CTRL0_FACE | DW_PMSC_CTRL0_AMCE;
+    }
+
+    return DW_WriteSubReg(DW_REG_PMSC, DW_SUB_PMSC_CTRL0, (uint8_t*)&ctrl0, 2);
+}
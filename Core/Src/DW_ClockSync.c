@@ -0,0 +1,405 @@
+/**
+  * @file    DW_ClockSync.c
+  * @brief   Wireless clock synchronisation of TDoA anchors to a master
+  * @author  36dhe
+  * @date    Jul 16, 2025
+  */
+
+#include "DW_ClockSync.h"
+#include "DW_ExtSync.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private Variables */
+
+static struct {
+    DW_ClockSyncConfig_t cfg;
+    bool enabled;
+    uint16_t tx_antd;           // Added by the chip to the delayed TX time
+    /* Master */
+    bool tx_pending;
+    DW_TxHandle_t tx_handle;
+    uint32_t last_tick;
+    uint8_t seq;
+    /* Slave filter */
+    uint8_t samples;            // Syncs since the last restart
+    uint8_t rejects;            // Consecutive syncs outside the gate
+    int64_t tof_ticks;          // Master to this anchor
+    DW_Time_t local;            // RX time of the last accepted sync
+    int64_t offset_q8;          // Master - local, modulo 2^48
+    int64_t drift_q32;
+    uint32_t sync_tick;
+    uint64_t err_sq_sum;        // Squared errors while locked
+    uint32_t err_count;
+    DW_ClockSyncStats_t stats;
+} dw_csync;
+
+/* Private Function Prototypes */
+static HAL_StatusTypeDef DW_ClockSyncSend(void);
+static void DW_ClockSyncUpdate(DW_Time_t local, DW_Time_t master, int32_t ppb);
+static void DW_ClockSyncRestart(void);
+static bool DW_ClockSyncFresh(void);
+static int64_t DW_ClockSyncWrap(int64_t q8);
+
+/* Exported Functions */
+
+/**
+  * @brief  Starts clock synchronisation in the given role
+  * @param  cfg: Role, addresses, master distance and sync period
+  * @note   The receive path belongs to the caller (see DW_Tdoa); sync
+  *         frames reach this module through DW_ClockSyncHandleEvent().
+  *         The wired role arms a timebase reset on the next SYNC pulse.
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_ClockSyncInit(const DW_ClockSyncConfig_t* cfg)
+{
+    if (!cfg) return HAL_ERROR;
+
+    memset(&dw_csync, 0, sizeof(dw_csync));
+    dw_csync.cfg = *cfg;
+    if (dw_csync.cfg.period_ms == 0) {
+        dw_csync.cfg.period_ms = DW_CSYNC_PERIOD_MS;
+    }
+    dw_csync.tof_ticks = DW_TimeFromMm(cfg->master_dist_mm);
+
+    if (DW_ReadReg(DW_REG_TX_ANTD, (uint8_t*)&dw_csync.tx_antd, 2) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    if (cfg->role == DW_CSYNC_ROLE_WIRED &&
+        DW_ExtSyncArm(DW_EXTSYNC_TIMEBASE_RESET, DW_EXTSYNC_WAIT_DEFAULT) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    dw_csync.enabled = true;
+    return HAL_OK;
+}
+
+/**
+  * @brief  Sends a sync frame when one is due (master) or waits for the
+  *         SYNC pulse (wired); call from the main loop
+  * @retval HAL_OK if successful, HAL_ERROR if a sync could not be sent
+  */
+HAL_StatusTypeDef DW_ClockSyncRun(void)
+{
+    if (dw_csync.enabled && dw_csync.cfg.role == DW_CSYNC_ROLE_WIRED) {
+        bool done = false;
+
+        if (dw_csync.stats.locked) return HAL_OK;
+        if (DW_ExtSyncPoll(&done) != HAL_OK) {
+            dw_csync.stats.errors++;
+            return HAL_ERROR;
+        }
+        if (done) {
+            dw_csync.stats.locked = true;
+            dw_csync.stats.syncs++;
+        }
+        return HAL_OK;
+    }
+
+    if (!dw_csync.enabled || dw_csync.cfg.role != DW_CSYNC_ROLE_MASTER ||
+        dw_csync.tx_pending || HAL_GetTick() - dw_csync.last_tick < dw_csync.cfg.period_ms) {
+        return HAL_OK;
+    }
+
+    dw_csync.last_tick = HAL_GetTick();
+    if (DW_ClockSyncSend() != HAL_OK) {
+        dw_csync.stats.errors++;
+        DW_RxEnable();
+        return HAL_ERROR;
+    }
+    return HAL_OK;
+}
+
+/**
+  * @brief  Takes the events that belong to clock synchronisation
+  * @param  evt: Event from DW_GetEvent()
+  * @note   RX frame buffers stay owned by the caller.
+  * @retval true if the event was a sync frame or the master's sync TX
+  */
+bool DW_ClockSyncHandleEvent(const DW_Event_t* evt)
+{
+    DW_MacHeader_t hdr;
+
+    if (!dw_csync.enabled || !evt) return false;
+
+    /* 1. Master: the receiver resumes after the sync */
+    if (evt->type == DW_EVENT_TX_DONE) {
+        if (!dw_csync.tx_pending || evt->tx.handle != dw_csync.tx_handle) {
+            return false;
+        }
+        dw_csync.tx_pending = false;
+        if (evt->tx.status == DW_TX_OK) {
+            dw_csync.stats.syncs++;
+        } else {
+            dw_csync.stats.errors++;
+        }
+        DW_RxEnable();
+        return true;
+    }
+
+    if (evt->type != DW_EVENT_RX_FRAME || !evt->rx.frame ||
+        !DW_ClockSyncClassify(evt->rx.frame->data,
+                              evt->rx.info.length > DW_CSYNC_LEN ? DW_CSYNC_LEN : evt->rx.info.length)) {
+        return false;
+    }
+
+    /* 2. Slave: syncs from our master with a valid leading edge only */
+    if (dw_csync.cfg.role == DW_CSYNC_ROLE_SLAVE && evt->rx.status == DW_RX_OK &&
+        evt->rx.info.length >= DW_CSYNC_LEN &&
+        DW_MacParseHeader(evt->rx.frame->data, evt->rx.info.length, &hdr) == HAL_OK &&
+        hdr.dst_pan == dw_csync.cfg.pan_id && (uint16_t)hdr.src_addr == dw_csync.cfg.master_addr) {
+        DW_Time_t master_tx = DW_TimeUnpack(evt->rx.frame->data + DW_MAC_HDR_SHORT_LEN + 1);
+
+        DW_ClockSyncUpdate(evt->rx.rx_time, DW_TimeAdd(master_tx, (DW_Time_t)dw_csync.tof_ticks),
+                           evt->rx.clock_offset_ppb);
+    }
+    return true;
+}
+
+/**
+  * @brief  Recognises sync frames from their first bytes
+  * @param  header: Frame start
+  * @param  length: Bytes available, at least DW_MAC_HDR_SHORT_LEN + 1
+  * @retval true for a sync frame
+  */
+bool DW_ClockSyncClassify(const uint8_t* header, uint8_t length)
+{
+    uint16_t fc;
+
+    if (length < DW_MAC_HDR_SHORT_LEN + 1) return false;
+
+    fc = header[0] | header[1] << 8;
+    return (fc & DW_FC_TYPE_MASK) == DW_FC_TYPE_DATA &&
+           (fc & (DW_FC_DST_MODE_MASK | DW_FC_SRC_MODE_MASK)) == (DW_FC_DST_SHORT | DW_FC_SRC_SHORT) &&
+           header[DW_MAC_HDR_SHORT_LEN] == DW_CSYNC_FC;
+}
+
+/**
+  * @brief  Converts a local timestamp to master time
+  * @param  local: Local RX or TX timestamp
+  * @param  master: Output master time
+  * @note   offset + drift * (local - last sync), a few multiplies; usable
+  *         for timestamps shortly before the last sync as well. Wired
+  *         anchors share the master's SYS_TIME once the pulse reset it.
+  * @retval true if converted, false while not locked (master unchanged)
+  */
+bool DW_ClockSyncToMaster(DW_Time_t local, DW_Time_t* master)
+{
+    if (!master || !dw_csync.enabled) return false;
+
+    if (dw_csync.cfg.role == DW_CSYNC_ROLE_MASTER ||
+        (dw_csync.cfg.role == DW_CSYNC_ROLE_WIRED && dw_csync.stats.locked)) {
+        *master = local;
+        return true;
+    }
+
+    if (dw_csync.cfg.role != DW_CSYNC_ROLE_SLAVE || !dw_csync.stats.locked || !DW_ClockSyncFresh()) {
+        return false;
+    }
+
+    int64_t dt = DW_TimeDiff(local, dw_csync.local);
+    int64_t offset_q8 = dw_csync.offset_q8 + ((dw_csync.drift_q32 * dt) >> 24);
+
+    *master = DW_TimeAdd(local, (DW_Time_t)((offset_q8 + 128) >> 8));
+    return true;
+}
+
+/**
+  * @brief  Returns synchronisation state and statistics
+  * @param  stats: Output statistics
+  */
+void DW_ClockSyncGetStats(DW_ClockSyncStats_t* stats)
+{
+    if (!stats) return;
+
+    *stats = dw_csync.stats;
+    stats->locked = dw_csync.stats.locked &&
+                    (dw_csync.cfg.role == DW_CSYNC_ROLE_WIRED || DW_ClockSyncFresh());
+    stats->offset_ticks = (dw_csync.offset_q8 + 128) >> 8;
+    stats->drift_ppb = (int32_t)((dw_csync.drift_q32 * 1000000000) >> 32);
+    if (dw_csync.err_count) {
+        stats->rms_error_ticks = DW_Isqrt(dw_csync.err_sq_sum / dw_csync.err_count);
+    }
+}
+
+/**
+  * @brief  Prints synchronisation state and statistics
+  */
+void DW_ClockSyncPrintStats(void)
+{
+    DW_ClockSyncStats_t stats;
+
+    DW_ClockSyncGetStats(&stats);
+
+    if (dw_csync.cfg.role == DW_CSYNC_ROLE_MASTER) {
+        printf("Clock sync master: %lu syncs, errors %lu\n",
+               (unsigned long)stats.syncs, (unsigned long)stats.errors);
+        return;
+    }
+
+    if (dw_csync.cfg.role == DW_CSYNC_ROLE_WIRED) {
+        printf("Clock sync wired: %s, errors %lu\n",
+               stats.locked ? "timebase reset" : "waiting for SYNC pulse",
+               (unsigned long)stats.errors);
+        return;
+    }
+
+    printf("Clock sync %s: offset %lld ticks, drift %ld ppb, error %ld ticks (rms %lu ps)\n",
+           stats.locked ? "locked" : "unlocked", (long long)stats.offset_ticks,
+           (long)stats.drift_ppb, (long)stats.last_error_ticks,
+           (unsigned long)DW_TimeToPs(stats.rms_error_ticks));
+    printf("  Syncs %lu, rejected %lu, restarts %lu, errors %lu\n",
+           (unsigned long)stats.syncs, (unsigned long)stats.rejected,
+           (unsigned long)stats.restarts, (unsigned long)stats.errors);
+}
+
+/* Private Functions */
+
+/**
+  * @brief  Broadcasts a sync frame stamped with its own TX time (master)
+  * @note   The receiver is off from here until the TX completes.
+  * @retval HAL_OK if the frame was started, HAL_ERROR on failure
+  */
+static HAL_StatusTypeDef DW_ClockSyncSend(void)
+{
+    DW_FrameBuilder_t fb;
+    DW_Time_t now;
+    uint8_t* p;
+
+    if (DW_RxDisable() != HAL_OK || DW_ReadSysTime(&now) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    DW_Time_t at = DW_TimeAdd(now, DW_TimeFromUs(DW_CSYNC_TX_LEAD_US)) & DW_TIME_DX_MASK;
+
+    DW_FrameBegin(&fb);
+    if (DW_FrameWriteMacHeader(&fb, DW_FC_TYPE_DATA, dw_csync.seq++, dw_csync.cfg.pan_id,
+                               0xFFFF, dw_csync.cfg.short_addr) != HAL_OK ||
+        (p = DW_FrameReserve(&fb, 1 + DW_TIME_BYTES)) == NULL) {
+        return HAL_ERROR;
+    }
+    p[0] = DW_CSYNC_FC;
+    DW_TimePack(p + 1, DW_TimeAdd(at, dw_csync.tx_antd));
+
+    if (DW_EnableTxMode(DW_TX_MODE_DELAYED) != HAL_OK ||
+        DW_SetDelayedTime(at) != HAL_OK || DW_FrameSend(&fb) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    dw_csync.tx_handle = DW_GetLastTxHandle();
+    dw_csync.tx_pending = true;
+    return HAL_OK;
+}
+
+/**
+  * @brief  Feeds one sync into the offset/drift filter (slave)
+  * @param  local: RX time of the sync
+  * @param  master: Master time at that instant (TX time + flight time)
+  * @param  ppb: RX clock offset of the sync, DW_RX_OFFSET_INVALID if unknown
+  */
+static void DW_ClockSyncUpdate(DW_Time_t local, DW_Time_t master, int32_t ppb)
+{
+    int64_t meas_q8 = DW_TimeDiff(master, local) * 256;
+
+    if (dw_csync.samples && !DW_ClockSyncFresh()) {
+        DW_ClockSyncRestart();
+    }
+
+    /* 1. First sync: offset measured, drift from RX time tracking */
+    if (dw_csync.samples == 0) {
+        dw_csync.offset_q8 = meas_q8;
+        dw_csync.drift_q32 = (ppb != DW_RX_OFFSET_INVALID) ?
+                             (int64_t)ppb * (1LL << 32) / 1000000000 : 0;
+        dw_csync.local = local;
+        dw_csync.sync_tick = HAL_GetTick();
+        dw_csync.samples = 1;
+        dw_csync.stats.syncs++;
+        return;
+    }
+
+    int64_t dt = (int64_t)DW_TimeSub(local, dw_csync.local);
+    if (dt == 0) {
+        dw_csync.stats.errors++;
+        return;
+    }
+
+    /* 2. Second sync: two-point slope, far better than RX time tracking */
+    if (dw_csync.samples == 1) {
+        dw_csync.drift_q32 = DW_ClockSyncWrap(meas_q8 - dw_csync.offset_q8) * (1 << 24) / dt;
+        dw_csync.offset_q8 = meas_q8;
+        dw_csync.local = local;
+        dw_csync.sync_tick = HAL_GetTick();
+        dw_csync.samples = 2;
+        dw_csync.stats.syncs++;
+        return;
+    }
+
+    /* 3. Predict, gate, correct */
+    int64_t pred_q8 = DW_ClockSyncWrap(dw_csync.offset_q8 + ((dw_csync.drift_q32 * dt) >> 24));
+    int64_t err_q8 = DW_ClockSyncWrap(meas_q8 - pred_q8);
+    int64_t err = err_q8 / 256;
+
+    if (dw_csync.samples >= DW_CSYNC_LOCK_SYNCS &&
+        (err > DW_CSYNC_GATE_TICKS || err < -DW_CSYNC_GATE_TICKS)) {
+        dw_csync.stats.rejected++;
+        if (++dw_csync.rejects >= DW_CSYNC_REJECT_LIMIT) {
+            DW_ClockSyncRestart();
+            DW_ClockSyncUpdate(local, master, ppb);
+        }
+        return;
+    }
+    dw_csync.rejects = 0;
+
+    dw_csync.offset_q8 = DW_ClockSyncWrap(pred_q8 + (err_q8 >> DW_CSYNC_ALPHA_SHIFT));
+    dw_csync.drift_q32 += (err_q8 * (1 << 24) / dt) >> DW_CSYNC_BETA_SHIFT;
+    dw_csync.local = local;
+    dw_csync.sync_tick = HAL_GetTick();
+    if (dw_csync.samples < UINT8_MAX) {
+        dw_csync.samples++;
+    }
+    dw_csync.stats.syncs++;
+    dw_csync.stats.last_error_ticks = (int32_t)err;
+
+    /* 4. Lock once the prediction holds */
+    if (dw_csync.samples >= DW_CSYNC_LOCK_SYNCS &&
+        err <= DW_CSYNC_GATE_TICKS && err >= -DW_CSYNC_GATE_TICKS) {
+        if (dw_csync.stats.locked) {
+            dw_csync.err_sq_sum += (uint64_t)(err * err);
+            dw_csync.err_count++;
+        }
+        dw_csync.stats.locked = true;
+    }
+}
+
+/**
+  * @brief  Drops the filter state; the next sync starts over
+  */
+static void DW_ClockSyncRestart(void)
+{
+    dw_csync.samples = 0;
+    dw_csync.rejects = 0;
+    dw_csync.err_sq_sum = 0;
+    dw_csync.err_count = 0;
+    dw_csync.stats.locked = false;
+    dw_csync.stats.restarts++;
+}
+
+/**
+  * @brief  Tells whether the last sync is recent enough to extrapolate
+  * @retval true within DW_CSYNC_HOLDOVER_MS of the last accepted sync
+  */
+static bool DW_ClockSyncFresh(void)
+{
+    return HAL_GetTick() - dw_csync.sync_tick <= DW_CSYNC_HOLDOVER_MS;
+}
+
+/**
+  * @brief  Reduces a Q8 tick offset modulo 2^48 (40-bit counters)
+  * @param  q8: Offset in Q8 ticks
+  * @retval Same offset in [-2^47, 2^47)
+  */
+static int64_t DW_ClockSyncWrap(int64_t q8)
+{
+    return (int64_t)((uint64_t)q8 << 16) >> 16;
+}
@@ -0,0 +1,233 @@
+/**
+  * @file    DW_Diag.c
+  * @brief   Fixed-point receive diagnostics (RX level, first path level)
+  * @author  36dhe
+  * @date    Jul 2, 2025
+  */
+
+#include "DW_Diag.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Private Variables */
+
+/* log2(1 + i/32) in Q16, i = 0..32 */
+static const uint16_t dw_log2_lut[33] = {
+        0,  2909,  5732,  8473, 11136, 13727, 16248, 18704,
+    21098, 23433, 25711, 27936, 30109, 32234, 34312, 36346,
+    38336, 40286, 42196, 44068, 45904, 47705, 49472, 51207,
+    52911, 54584, 56229, 57845, 59434, 60997, 62534, 64047,
+    65535
+};
+
+/* Private Function Prototypes */
+static int16_t DW_DiagCentiDb(int32_t log2_q16, uint16_t a);
+static void DW_DiagComputeFloat(const DW_RxDiag_t* diag, int16_t* rx_level, int16_t* fp_level);
+
+/* Exported Functions */
+
+/**
+  * @brief  Reads the quality registers of the last received frame
+  * @param  diag: Output diagnostics, levels are computed as well
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_DiagRead(DW_RxDiag_t* diag)
+{
+    DW_RxQuality_t q;
+    DW_RxFrameInfo_t info;
+
+    if (!diag) return HAL_ERROR;
+
+    if (DW_RxReadQuality(&q) != HAL_OK || DW_RxReadInfo(&info) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    DW_DiagFromQuality(&q, info.preamble_count, info.preamble_count == q.rxpacc_nosat, diag);
+    return HAL_OK;
+}
+
+/**
+  * @brief  Fills diagnostics from quality values captured with the frame
+  * @param  q: Raw quality, e.g. DW_RxEvent_t.quality
+  * @param  rxpacc: Preamble count (RXPACC) of the same frame
+  * @param  sfd_corr: true if RXPACC includes the SFD symbols, which is the
+  *         case unless the count saturated (User Manual 7.2.40)
+  * @param  diag: Output diagnostics, levels are computed as well
+  */
+void DW_DiagFromQuality(const DW_RxQuality_t* q, uint16_t rxpacc, bool sfd_corr, DW_RxDiag_t* diag)
+{
+    if (!q || !diag) return;
+
+    diag->std_noise = q->std_noise;
+    diag->fp_ampl1 = q->fp_ampl1;
+    diag->fp_ampl2 = q->fp_ampl2;
+    diag->fp_ampl3 = q->fp_ampl3;
+    diag->cir_power = q->cir_power;
+    diag->fp_index = q->fp_index;
+
+    diag->preamble_count = rxpacc;
+    if (sfd_corr) {
+        const DW_PhyConfig_t* phy = DW_GetPhyConfig();
+        static const uint8_t sfd_corr_sym[2][3] = {{64, 5, 5}, {82, 18, 10}};
+        uint8_t corr = sfd_corr_sym[phy->nonstd_sfd ? 1 : 0][phy->data_rate];
+
+        if (diag->preamble_count > corr) {
+            diag->preamble_count -= corr;
+        }
+    }
+
+    DW_DiagCompute(diag);
+}
+
+/**
+  * @brief  Computes RX level and first path level from the raw values
+  * @param  diag: Diagnostics with the raw fields filled in
+  * @note   RX level = 10 log10(C * 2^17 / N^2) - A
+  *         FP level = 10 log10((F1^2 + F2^2 + F3^2) / N^2) - A
+  *         Each log is taken as a difference of log2 values, so no division
+  *         and no floating point is needed.
+  */
+void DW_DiagCompute(DW_RxDiag_t* diag)
+{
+    if (!diag) return;
+
+    uint16_t a = (DW_GetPhyConfig()->prf == DW_PRF_16M) ? DW_DIAG_A_16M : DW_DIAG_A_64M;
+    uint32_t n = diag->preamble_count;
+    uint64_t fp_pwr = (uint64_t)diag->fp_ampl1 * diag->fp_ampl1 +
+                      (uint64_t)diag->fp_ampl2 * diag->fp_ampl2 +
+                      (uint64_t)diag->fp_ampl3 * diag->fp_ampl3;
+
+    if (n == 0) {
+        diag->rx_level = DW_DIAG_LEVEL_INVALID;
+        diag->fp_level = DW_DIAG_LEVEL_INVALID;
+        return;
+    }
+
+    int32_t log2_n2 = 2 * DW_DiagLog2Q16(n);
+
+    diag->rx_level = diag->cir_power ?
+        DW_DiagCentiDb(DW_DiagLog2Q16((uint64_t)diag->cir_power << 17) - log2_n2, a) :
+        DW_DIAG_LEVEL_INVALID;
+    diag->fp_level = fp_pwr ?
+        DW_DiagCentiDb(DW_DiagLog2Q16(fp_pwr) - log2_n2, a) :
+        DW_DIAG_LEVEL_INVALID;
+}
+
+/**
+  * @brief  Computes log2(x) in Q16
+  * @param  x: Argument, must be non-zero
+  * @note   Integer part from the leading one, fraction from a 33-entry table
+  *         with linear interpolation (error below 0.0005).
+  * @retval log2(x) * 65536, 0 for x == 0
+  */
+int32_t DW_DiagLog2Q16(uint64_t x)
+{
+    if (x == 0) return 0;
+
+    uint32_t msb = 63 - (uint32_t)__builtin_clzll(x);
+    uint64_t m = x << (63 - msb);                 // Leading one at bit 63
+    uint32_t idx = (uint32_t)(m >> 58) & 0x1F;    // Next 5 bits: table index
+    uint32_t rem = (uint32_t)(m >> 42) & 0xFFFF;  // Next 16 bits: interpolation
+    uint32_t frac = dw_log2_lut[idx] +
+                    (((uint32_t)(dw_log2_lut[idx + 1] - dw_log2_lut[idx]) * rem) >> 16);
+
+    return (int32_t)((msb << 16) + frac);
+}
+
+/**
+  * @brief  Measures diagnostics cost per frame and fixed-point accuracy
+  * @param  iterations: Number of synthetic frames to compute
+  * @param  bench: Output results
+  * @note   The SPI read is measured on the last received frame; the
+  *         computations run over a sweep of synthetic register values.
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_DiagBenchmark(uint32_t iterations, DW_DiagBench_t* bench)
+{
+    DW_RxDiag_t diag;
+    uint32_t fixed = 0, flt = 0;
+    int16_t rx_ref, fp_ref;
+
+    if (!bench || iterations == 0) return HAL_ERROR;
+
+    DW_CycleCounterInit();
+    bench->max_error = 0;
+
+    uint32_t t0 = DW_Cycles();
+    DW_DiagRead(&diag);
+    bench->read_cycles = DW_Cycles() - t0;
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        diag.cir_power = (uint16_t)(500 + (i * 613) % 60000);
+        diag.fp_ampl1 = (uint16_t)(100 + (i * 97) % 20000);
+        diag.fp_ampl2 = (uint16_t)(100 + (i * 131) % 20000);
+        diag.fp_ampl3 = (uint16_t)(100 + (i * 71) % 20000);
+        diag.preamble_count = (uint16_t)(32 + (i * 29) % 1000);
+
+        t0 = DW_Cycles();
+        DW_DiagCompute(&diag);
+        uint32_t t1 = DW_Cycles();
+        DW_DiagComputeFloat(&diag, &rx_ref, &fp_ref);
+        uint32_t t2 = DW_Cycles();
+
+        fixed += t1 - t0;
+        flt += t2 - t1;
+
+        int16_t err = (int16_t)abs(diag.rx_level - rx_ref);
+        if (err > bench->max_error) bench->max_error = err;
+        err = (int16_t)abs(diag.fp_level - fp_ref);
+        if (err > bench->max_error) bench->max_error = err;
+    }
+
+    bench->fixed_cycles = fixed / iterations;
+    bench->float_cycles = flt / iterations;
+    return HAL_OK;
+}
+
+/**
+  * @brief  Prints receive diagnostics
+  * @param  diag: Diagnostics from DW_DiagRead()
+  */
+void DW_DiagPrint(const DW_RxDiag_t* diag)
+{
+    if (!diag) return;
+
+    printf("RX %d.%02d dBm, FP %d.%02d dBm, FP index %u.%02u, N %u, noise %u\n",
+           diag->rx_level / 100, abs(diag->rx_level % 100),
+           diag->fp_level / 100, abs(diag->fp_level % 100),
+           diag->fp_index >> 6, ((diag->fp_index & 0x3F) * 100) >> 6,
+           diag->preamble_count, diag->std_noise);
+}
+
+/* Private Functions */
+
+/**
+  * @brief  Converts a log2 ratio to a level in centi-dB(m)
+  * @param  log2_q16: log2 of the power ratio in Q16
+  * @param  a: Constant A in centi-dB
+  * @retval 10 log10(ratio) - A in centi-dB
+  */
+static int16_t DW_DiagCentiDb(int32_t log2_q16, uint16_t a)
+{
+    /* 1000 * log10(2) = 301.03 = 19266 / 2^6, applied to Q16: >> 22 */
+    int32_t cdb = (int32_t)(((int64_t)log2_q16 * 19266) >> 22);
+
+    return (int16_t)(cdb - a);
+}
+
+/**
+  * @brief  Reference computation with soft-float log10f, for the benchmark
+  * @param  diag: Diagnostics with the raw fields filled in
+  * @param  rx_level: Output RX level, centi-dBm
+  * @param  fp_level: Output first path level, centi-dBm
+  */
+static void DW_DiagComputeFloat(const DW_RxDiag_t* diag, int16_t* rx_level, int16_t* fp_level)
+{
+    float a = (DW_GetPhyConfig()->prf == DW_PRF_16M) ? 113.77f : 121.74f;
+    float n2 = (float)diag->preamble_count * (float)diag->preamble_count;
+    float f1 = diag->fp_ampl1, f2 = diag->fp_ampl2, f3 = diag->fp_ampl3;
+
+    *rx_level = (int16_t)((10.0f * log10f((float)diag->cir_power * 131072.0f / n2) - a) * 100.0f);
+    *fp_level = (int16_t)((10.0f * log10f((f1 * f1 + f2 * f2 + f3 * f3) / n2) - a) * 100.0f);
+}
@@ -0,0 +1,167 @@
+/**
+  * @file    DW_ExtSync.c
+  * @brief   Wired synchronisation through the DW1000 SYNC input
+  * @author  36dhe
+  * @date    Jul 17, 2025
+  */
+
+#include "DW_ExtSync.h"
+
+/* Private Variables */
+
+static struct {
+    DW_ExtSyncMode_t mode;      // Armed mode, DW_EXTSYNC_OFF once done
+    DW_Time_t arm_time;         // SYS_TIME when armed
+    uint32_t arm_tick;
+    uint32_t poll_tick;
+} dw_extsync;
+
+/* Private Function Prototypes */
+static HAL_StatusTypeDef DW_ExtSyncWriteCtrl(uint32_t set, uint8_t wait);
+
+/* Exported Functions */
+
+/**
+  * @brief  Arms a one-shot action on the next SYNC edge
+  * @param  mode: Timebase reset or RX on sync
+  * @param  wait: Reference cycles from the SYNC edge to the action, the
+  *         same on every anchor (e.g. DW_EXTSYNC_WAIT_DEFAULT)
+  * @note   A timebase reset invalidates every timestamp and delayed
+  *         TX/RX time taken before it.
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_ExtSyncArm(DW_ExtSyncMode_t mode, uint8_t wait)
+{
+    uint32_t gpio_mode = 0;
+
+    if (mode == DW_EXTSYNC_OFF) {
+        return DW_ExtSyncDisarm();
+    }
+
+    /* 1. The pulse only arrives with GPIO7 in its SYNC function */
+    if (DW_ReadSubReg(DW_REG_GPIO_CTRL, DW_SUB_GPIO_MODE, (uint8_t*)&gpio_mode, 4) != HAL_OK ||
+        (gpio_mode & DW_GPIO_MSGP7_MASK) != 0) {
+        return HAL_ERROR;
+    }
+
+    /* 2. Reference point to recognise the reset by */
+    if (mode == DW_EXTSYNC_TIMEBASE_RESET &&
+        DW_ReadSysTime(&dw_extsync.arm_time) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    if (DW_ExtSyncWriteCtrl(mode == DW_EXTSYNC_TIMEBASE_RESET ? DW_EC_CTRL_OSTRM : DW_EC_CTRL_OSRSM,
+                            wait) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    dw_extsync.mode = mode;
+    dw_extsync.arm_tick = HAL_GetTick();
+    dw_extsync.poll_tick = dw_extsync.arm_tick;
+    return HAL_OK;
+}
+
+/**
+  * @brief  Clears both one-shot modes
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_ExtSyncDisarm(void)
+{
+    dw_extsync.mode = DW_EXTSYNC_OFF;
+    return DW_ExtSyncWriteCtrl(0, 0);
+}
+
+/**
+  * @brief  Checks whether an armed timebase reset has happened
+  * @param  done: Set to true once SYS_TIME has restarted; the mode is
+  *         disarmed then so later pulses leave the timebase alone
+  * @note   Nothing flags the reset, so SYS_TIME is compared with where it
+  *         would be without one; at most one SPI read per millisecond.
+  *         A reset landing within DW_EXTSYNC_JUMP_MS of that course goes
+  *         unnoticed, which is harmless for the epoch.
+  * @retval HAL_OK if successful, HAL_ERROR on failure or if not armed
+  */
+HAL_StatusTypeDef DW_ExtSyncPoll(bool* done)
+{
+    DW_Time_t now;
+
+    if (!done || dw_extsync.mode != DW_EXTSYNC_TIMEBASE_RESET) {
+        return HAL_ERROR;
+    }
+
+    *done = false;
+    uint32_t tick = HAL_GetTick();
+    if (tick == dw_extsync.poll_tick) {
+        return HAL_OK;
+    }
+    dw_extsync.poll_tick = tick;
+
+    if (DW_ReadSysTime(&now) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    /* 1. SYS_TIME runs with HAL_GetTick unless the pulse reset it; the
+     *    counter wraps every ~17.2 s, so re-reference well before that */
+    uint32_t elapsed_ms = tick - dw_extsync.arm_tick;
+    DW_Time_t expected = DW_TimeAdd(dw_extsync.arm_time, DW_TimeFromUs(elapsed_ms * 1000));
+    int64_t jump = DW_TimeDiff(now, expected);
+
+    if (jump > (int64_t)DW_TimeFromUs(DW_EXTSYNC_JUMP_MS * 1000) ||
+        jump < -(int64_t)DW_TimeFromUs(DW_EXTSYNC_JUMP_MS * 1000)) {
+        *done = true;
+        return DW_ExtSyncDisarm();
+    }
+
+    if (elapsed_ms > 4000) {
+        dw_extsync.arm_time = now;
+        dw_extsync.arm_tick = tick;
+    }
+    return HAL_OK;
+}
+
+/**
+  * @brief  Reads the time from the SYNC edge to the first path of the
+  *         frame received in RX-on-sync mode
+  * @param  since_sync: Output in ticks, same units as RX_STAMP
+  * @note   EC_RXTC holds whole reference cycles (1664 ticks); EC_GOLP is
+  *         the offset from the first path to that cycle edge in 1 ns steps.
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_ExtSyncReadRx(DW_Time_t* since_sync)
+{
+    uint32_t rxtc = 0;
+    uint8_t golp = 0;
+
+    if (!since_sync) return HAL_ERROR;
+
+    if (DW_ReadSubReg(DW_REG_EXT_SYNC, DW_SUB_EC_RXTC, (uint8_t*)&rxtc, 4) != HAL_OK ||
+        DW_ReadSubReg(DW_REG_EXT_SYNC, DW_SUB_EC_GOLP, &golp, 1) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    /* 1 ns = 63.8976 ticks */
+    *since_sync = (uint64_t)rxtc * DW_EXTSYNC_TICKS_PER_CYCLE -
+                  (uint64_t)(golp & DW_EC_GOLP_MASK) * 638976 / 10000;
+    return HAL_OK;
+}
+
+/* Private Functions */
+
+/**
+  * @brief  Sets the mode bits and WAIT in EC_CTRL, keeping the other bits
+  * @param  set: DW_EC_CTRL_OSTRM, DW_EC_CTRL_OSRSM or 0
+  * @param  wait: Reference cycles from SYNC to action
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+static HAL_StatusTypeDef DW_ExtSyncWriteCtrl(uint32_t set, uint8_t wait)
+{
+    uint32_t ctrl = 0;
+
+    if (DW_ReadSubReg(DW_REG_EXT_SYNC, DW_SUB_EC_CTRL, (uint8_t*)&ctrl, 4) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    ctrl &= ~(DW_EC_CTRL_OSTSM | DW_EC_CTRL_OSRSM | DW_EC_CTRL_OSTRM | DW_EC_CTRL_WAIT_MASK);
+    ctrl |= set | (((uint32_t)wait << DW_EC_CTRL_WAIT_SHIFT) & DW_EC_CTRL_WAIT_MASK);
+    return DW_WriteSubReg(DW_REG_EXT_SYNC, DW_SUB_EC_CTRL, (uint8_t*)&ctrl, 4);
+}
@@ -0,0 +1,146 @@
+/**
+  * @file    DW_FramePool.c
+  * @brief   Fixed-block frame buffer pool, usable from interrupt context
+  * @author  36dhe
+  * @date    Jun 21, 2025
+  */
+
+#include "DW_FramePool.h"
+#include <stddef.h>
+
+/* Block size in 32-bit words: header plus payload, rounded up */
+#define DW_POOL_WORDS(size)    ((sizeof(DW_FrameBuf_t) + (size) + 3) / 4)
+
+/* Private Variables */
+
+static uint32_t dw_pool_short[DW_POOL_SHORT_COUNT][DW_POOL_WORDS(DW_POOL_SHORT_SIZE)];
+static uint32_t dw_pool_long[DW_POOL_LONG_COUNT][DW_POOL_WORDS(DW_POOL_LONG_SIZE)];
+
+static struct {
+    DW_FrameBuf_t* free_list;
+    uint16_t free;
+    uint16_t min_free;
+    uint32_t exhausted;
+} dw_pool[DW_POOL_CLASSES];
+
+static const uint16_t dw_pool_size[DW_POOL_CLASSES] = {DW_POOL_SHORT_SIZE, DW_POOL_LONG_SIZE};
+
+static uint32_t dw_pool_failures;
+
+/* Private Function Prototypes */
+static void DW_PoolInitClass(uint8_t cls, uint32_t* storage, uint16_t count, uint16_t words);
+
+/* Exported Functions */
+
+/**
+  * @brief  Builds the free lists of all block classes
+  * @note   Call once at start-up, before the radio delivers frames
+  */
+void DW_PoolInit(void)
+{
+    DW_PoolInitClass(0, &dw_pool_short[0][0], DW_POOL_SHORT_COUNT,
+                     DW_POOL_WORDS(DW_POOL_SHORT_SIZE));
+    DW_PoolInitClass(1, &dw_pool_long[0][0], DW_POOL_LONG_COUNT,
+                     DW_POOL_WORDS(DW_POOL_LONG_SIZE));
+    dw_pool_failures = 0;
+}
+
+/**
+  * @brief  Allocates a frame buffer in O(1)
+  * @param  length: Payload bytes needed
+  * @retval Buffer with length set, NULL if no block is available
+  */
+DW_FrameBuf_t* DW_PoolAlloc(uint16_t length)
+{
+    DW_FrameBuf_t* buf = NULL;
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    for (uint8_t cls = 0; cls < DW_POOL_CLASSES; cls++) {
+        if (length > dw_pool_size[cls]) {
+            continue;
+        }
+        buf = dw_pool[cls].free_list;
+        if (buf) {
+            dw_pool[cls].free_list = buf->next;
+            if (--dw_pool[cls].free < dw_pool[cls].min_free) {
+                dw_pool[cls].min_free = dw_pool[cls].free;
+            }
+            break;
+        }
+        dw_pool[cls].exhausted++;
+    }
+    if (!buf) {
+        dw_pool_failures++;
+    }
+    __set_PRIMASK(primask);
+
+    if (buf) {
+        buf->next = NULL;
+        buf->length = length;
+    }
+    return buf;
+}
+
+/**
+  * @brief  Returns a frame buffer to its pool in O(1)
+  * @param  buf: Buffer from DW_PoolAlloc, NULL is ignored
+  */
+void DW_PoolFree(DW_FrameBuf_t* buf)
+{
+    if (!buf || buf->pool_class >= DW_POOL_CLASSES) {
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    buf->next = dw_pool[buf->pool_class].free_list;
+    dw_pool[buf->pool_class].free_list = buf;
+    dw_pool[buf->pool_class].free++;
+    __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Returns pool usage and exhaustion counters
+  * @param  stats: Output statistics
+  */
+void DW_PoolGetStats(DW_PoolStats_t* stats)
+{
+    if (!stats) return;
+
+    for (uint8_t cls = 0; cls < DW_POOL_CLASSES; cls++) {
+        stats->block_size[cls] = dw_pool_size[cls];
+        stats->free[cls] = dw_pool[cls].free;
+        stats->min_free[cls] = dw_pool[cls].min_free;
+        stats->exhausted[cls] = dw_pool[cls].exhausted;
+    }
+    stats->failures = dw_pool_failures;
+}
+
+/* Private Functions */
+
+/**
+  * @brief  Links all blocks of one class into its free list
+  * @param  cls: Class index
+  * @param  storage: First word of the class storage
+  * @param  count: Number of blocks
+  * @param  words: Block size in 32-bit words
+  */
+static void DW_PoolInitClass(uint8_t cls, uint32_t* storage, uint16_t count, uint16_t words)
+{
+    dw_pool[cls].free_list = NULL;
+
+    for (uint16_t i = count; i > 0; i--) {
+        DW_FrameBuf_t* buf = (DW_FrameBuf_t*)&storage[(uint32_t)(i - 1) * words];
+        buf->capacity = dw_pool_size[cls];
+        buf->length = 0;
+        buf->pool_class = cls;
+        buf->next = dw_pool[cls].free_list;
+        dw_pool[cls].free_list = buf;
+    }
+
+    dw_pool[cls].free = count;
+    dw_pool[cls].min_free = count;
+    dw_pool[cls].exhausted = 0;
+}
@@ -0,0 +1,716 @@
+/**
+  * @file    DW_Group.c
+  * @brief   Group ranging: one poll, N staggered responses, one final
+  * @author  36dhe
+  * @date    Jul 14, 2025
+  */
+
+#include "DW_Group.h"
+#include "DW_RangeBias.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private Variables */
+
+typedef enum {
+    DW_GRP_IDLE,
+    DW_GRP_WAIT_RESP,       // Tag: poll started, responses expected
+    DW_GRP_WAIT_FINAL_TX,   // Tag: final scheduled
+    DW_GRP_WAIT_FINAL       // Anchor: response scheduled, final expected
+} DW_GroupState_t;
+
+static struct {
+    DW_GroupConfig_t cfg;
+    DW_GroupState_t state;
+    DW_Time_t reply_ticks;
+    DW_Time_t slot_ticks;
+    uint32_t slot_us;
+    uint32_t resp_air_us;
+    uint16_t tx_antd;           // Added by the chip to every TX timestamp
+    uint8_t seq;
+    uint32_t start_tick;
+    DW_TxHandle_t tx_handle;    // Tag: poll or final
+    bool rx_timeout_armed;
+    /* Tag: current round */
+    bool poll_sent;
+    DW_Time_t poll_tx;
+    DW_Time_t train_end;        // End of the last response slot
+    DW_Time_t resp_rx[DW_GRP_MAX_ANCHORS];  // 0 if the anchor was not heard
+    uint8_t n_results;
+    DW_RangeResult_t results[DW_GRP_MAX_ANCHORS];
+    /* Anchor: exchange waiting for its final */
+    uint16_t tag;
+    uint8_t slot;
+    DW_Time_t poll_rx;
+    DW_Time_t resp_tx;
+    DW_GroupStats_t stats;
+} dw_grp;
+
+/* Private Function Prototypes */
+static uint8_t DW_GroupTagEvent(const DW_Event_t* evt, DW_RangeResult_t* results);
+static void DW_GroupResponse(const DW_RxEvent_t* rx);
+static bool DW_GroupSendFinal(void);
+static uint8_t DW_GroupEndRound(DW_RangeResult_t* results);
+static uint8_t DW_GroupAnchorEvent(const DW_Event_t* evt, DW_RangeResult_t* results);
+static void DW_GroupPoll(const DW_RxEvent_t* rx);
+static uint8_t DW_GroupFinal(const DW_RxEvent_t* rx, DW_RangeResult_t* results);
+static void DW_GroupListen(void);
+
+/* Exported Functions */
+
+/**
+  * @brief  Configures the radio for group ranging in the given role
+  * @param  cfg: Role, addresses, reply delay and, for the tag, the anchors
+  * @note   The tag polls in response mode with both RX buffers, so the
+  *         driver re-arms the receiver after every response while the
+  *         previous one is read out. Anchors answer in delayed-response
+  *         mode; the receiver comes up by itself for the final.
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_GroupInit(const DW_GroupConfig_t* cfg)
+{
+    if (!cfg || (cfg->role == DW_RNG_ROLE_INITIATOR &&
+                 (cfg->n_anchors == 0 || cfg->n_anchors > DW_GRP_MAX_ANCHORS))) {
+        return HAL_ERROR;
+    }
+
+    memset(&dw_grp, 0, sizeof(dw_grp));
+    dw_grp.cfg = *cfg;
+    if (dw_grp.cfg.reply_delay_us == 0) {
+        dw_grp.cfg.reply_delay_us = DW_RNG_REPLY_DELAY_US;
+    }
+
+    /* 1. Slots from the response airtime; the last anchor's DS-TWR terms
+     *    must stay within DW_RNG_REPLY_DELAY_MAX_US */
+    const DW_PhyConfig_t* phy = DW_GetPhyConfig();
+    dw_grp.resp_air_us = DW_FrameAirtimeUs(phy, DW_GRP_RESP_LEN + DW_FCS_LEN);
+    dw_grp.slot_us = dw_grp.resp_air_us + DW_GRP_SLOT_GUARD_US;
+    if (dw_grp.cfg.reply_delay_us + DW_GRP_MAX_ANCHORS * dw_grp.slot_us +
+        DW_GRP_FINAL_DELAY_US + DW_GRP_FINAL_SLACK_US > DW_RNG_REPLY_DELAY_MAX_US) {
+        return HAL_ERROR;
+    }
+    dw_grp.reply_ticks = DW_TimeFromUs(dw_grp.cfg.reply_delay_us);
+    dw_grp.slot_ticks = DW_TimeFromUs(dw_grp.slot_us);
+
+    /* 2. Role-specific TX and RX modes */
+    DW_SetTxTimestamping(true);
+    DW_RxSetQualityCapture(cfg->bias_correction);
+    if (DW_RxSetContinuous(false) != HAL_OK ||
+        DW_RxSetDoubleBuffer(cfg->role == DW_RNG_ROLE_INITIATOR) != HAL_OK ||
+        DW_RxSetTimeouts(0, 0) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    if (cfg->role == DW_RNG_ROLE_INITIATOR) {
+        /* Receiver on before the first response's preamble */
+        uint32_t early_us = DW_FrameAirtimeUs(phy, DW_GRP_POLL_LEN(cfg->n_anchors) + DW_FCS_LEN) +
+                            dw_grp.resp_air_us + DW_RNG_RX_MARGIN_US;
+        uint32_t w4r_us = (dw_grp.cfg.reply_delay_us > early_us) ?
+                          dw_grp.cfg.reply_delay_us - early_us : 0;
+
+        if (DW_EnableTxMode(DW_TX_MODE_RESPONSE) != HAL_OK ||
+            DW_SetResponseDelay(w4r_us) != HAL_OK) {
+            return HAL_ERROR;
+        }
+    } else if (DW_EnableTxMode(DW_TX_MODE_DELAYED_RESPONSE) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    /* 3. The chip adds TX_ANTD to the programmed delayed TX time */
+    if (DW_ReadReg(DW_REG_TX_ANTD, (uint8_t*)&dw_grp.tx_antd, 2) != HAL_OK ||
+        DW_SpiSetFast(true) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    if (cfg->role == DW_RNG_ROLE_RESPONDER) {
+        DW_GroupListen();
+    }
+    return HAL_OK;
+}
+
+/**
+  * @brief  Starts a ranging round by broadcasting the poll (tag)
+  * @note   The round ends with the final; call DW_GroupRun() meanwhile so
+  *         the final goes out even if the last anchor is not heard.
+  * @retval HAL_OK if the poll was started, HAL_BUSY while a round is in
+  *         progress, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_GroupStart(void)
+{
+    DW_FrameBuilder_t fb;
+    uint8_t n = dw_grp.cfg.n_anchors;
+    uint8_t* p;
+
+    if (dw_grp.cfg.role != DW_RNG_ROLE_INITIATOR) {
+        return HAL_ERROR;
+    }
+
+    if (dw_grp.state != DW_GRP_IDLE) {
+        if (DW_GroupBusy()) {
+            return HAL_BUSY;
+        }
+        dw_grp.stats.errors++;
+        dw_grp.state = DW_GRP_IDLE;
+        DW_RxDisable();
+    }
+
+    /* 1. The last final was sent in delayed mode */
+    if (DW_EnableTxMode(DW_TX_MODE_RESPONSE) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    /* 2. Broadcast poll: function code, anchor count, anchors in slot order */
+    DW_FrameBegin(&fb);
+    if (DW_FrameWriteMacHeader(&fb, DW_FC_TYPE_DATA, ++dw_grp.seq, dw_grp.cfg.pan_id,
+                               0xFFFF, dw_grp.cfg.short_addr) != HAL_OK ||
+        (p = DW_FrameReserve(&fb, 2 + 2 * n)) == NULL) {
+        return HAL_ERROR;
+    }
+    *p++ = DW_GRP_FC_POLL;
+    *p++ = n;
+    for (uint8_t i = 0; i < n; i++) {
+        *p++ = (uint8_t)dw_grp.cfg.anchors[i];
+        *p++ = (uint8_t)(dw_grp.cfg.anchors[i] >> 8);
+    }
+
+    /* 3. Send; the receiver follows in response mode */
+    if (DW_FrameSend(&fb) != HAL_OK) {
+        dw_grp.stats.errors++;
+        return HAL_ERROR;
+    }
+
+    dw_grp.tx_handle = DW_GetLastTxHandle();
+    dw_grp.poll_sent = false;
+    memset(dw_grp.resp_rx, 0, sizeof(dw_grp.resp_rx));
+    dw_grp.n_results = 0;
+    dw_grp.start_tick = HAL_GetTick();
+    dw_grp.state = DW_GRP_WAIT_RESP;
+    dw_grp.stats.rounds++;
+    return HAL_OK;
+}
+
+/**
+  * @brief  Ends the response train on time; call from the main loop (tag)
+  * @note   Reads the DW1000 system time while responses are expected and
+  *         sends the final once the last slot is over.
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_GroupRun(void)
+{
+    DW_Time_t now;
+
+    if (dw_grp.cfg.role != DW_RNG_ROLE_INITIATOR ||
+        dw_grp.state != DW_GRP_WAIT_RESP || !dw_grp.poll_sent) {
+        return HAL_OK;
+    }
+
+    if (DW_ReadSysTime(&now) != HAL_OK) {
+        return HAL_ERROR;
+    }
+    if (DW_TimeBefore(now, dw_grp.train_end)) {
+        return HAL_OK;
+    }
+
+    return DW_GroupSendFinal() ? HAL_OK : HAL_ERROR;
+}
+
+/**
+  * @brief  Tells whether a round is in progress (tag)
+  * @retval true until the final was sent, failed or the round timed out
+  */
+bool DW_GroupBusy(void)
+{
+    return dw_grp.state != DW_GRP_IDLE &&
+           HAL_GetTick() - dw_grp.start_tick <= DW_GRP_ROUND_TIMEOUT_MS;
+}
+
+/**
+  * @brief  Feeds a driver event to the group ranging state machine
+  * @param  evt: Event from DW_GetEvent() or the event callback
+  * @param  results: Output ranges, room for DW_GRP_MAX_ANCHORS
+  * @note   RX frame buffers stay owned by the caller. The tag reports the
+  *         SS-TWR ranges of a round when its final has been sent; an anchor
+  *         reports its DS-TWR range when the final arrives.
+  * @retval Number of ranges written to results
+  */
+uint8_t DW_GroupHandleEvent(const DW_Event_t* evt, DW_RangeResult_t* results)
+{
+    if (!evt || !results) return 0;
+
+    if (dw_grp.cfg.role == DW_RNG_ROLE_RESPONDER) {
+        return DW_GroupAnchorEvent(evt, results);
+    }
+    return DW_GroupTagEvent(evt, results);
+}
+
+/**
+  * @brief  Returns group ranging statistics
+  * @param  stats: Output statistics
+  */
+void DW_GroupGetStats(DW_GroupStats_t* stats)
+{
+    if (stats) {
+        *stats = dw_grp.stats;
+    }
+}
+
+/**
+  * @brief  Measures the round rate and compares the airtime per round with
+  *         independent exchanges (tag)
+  * @param  n_rounds: Number of back-to-back rounds
+  * @param  bench: Output results
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_GroupBenchmark(uint32_t n_rounds, DW_GroupBench_t* bench)
+{
+    DW_RangeResult_t results[DW_GRP_MAX_ANCHORS];
+    DW_Event_t evt;
+    uint64_t round_cycles = 0;
+    uint32_t cyc_per_us = SystemCoreClock / 1000000;
+
+    if (!bench || n_rounds == 0 || dw_grp.cfg.role != DW_RNG_ROLE_INITIATOR) {
+        return HAL_ERROR;
+    }
+
+    memset(bench, 0, sizeof(*bench));
+    uint32_t ranges = dw_grp.stats.ranges;
+
+    DW_CycleCounterInit();
+    uint32_t start = DW_Cycles();
+
+    for (uint32_t i = 0; i < n_rounds; i++) {
+        if (DW_GroupStart() != HAL_OK) {
+            continue;
+        }
+        bench->rounds++;
+
+        uint32_t t0 = DW_Cycles();
+        while (DW_GroupBusy()) {
+            DW_GroupRun();
+            DW_ProcessEvents();
+            while (DW_GetEvent(&evt)) {
+                DW_GroupHandleEvent(&evt, results);
+                if (evt.type == DW_EVENT_RX_FRAME) {
+                    DW_PoolFree(evt.rx.frame);
+                }
+            }
+        }
+        round_cycles += DW_Cycles() - t0;
+    }
+
+    bench->total_cycles = DW_Cycles() - start;
+    bench->ranges = dw_grp.stats.ranges - ranges;
+    if (bench->total_cycles) {
+        bench->rounds_per_s = (uint32_t)((uint64_t)bench->rounds * SystemCoreClock / bench->total_cycles);
+    }
+    if (bench->rounds && cyc_per_us) {
+        bench->round_us = (uint32_t)(round_cycles / bench->rounds / cyc_per_us);
+    }
+
+    /* Airtime: N + 2 frames against 2N and 3N */
+    const DW_PhyConfig_t* phy = DW_GetPhyConfig();
+    uint8_t n = dw_grp.cfg.n_anchors;
+
+    bench->airtime_us = DW_FrameAirtimeUs(phy, DW_GRP_POLL_LEN(n) + DW_FCS_LEN) +
+                        n * dw_grp.resp_air_us +
+                        DW_FrameAirtimeUs(phy, DW_GRP_FINAL_LEN(n) + DW_FCS_LEN);
+    bench->airtime_ss_us = n * (DW_FrameAirtimeUs(phy, DW_RNG_POLL_LEN + DW_FCS_LEN) +
+                                DW_FrameAirtimeUs(phy, DW_RNG_RESP_LEN + DW_FCS_LEN));
+    bench->airtime_ds_us = bench->airtime_ss_us +
+                           n * DW_FrameAirtimeUs(phy, DW_RNG_FINAL_LEN + DW_FCS_LEN);
+    return HAL_OK;
+}
+
+/**
+  * @brief  Prints group ranging benchmark results
+  * @param  bench: Results from DW_GroupBenchmark()
+  */
+void DW_GroupPrintBench(const DW_GroupBench_t* bench)
+{
+    if (!bench || bench->rounds == 0) return;
+
+    printf("Group ranging: %u anchors, %lu ranges in %lu rounds, %lu rounds/s, round %lu us\n",
+           dw_grp.cfg.n_anchors, (unsigned long)bench->ranges, (unsigned long)bench->rounds,
+           (unsigned long)bench->rounds_per_s, (unsigned long)bench->round_us);
+    printf("  Airtime per round: %lu us (SS-TWR %lu us, DS-TWR %lu us), missed %lu, late %lu\n",
+           (unsigned long)bench->airtime_us, (unsigned long)bench->airtime_ss_us,
+           (unsigned long)bench->airtime_ds_us, (unsigned long)dw_grp.stats.missed,
+           (unsigned long)dw_grp.stats.late);
+}
+
+/* Private Functions */
+
+/**
+  * @brief  Tag: collects poll TX and the responses, then sends the final
+  * @param  evt: Driver event
+  * @param  results: Output ranges
+  * @retval Number of ranges written to results
+  */
+static uint8_t DW_GroupTagEvent(const DW_Event_t* evt, DW_RangeResult_t* results)
+{
+    switch (evt->type) {
+        case DW_EVENT_TX_DONE:
+            if (evt->tx.handle != dw_grp.tx_handle) {
+                return 0;
+            }
+            if (dw_grp.state == DW_GRP_WAIT_FINAL_TX) {
+                if (evt->tx.status == DW_TX_OK) {
+                    dw_grp.stats.finals++;
+                } else if (evt->tx.status == DW_TX_LATE) {
+                    dw_grp.stats.late++;
+                } else {
+                    dw_grp.stats.errors++;
+                }
+                return DW_GroupEndRound(results);
+            }
+            if (dw_grp.state != DW_GRP_WAIT_RESP) {
+                return 0;
+            }
+            if (evt->tx.status != DW_TX_OK) {
+                dw_grp.stats.errors++;
+                dw_grp.state = DW_GRP_IDLE;
+                DW_RxDisable();
+                return 0;
+            }
+            /* Responses end with the last slot */
+            dw_grp.poll_tx = evt->tx.tx_time;
+            dw_grp.train_end = DW_TimeAdd(dw_grp.poll_tx, dw_grp.reply_ticks +
+                                          dw_grp.cfg.n_anchors * dw_grp.slot_ticks);
+            dw_grp.poll_sent = true;
+            return 0;
+        case DW_EVENT_RX_TIMEOUT:
+        case DW_EVENT_RX_ERROR:
+            /* A lost response turns the receiver off; later slots may follow */
+            if (dw_grp.state == DW_GRP_WAIT_RESP) {
+                dw_grp.stats.errors++;
+                DW_RxEnable();
+            }
+            return 0;
+        case DW_EVENT_RX_FRAME:
+            if (dw_grp.state == DW_GRP_WAIT_RESP) {
+                DW_GroupResponse(&evt->rx);
+                if (dw_grp.state == DW_GRP_IDLE) {
+                    return DW_GroupEndRound(results);
+                }
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+/**
+  * @brief  Tag: computes the SS-TWR range of one response and sends the
+  *         final after the last anchor
+  * @param  rx: RX frame event
+  */
+static void DW_GroupResponse(const DW_RxEvent_t* rx)
+{
+    DW_MacHeader_t hdr;
+    uint8_t k;
+
+    const uint8_t* msg = DW_RangingParseMsg(rx, dw_grp.cfg.pan_id, dw_grp.cfg.short_addr,
+                                            DW_GRP_FC_RESP, DW_GRP_RESP_LEN, &hdr);
+    if (!msg || !dw_grp.poll_sent || hdr.seq != dw_grp.seq) {
+        dw_grp.stats.errors++;
+        return;
+    }
+
+    for (k = 0; k < dw_grp.cfg.n_anchors; k++) {
+        if (dw_grp.cfg.anchors[k] == (uint16_t)hdr.src_addr) break;
+    }
+    if (k == dw_grp.cfg.n_anchors || dw_grp.resp_rx[k]) {
+        dw_grp.stats.errors++;
+        return;
+    }
+
+    dw_grp.resp_rx[k] = rx->rx_time;
+    dw_grp.stats.responses++;
+
+    /* 1. ToF = (T_round - T_reply * (1 - e)), e from RX time tracking */
+    DW_Time_t poll_rx = DW_TimeUnpack(msg + 1);
+    DW_Time_t resp_tx = DW_TimeUnpack(msg + 1 + DW_TIME_BYTES);
+    int32_t ppb = rx->clock_offset_ppb;
+    bool offset_valid = (ppb != DW_RX_OFFSET_INVALID &&
+                         ppb < DW_RNG_OFFSET_MAX_PPB && ppb > -DW_RNG_OFFSET_MAX_PPB);
+
+    int64_t tof = DW_RangingSsTof((int64_t)DW_TimeSub(rx->rx_time, dw_grp.poll_tx),
+                                  (int64_t)DW_TimeSub(resp_tx, poll_rx), offset_valid ? ppb : 0);
+    int16_t rx_level = DW_DIAG_LEVEL_INVALID;
+
+    if (dw_grp.cfg.bias_correction) {
+        tof = DW_RangeBiasCorrect(rx, tof, &rx_level);
+    }
+
+    DW_RangeResult_t* r = &dw_grp.results[dw_grp.n_results++];
+    r->peer = dw_grp.cfg.anchors[k];
+    r->seq = dw_grp.seq;
+    r->tof_ticks = (int32_t)tof;
+    r->distance_mm = DW_TimeToMm(tof);
+    r->clock_offset_ppb = offset_valid ? ppb : 0;
+    r->offset_valid = offset_valid;
+    r->rx_level = rx_level;
+    dw_grp.stats.ranges++;
+
+    /* 2. No need to wait for the end of the train after the last anchor */
+    if (k == dw_grp.cfg.n_anchors - 1) {
+        DW_GroupSendFinal();
+    }
+}
+
+/**
+  * @brief  Tag: broadcasts the final with all response RX times
+  * @note   The final is due DW_GRP_FINAL_DELAY_US after the last slot;
+  *         anchors accept it up to DW_GRP_FINAL_SLACK_US later, so a late
+  *         end of the train only moves it.
+  * @retval true if the final was started, false if the round ended
+  */
+static bool DW_GroupSendFinal(void)
+{
+    DW_FrameBuilder_t fb;
+    DW_Time_t now;
+    uint8_t n = dw_grp.cfg.n_anchors;
+    uint8_t* p;
+
+    DW_RxDisable();
+    dw_grp.stats.missed += n - dw_grp.n_results;
+    dw_grp.state = DW_GRP_IDLE;
+
+    /* 1. Planned time, or as soon as possible if that has passed */
+    DW_Time_t at = DW_TimeAdd(dw_grp.train_end, DW_TimeFromUs(DW_GRP_FINAL_DELAY_US));
+    if (DW_ReadSysTime(&now) != HAL_OK) {
+        dw_grp.stats.errors++;
+        return false;
+    }
+    if (DW_TimeDiff(at, now) < (int64_t)DW_TimeFromUs(DW_RNG_TX_LEAD_US)) {
+        at = DW_TimeAdd(now, DW_TimeFromUs(DW_RNG_TX_LEAD_US));
+    }
+    at &= DW_TIME_DX_MASK;
+
+    /* 2. Function code, count, poll TX, final TX, response RX per anchor */
+    DW_FrameBegin(&fb);
+    if (DW_FrameWriteMacHeader(&fb, DW_FC_TYPE_DATA, dw_grp.seq, dw_grp.cfg.pan_id,
+                               0xFFFF, dw_grp.cfg.short_addr) != HAL_OK ||
+        (p = DW_FrameReserve(&fb, 2 + (2 + n) * DW_TIME_BYTES)) == NULL) {
+        dw_grp.stats.errors++;
+        return false;
+    }
+    *p++ = DW_GRP_FC_FINAL;
+    *p++ = n;
+    DW_TimePack(p, dw_grp.poll_tx);
+    p += DW_TIME_BYTES;
+    DW_TimePack(p, DW_TimeAdd(at, dw_grp.tx_antd));
+    p += DW_TIME_BYTES;
+    for (uint8_t i = 0; i < n; i++, p += DW_TIME_BYTES) {
+        DW_TimePack(p, dw_grp.resp_rx[i]);
+    }
+
+    if (DW_EnableTxMode(DW_TX_MODE_DELAYED) != HAL_OK ||
+        DW_SetDelayedTime(at) != HAL_OK || DW_FrameSend(&fb) != HAL_OK) {
+        dw_grp.stats.errors++;
+        return false;
+    }
+
+    dw_grp.tx_handle = DW_GetLastTxHandle();
+    dw_grp.state = DW_GRP_WAIT_FINAL_TX;
+    return true;
+}
+
+/**
+  * @brief  Tag: hands out the ranges of the round
+  * @param  results: Output ranges
+  * @retval Number of ranges
+  */
+static uint8_t DW_GroupEndRound(DW_RangeResult_t* results)
+{
+    uint8_t n = dw_grp.n_results;
+
+    memcpy(results, dw_grp.results, n * sizeof(DW_RangeResult_t));
+    dw_grp.n_results = 0;
+    dw_grp.state = DW_GRP_IDLE;
+    return n;
+}
+
+/**
+  * @brief  Anchor: answers polls in its slot and computes the range from
+  *         the final
+  * @param  evt: Driver event
+  * @param  results: Output range
+  * @retval 1 if a range was computed, 0 otherwise
+  */
+static uint8_t DW_GroupAnchorEvent(const DW_Event_t* evt, DW_RangeResult_t* results)
+{
+    if (evt->type == DW_EVENT_TX_DONE) {
+        if (evt->tx.status == DW_TX_LATE) {
+            dw_grp.stats.late++;
+            DW_GroupListen();
+        } else if (evt->tx.status != DW_TX_OK) {
+            dw_grp.stats.errors++;
+            DW_GroupListen();
+        } else if (dw_grp.state != DW_GRP_WAIT_FINAL) {
+            DW_GroupListen();
+        }
+        return 0;
+    }
+
+    /* Errors and timeouts leave the receiver off */
+    if (evt->type != DW_EVENT_RX_FRAME) {
+        if (dw_grp.state == DW_GRP_WAIT_FINAL) {
+            if (evt->type == DW_EVENT_RX_TIMEOUT) {
+                dw_grp.stats.timeouts++;
+            } else {
+                dw_grp.stats.errors++;
+            }
+        }
+        DW_GroupListen();
+        return 0;
+    }
+
+    if (dw_grp.state == DW_GRP_WAIT_FINAL) {
+        return DW_GroupFinal(&evt->rx, results);
+    }
+
+    DW_GroupPoll(&evt->rx);
+    return 0;
+}
+
+/**
+  * @brief  Anchor: schedules the response in its slot and the receiver for
+  *         the final
+  * @param  rx: RX frame event
+  */
+static void DW_GroupPoll(const DW_RxEvent_t* rx)
+{
+    DW_MacHeader_t hdr;
+    DW_FrameBuilder_t fb;
+    uint8_t* p;
+    uint8_t k;
+
+    const uint8_t* msg = DW_RangingParseMsg(rx, dw_grp.cfg.pan_id, dw_grp.cfg.short_addr,
+                                            DW_GRP_FC_POLL, DW_GRP_POLL_LEN(1), &hdr);
+    uint8_t n = msg ? msg[1] : 0;
+    if (!msg || (hdr.frame_ctrl & DW_FC_SRC_MODE_MASK) != DW_FC_SRC_SHORT ||
+        n == 0 || n > DW_GRP_MAX_ANCHORS || rx->info.length < hdr.length + 2 + 2 * n) {
+        DW_GroupListen();
+        return;
+    }
+
+    for (k = 0; k < n; k++) {
+        if ((uint16_t)(msg[2 + 2 * k] | msg[3 + 2 * k] << 8) == dw_grp.cfg.short_addr) break;
+    }
+    if (k == n) {
+        DW_GroupListen();
+        return;
+    }
+
+    /* 1. Receiver on after the response, early enough for the final */
+    uint32_t gap_us = (n - k) * dw_grp.slot_us + DW_GRP_FINAL_DELAY_US;
+    uint32_t final_air_us = DW_FrameAirtimeUs(DW_GetPhyConfig(), DW_GRP_FINAL_LEN(n) + DW_FCS_LEN);
+    uint32_t early_us = dw_grp.resp_air_us + final_air_us + DW_RNG_RX_MARGIN_US;
+    uint32_t w4r_us = (gap_us > early_us) ? gap_us - early_us : 0;
+    uint32_t fwto_us = gap_us + final_air_us + DW_RNG_RX_MARGIN_US + DW_GRP_FINAL_SLACK_US - w4r_us;
+
+    if (DW_SetResponseDelay(w4r_us) != HAL_OK || DW_RxSetTimeouts(fwto_us, 0) != HAL_OK) {
+        DW_GroupListen();
+        return;
+    }
+    dw_grp.rx_timeout_armed = true;
+
+    /* 2. Response in slot k carrying poll RX and response TX */
+    DW_Time_t tx_dx = DW_TimeAdd(rx->rx_time, dw_grp.reply_ticks + k * dw_grp.slot_ticks) & DW_TIME_DX_MASK;
+    DW_Time_t resp_tx = DW_TimeAdd(tx_dx, dw_grp.tx_antd);
+
+    DW_FrameBegin(&fb);
+    if (DW_FrameWriteMacHeader(&fb, DW_FC_TYPE_DATA, hdr.seq, dw_grp.cfg.pan_id,
+                               (uint16_t)hdr.src_addr, dw_grp.cfg.short_addr) != HAL_OK ||
+        (p = DW_FrameReserve(&fb, 1 + 2 * DW_TIME_BYTES)) == NULL) {
+        DW_GroupListen();
+        return;
+    }
+    p[0] = DW_GRP_FC_RESP;
+    DW_TimePack(p + 1, rx->rx_time);
+    DW_TimePack(p + 1 + DW_TIME_BYTES, resp_tx);
+
+    if (DW_SetDelayedTime(tx_dx) != HAL_OK || DW_FrameSend(&fb) != HAL_OK) {
+        dw_grp.stats.errors++;
+        DW_GroupListen();
+        return;
+    }
+
+    dw_grp.tag = (uint16_t)hdr.src_addr;
+    dw_grp.seq = hdr.seq;
+    dw_grp.slot = k;
+    dw_grp.poll_rx = rx->rx_time;
+    dw_grp.resp_tx = resp_tx;
+    dw_grp.state = DW_GRP_WAIT_FINAL;
+    dw_grp.stats.responses++;
+}
+
+/**
+  * @brief  Anchor: computes the DS-TWR range from the final
+  * @param  rx: RX frame event
+  * @param  results: Output range
+  * @retval 1 if a range was computed, 0 otherwise
+  */
+static uint8_t DW_GroupFinal(const DW_RxEvent_t* rx, DW_RangeResult_t* results)
+{
+    DW_MacHeader_t hdr;
+
+    DW_GroupListen();
+
+    const uint8_t* msg = DW_RangingParseMsg(rx, dw_grp.cfg.pan_id, dw_grp.cfg.short_addr,
+                                            DW_GRP_FC_FINAL, DW_GRP_FINAL_LEN(1), &hdr);
+    uint8_t n = msg ? msg[1] : 0;
+    if (!msg || (uint16_t)hdr.src_addr != dw_grp.tag || hdr.seq != dw_grp.seq ||
+        n <= dw_grp.slot || n > DW_GRP_MAX_ANCHORS ||
+        rx->info.length < hdr.length + 2 + (2 + n) * DW_TIME_BYTES) {
+        dw_grp.stats.errors++;
+        return 0;
+    }
+
+    DW_Time_t poll_tx = DW_TimeUnpack(msg + 2);
+    DW_Time_t final_tx = DW_TimeUnpack(msg + 2 + DW_TIME_BYTES);
+    DW_Time_t resp_rx = DW_TimeUnpack(msg + 2 + (2 + dw_grp.slot) * DW_TIME_BYTES);
+
+    /* The tag did not hear our response */
+    if (resp_rx == 0) {
+        return 0;
+    }
+
+    int64_t round1 = (int64_t)DW_TimeSub(resp_rx, poll_tx);
+    int64_t reply1 = (int64_t)DW_TimeSub(dw_grp.resp_tx, dw_grp.poll_rx);
+    int64_t round2 = (int64_t)DW_TimeSub(rx->rx_time, dw_grp.resp_tx);
+    int64_t reply2 = (int64_t)DW_TimeSub(final_tx, resp_rx);
+
+    if ((round1 | reply1 | round2 | reply2) >= ((int64_t)1 << 31)) {
+        dw_grp.stats.errors++;
+        return 0;
+    }
+
+    int64_t tof = DW_RangingDsTof(round1, reply1, round2, reply2);
+    int32_t ppb = rx->clock_offset_ppb;
+    int16_t rx_level = DW_DIAG_LEVEL_INVALID;
+
+    if (dw_grp.cfg.bias_correction) {
+        tof = DW_RangeBiasCorrect(rx, tof, &rx_level);
+    }
+
+    results->peer = dw_grp.tag;
+    results->seq = dw_grp.seq;
+    results->tof_ticks = (int32_t)tof;
+    results->distance_mm = DW_TimeToMm(tof);
+    results->offset_valid = (ppb != DW_RX_OFFSET_INVALID);
+    results->clock_offset_ppb = results->offset_valid ? ppb : 0;
+    results->rx_level = rx_level;
+    dw_grp.stats.ranges++;
+    return 1;
+}
+
+/**
+  * @brief  Anchor: turns the receiver back on for the next poll
+  */
+static void DW_GroupListen(void)
+{
+    dw_grp.state = DW_GRP_IDLE;
+    DW_RangingRxRestart(&dw_grp.rx_timeout_armed);
+}
@@ -0,0 +1,118 @@
+/**
+  * @file    DW_RangeBias.c
+  * @brief   Range bias correction by received signal level
+  * @author  36dhe
+  * @date    Jul 19, 2025
+  */
+
+#include "DW_RangeBias.h"
+#include <string.h>
+
+/* Private Variables */
+
+/* Measured minus true range in mm at -95, -91, ... -63 dBm estimated RX level */
+static struct {
+    int16_t bias_mm[DW_RBIAS_TABLES][DW_RBIAS_POINTS];
+} dw_rbias = {
+    .bias_mm = {
+        [DW_RBIAS_NB_16M] = { 110, 105,  80,  35, -10,  -60, -110, -170, -230 },
+        [DW_RBIAS_NB_64M] = {  60,  55,  40,  15, -20,  -50,  -85, -130, -170 },
+        [DW_RBIAS_WB_16M] = { 130, 120,  95,  45, -15,  -80, -150, -220, -280 },
+        [DW_RBIAS_WB_64M] = {  90,  80,  60,  25, -25,  -85, -150, -230, -300 }
+    }
+};
+
+/* Private Function Prototypes */
+static const int16_t* DW_RangeBiasTable(void);
+
+/* Exported Functions */
+
+/**
+  * @brief  Estimates the RX level of a frame from its captured quality
+  * @param  rx: RX frame event, with DW_RxSetQualityCapture() enabled
+  * @retval RX level in centi-dBm, DW_DIAG_LEVEL_INVALID without quality
+  */
+int16_t DW_RangeBiasRxLevel(const DW_RxEvent_t* rx)
+{
+    DW_RxDiag_t diag;
+
+    if (!rx || rx->quality.cir_power == 0) {
+        return DW_DIAG_LEVEL_INVALID;
+    }
+
+    DW_DiagFromQuality(&rx->quality, rx->info.preamble_count,
+                       rx->info.preamble_count == rx->quality.rxpacc_nosat, &diag);
+    return diag.rx_level;
+}
+
+/**
+  * @brief  Looks up the range bias for the active channel and PRF
+  * @param  rx_level: Estimated RX level, centi-dBm
+  * @note   Levels outside the table take the bias of the nearest end.
+  * @retval Bias in mm (measured - true), 0 for DW_DIAG_LEVEL_INVALID
+  */
+int32_t DW_RangeBiasMm(int16_t rx_level)
+{
+    const int32_t top = DW_RBIAS_LEVEL_MIN + (DW_RBIAS_POINTS - 1) * DW_RBIAS_STEP_CDBM;
+    const int16_t* t = DW_RangeBiasTable();
+
+    if (rx_level == DW_DIAG_LEVEL_INVALID) return 0;
+    if (rx_level <= DW_RBIAS_LEVEL_MIN) return t[0];
+    if (rx_level >= top) return t[DW_RBIAS_POINTS - 1];
+
+    /* Linear between the two neighbouring points */
+    int32_t pos = rx_level - DW_RBIAS_LEVEL_MIN;
+    int32_t i = pos / DW_RBIAS_STEP_CDBM;
+    int32_t frac = pos % DW_RBIAS_STEP_CDBM;
+
+    return t[i] + (t[i + 1] - t[i]) * frac / DW_RBIAS_STEP_CDBM;
+}
+
+/**
+  * @brief  Takes the level-dependent bias off a time of flight
+  * @param  rx: RX frame event the range was completed with
+  * @param  tof: Time of flight in ticks
+  * @param  rx_level: Output RX level in centi-dBm, may be NULL
+  * @note   Without captured quality the time of flight is returned as is.
+  * @retval Corrected time of flight in ticks
+  */
+int64_t DW_RangeBiasCorrect(const DW_RxEvent_t* rx, int64_t tof, int16_t* rx_level)
+{
+    int16_t level = DW_RangeBiasRxLevel(rx);
+
+    if (rx_level) {
+        *rx_level = level;
+    }
+    return tof - DW_TimeFromMm(DW_RangeBiasMm(level));
+}
+
+/**
+  * @brief  Replaces a bias table with measured values
+  * @param  table: Channel group and PRF
+  * @param  bias_mm: DW_RBIAS_POINTS biases in mm (measured - true), from
+  *         DW_RBIAS_LEVEL_MIN upwards in DW_RBIAS_STEP_CDBM steps
+  * @retval HAL_OK if successful, HAL_ERROR on invalid arguments
+  */
+HAL_StatusTypeDef DW_RangeBiasSetTable(DW_RangeBiasTable_t table, const int16_t* bias_mm)
+{
+    if (table >= DW_RBIAS_TABLES || !bias_mm) return HAL_ERROR;
+
+    memcpy(dw_rbias.bias_mm[table], bias_mm, sizeof(dw_rbias.bias_mm[table]));
+    return HAL_OK;
+}
+
+/* Private Functions */
+
+/**
+  * @brief  Selects the table for the active channel and PRF
+  * @retval Table of DW_RBIAS_POINTS biases
+  */
+static const int16_t* DW_RangeBiasTable(void)
+{
+    const DW_PhyConfig_t* phy = DW_GetPhyConfig();
+    bool wide = (phy->channel == 4 || phy->channel == 7);
+    bool prf64 = (phy->prf == DW_PRF_64M);
+
+    return dw_rbias.bias_mm[wide ? (prf64 ? DW_RBIAS_WB_64M : DW_RBIAS_WB_16M) :
+                                   (prf64 ? DW_RBIAS_NB_64M : DW_RBIAS_NB_16M)];
+}
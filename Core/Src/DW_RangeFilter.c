@@ -0,0 +1,297 @@
+/**
+  * @file    DW_RangeFilter.c
+  * @brief   Per-peer fixed-point Kalman range filter with outlier gating
+  * @author  36dhe
+  * @date    Jul 20, 2025
+  */
+
+#include "DW_RangeFilter.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private Variables */
+
+typedef struct {
+    bool used;
+    uint16_t addr;
+    uint16_t updates;           // Accepted since the last restart
+    uint8_t rejects;            // Consecutive
+    uint16_t ranges;            // Since the last estimate
+    uint16_t rejected;
+    uint32_t tick;              // State time
+    uint32_t report_tick;
+    int64_t r;                  // Q8 mm
+    int64_t v;                  // Q8 mm/s
+    int64_t p00;                // Q8 mm^2
+    int64_t p01;                // Q8 mm^2/s
+    int64_t p11;                // Q8 mm^2/s^2
+} DW_RangeFilterPeer_t;
+
+static struct {
+    DW_RangeFilterConfig_t cfg;
+    int64_t meas_var;           // R, Q8 mm^2
+    int64_t accel_var;          // Q8 mm^2/s^4
+    DW_RangeFilterPeer_t peers[DW_RFILT_MAX_PEERS];
+    DW_RangeFilterStats_t stats;
+} dw_rfilt;
+
+/* Private Function Prototypes */
+static DW_RangeFilterPeer_t* DW_RangeFilterFind(uint16_t addr, bool add);
+static void DW_RangeFilterRestart(DW_RangeFilterPeer_t* p, int32_t mm, uint32_t now);
+static void DW_RangeFilterPredict(DW_RangeFilterPeer_t* p, uint32_t dt_ms);
+static void DW_RangeFilterFill(const DW_RangeFilterPeer_t* p, DW_RangeEstimate_t* est);
+
+/* Exported Functions */
+
+/**
+  * @brief  Clears all peers and sets the noise model
+  * @param  cfg: Range and acceleration noise, gate and estimate interval;
+  *         NULL for the defaults
+  */
+void DW_RangeFilterInit(const DW_RangeFilterConfig_t* cfg)
+{
+    memset(&dw_rfilt, 0, sizeof(dw_rfilt));
+    if (cfg) {
+        dw_rfilt.cfg = *cfg;
+    }
+    if (dw_rfilt.cfg.meas_std_mm == 0) dw_rfilt.cfg.meas_std_mm = DW_RFILT_MEAS_STD_MM;
+    if (dw_rfilt.cfg.accel_mm_s2 == 0) dw_rfilt.cfg.accel_mm_s2 = DW_RFILT_ACCEL_MM_S2;
+    if (dw_rfilt.cfg.accel_mm_s2 > DW_RFILT_ACCEL_MAX) dw_rfilt.cfg.accel_mm_s2 = DW_RFILT_ACCEL_MAX;
+    if (dw_rfilt.cfg.gate_sigma == 0) dw_rfilt.cfg.gate_sigma = DW_RFILT_GATE_SIGMA;
+    if (dw_rfilt.cfg.report_ms == 0) dw_rfilt.cfg.report_ms = DW_RFILT_REPORT_MS;
+
+    dw_rfilt.meas_var = ((int64_t)dw_rfilt.cfg.meas_std_mm * dw_rfilt.cfg.meas_std_mm) << 8;
+    dw_rfilt.accel_var = ((int64_t)dw_rfilt.cfg.accel_mm_s2 * dw_rfilt.cfg.accel_mm_s2) << 8;
+}
+
+/**
+  * @brief  Feeds a range into the filter of its peer
+  * @param  range: Range from DW_RangingHandleEvent() or similar
+  * @param  est: Output estimate, written when one is due; may be NULL
+  * @note   About a dozen 64-bit multiplies and two divisions per range.
+  * @retval true if an estimate for this peer is due and was written
+  */
+bool DW_RangeFilterUpdate(const DW_RangeResult_t* range, DW_RangeEstimate_t* est)
+{
+    if (!range) return false;
+
+    uint32_t now = HAL_GetTick();
+    DW_RangeFilterPeer_t* p = DW_RangeFilterFind(range->peer, true);
+    int32_t z = range->distance_mm;
+
+    dw_rfilt.stats.ranges++;
+
+    /* 1. New peer or the state is too old to predict from */
+    if (p->updates == 0 || now - p->tick > DW_RFILT_MAX_GAP_MS) {
+        if (p->updates != 0) {
+            dw_rfilt.stats.restarts++;
+        }
+        DW_RangeFilterRestart(p, z, now);
+        return false;
+    }
+
+    DW_RangeFilterPredict(p, now - p->tick);
+    p->tick = now;
+
+    /* 2. Innovation gate: y^2 <= g^2 * S, y in Q8 so S is scaled by 2^8 */
+    int64_t y = ((int64_t)z << 8) - p->r;
+    int64_t s = p->p00 + dw_rfilt.meas_var;
+    int64_t g2 = (int64_t)dw_rfilt.cfg.gate_sigma * dw_rfilt.cfg.gate_sigma;
+
+    if (y >= ((int64_t)1 << 31) || y <= -((int64_t)1 << 31) || y * y > g2 * s * 256) {
+        p->rejected++;
+        dw_rfilt.stats.rejected++;
+        if (++p->rejects >= DW_RFILT_REJECT_LIMIT) {
+            dw_rfilt.stats.restarts++;
+            DW_RangeFilterRestart(p, z, now);
+        }
+        return false;
+    }
+
+    /* 3. Gains in Q16, K = P H^T / S; then P = (I - K H) P */
+    int64_t k0 = (p->p00 << 16) / s;
+    int64_t k1 = (p->p01 << 16) / s;
+
+    p->r += (k0 * y) >> 16;
+    p->v += (k1 * y) >> 16;
+    p->p11 -= (k1 * p->p01) >> 16;
+    p->p01 -= (k0 * p->p01) >> 16;
+    p->p00 -= (k0 * p->p00) >> 16;
+
+    p->rejects = 0;
+    p->ranges++;
+    if (p->updates < UINT16_MAX) {
+        p->updates++;
+    }
+
+    /* 4. Estimates at most once per report_ms */
+    if (p->updates < DW_RFILT_MIN_UPDATES || now - p->report_tick < dw_rfilt.cfg.report_ms) {
+        return false;
+    }
+
+    if (est) {
+        DW_RangeFilterFill(p, est);
+    }
+    p->report_tick = now;
+    p->ranges = 0;
+    p->rejected = 0;
+    dw_rfilt.stats.estimates++;
+    return true;
+}
+
+/**
+  * @brief  Returns the current estimate of a peer
+  * @param  peer: Short address
+  * @param  est: Output estimate at the time of the last range
+  * @retval true if the peer is known and its filter has settled
+  */
+bool DW_RangeFilterGet(uint16_t peer, DW_RangeEstimate_t* est)
+{
+    const DW_RangeFilterPeer_t* p = DW_RangeFilterFind(peer, false);
+
+    if (!p || !est || p->updates < DW_RFILT_MIN_UPDATES) {
+        return false;
+    }
+
+    DW_RangeFilterFill(p, est);
+    return true;
+}
+
+/**
+  * @brief  Forgets a peer
+  * @param  peer: Short address
+  */
+void DW_RangeFilterRemove(uint16_t peer)
+{
+    DW_RangeFilterPeer_t* p = DW_RangeFilterFind(peer, false);
+
+    if (p) {
+        p->used = false;
+    }
+}
+
+/**
+  * @brief  Returns filter statistics
+  * @param  stats: Output statistics
+  */
+void DW_RangeFilterGetStats(DW_RangeFilterStats_t* stats)
+{
+    if (!stats) return;
+
+    *stats = dw_rfilt.stats;
+    stats->peers = 0;
+    for (uint8_t i = 0; i < DW_RFILT_MAX_PEERS; i++) {
+        if (dw_rfilt.peers[i].used) {
+            stats->peers++;
+        }
+    }
+}
+
+/**
+  * @brief  Prints one estimate
+  * @param  est: Estimate from DW_RangeFilterUpdate() or DW_RangeFilterGet()
+  */
+void DW_RangeFilterPrintEstimate(const DW_RangeEstimate_t* est)
+{
+    if (!est) return;
+
+    printf("Range %04X: %ld mm +-%lu, %ld mm/s (%u ranges, %u rejected)\n", est->peer,
+           (long)est->distance_mm, (unsigned long)DW_Isqrt(est->variance_mm2),
+           (long)est->rate_mm_s, est->ranges, est->rejected);
+}
+
+/* Private Functions */
+
+/**
+  * @brief  Looks up a peer, optionally taking a slot for it
+  * @param  addr: Short address
+  * @param  add: Take a free slot, or the longest silent one, if not found
+  * @retval Peer state, NULL if not found and add is false
+  */
+static DW_RangeFilterPeer_t* DW_RangeFilterFind(uint16_t addr, bool add)
+{
+    DW_RangeFilterPeer_t* slot = NULL;
+    uint32_t now = HAL_GetTick();
+
+    for (uint8_t i = 0; i < DW_RFILT_MAX_PEERS; i++) {
+        DW_RangeFilterPeer_t* p = &dw_rfilt.peers[i];
+
+        if (p->used && p->addr == addr) {
+            return p;
+        }
+    }
+
+    if (!add) return NULL;
+
+    for (uint8_t i = 0; i < DW_RFILT_MAX_PEERS; i++) {
+        DW_RangeFilterPeer_t* p = &dw_rfilt.peers[i];
+
+        if (!p->used) {
+            slot = p;
+            break;
+        }
+        if (!slot || now - p->tick > now - slot->tick) {
+            slot = p;
+        }
+    }
+
+    if (slot->used) {
+        dw_rfilt.stats.evictions++;
+    }
+    memset(slot, 0, sizeof(*slot));
+    slot->used = true;
+    slot->addr = addr;
+    return slot;
+}
+
+/**
+  * @brief  Starts a peer's filter from one range
+  * @param  p: Peer state
+  * @param  mm: Range
+  * @param  now: HAL tick of the range
+  */
+static void DW_RangeFilterRestart(DW_RangeFilterPeer_t* p, int32_t mm, uint32_t now)
+{
+    p->r = (int64_t)mm << 8;
+    p->v = 0;
+    p->p00 = dw_rfilt.meas_var;
+    p->p01 = 0;
+    p->p11 = ((int64_t)DW_RFILT_INIT_RATE * DW_RFILT_INIT_RATE) << 8;
+    p->updates = 1;
+    p->rejects = 0;
+    p->tick = now;
+    p->report_tick = now;
+}
+
+/**
+  * @brief  Advances a peer's state by dt
+  * @param  p: Peer state
+  * @param  dt_ms: Time step, at most DW_RFILT_MAX_GAP_MS
+  * @note   P = F P F^T + Q with F = [1 dt; 0 1] and, for white acceleration
+  *         noise a, Q = a^2 [dt^4/4 dt^3/2; dt^3/2 dt^2].
+  */
+static void DW_RangeFilterPredict(DW_RangeFilterPeer_t* p, uint32_t dt_ms)
+{
+    int64_t dt = dt_ms;
+    int64_t q = dw_rfilt.accel_var * dt * dt / 1000000;     // a^2 dt^2, Q8 mm^2/s^2
+
+    p->r += p->v * dt / 1000;
+    p->p00 += 2 * p->p01 * dt / 1000 + p->p11 * dt * dt / 1000000 + q * dt * dt / 4000000;
+    p->p01 += p->p11 * dt / 1000 + q * dt / 2000;
+    p->p11 += q;
+}
+
+/**
+  * @brief  Converts a peer's state to an estimate
+  * @param  p: Peer state
+  * @param  est: Output estimate
+  */
+static void DW_RangeFilterFill(const DW_RangeFilterPeer_t* p, DW_RangeEstimate_t* est)
+{
+    est->peer = p->addr;
+    est->distance_mm = (int32_t)((p->r + 128) >> 8);
+    est->rate_mm_s = (int32_t)((p->v + 128) >> 8);
+    est->variance_mm2 = (uint32_t)((p->p00 + 128) >> 8);
+    est->ranges = p->ranges;
+    est->rejected = p->rejected;
+}
@@ -0,0 +1,1072 @@
+/**
+  * @file    DW_Ranging.c
+  * @brief   Single- and double-sided two-way ranging (SS-TWR / DS-TWR)
+  * @author  36dhe
+  * @date    Jul 8, 2025
+  */
+
+#include "DW_Ranging.h"
+#include "DW_RangeBias.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private Variables */
+
+typedef enum {
+    DW_RNG_IDLE,
+    DW_RNG_WAIT_RESP,       // Initiator: poll started, response expected
+    DW_RNG_WAIT_FINAL_TX,   // Initiator: delayed final scheduled (DS-TWR)
+    DW_RNG_WAIT_TX,         // Responder: delayed response scheduled (SS-TWR)
+    DW_RNG_WAIT_FINAL       // Responder: response scheduled, final expected (DS-TWR)
+} DW_RangingState_t;
+
+/* Clock offset estimate from pairs of remote TX / local RX timestamps */
+typedef struct {
+    bool prev_valid;
+    DW_Time_t prev_remote;
+    DW_Time_t prev_local;
+    bool valid;
+    int32_t ppb;
+} DW_RangingOffsetEst_t;
+
+static struct {
+    DW_RangingConfig_t cfg;
+    DW_RangingState_t state;
+    DW_Time_t reply_ticks;
+    DW_TxMode_t tx_mode;        // Initiator: mode set for the next poll or final
+    uint16_t tx_antd;           // Added by the chip to every TX timestamp
+    uint8_t seq;
+    uint32_t start_tick;
+    uint32_t timeout_ms;
+    uint32_t lead_ms;           // Initiator: delayed poll lead, added to the timeout
+    DW_TxHandle_t tx_handle;    // Poll (initiator) or final (DS-TWR initiator)
+    bool poll_sent;
+    DW_Time_t poll_tx;
+    uint32_t prev_tick;         // Initiator: last response, for the offset estimate
+    DW_RangingOffsetEst_t offset;
+    int32_t rx_offset_ppb;      // Initiator: RX time tracking offset of the last response
+    uint16_t peer;              // Responder polled last, or initiator awaited (DS-TWR)
+    /* DS-TWR responder: exchange waiting for its final */
+    DW_Time_t poll_rx;
+    DW_Time_t resp_tx;
+    uint32_t final_fwto_us;
+    bool rx_timeout_armed;
+    DW_RangingStats_t stats;
+} dw_rng;
+
+static uint32_t dw_rng_sim_seed = 0x2545F491;
+
+/* Private Function Prototypes */
+static HAL_StatusTypeDef DW_RangingPoll(uint16_t peer, bool delayed, DW_Time_t tx_time);
+static bool DW_RangingInitiatorEvent(const DW_Event_t* evt, DW_RangeResult_t* result);
+static bool DW_RangingResponderEvent(const DW_Event_t* evt, DW_RangeResult_t* result);
+static HAL_StatusTypeDef DW_RangingSendTimestamped(uint8_t fcode, uint16_t dst, uint8_t seq,
+                                                   DW_Time_t rx_time, const DW_Time_t* ts,
+                                                   uint8_t n_ts, DW_Time_t* tx_stamp);
+static bool DW_RangingFinal(const DW_RxEvent_t* rx, DW_RangeResult_t* result);
+static void DW_RangingRxWindow(uint16_t tx_len, uint16_t rx_len, uint32_t* w4r_us, uint32_t* fwto_us);
+static bool DW_RangingOffsetPpb(int64_t d_local, int64_t d_remote, int32_t* ppb);
+static void DW_RangingOffsetUpdate(DW_RangingOffsetEst_t* est, DW_Time_t remote, DW_Time_t local);
+static void DW_RangingListen(void);
+static uint32_t DW_RangingSimRand(uint32_t range);
+static int64_t DW_RangingSimDrift(int64_t t, int32_t ppb);
+static void DW_RangingSimAdd(DW_RangingSimError_t* acc, int64_t* sum, int64_t* sum_sq, int32_t err);
+
+/* Exported Functions */
+
+/**
+  * @brief  Configures the radio for ranging in the given role
+  * @param  cfg: Role, method, addresses and reply delay
+  * @note   The initiator sends polls in response mode: the receiver turns on
+  *         by itself shortly before the response is due and gives up with a
+  *         frame wait timeout. The responder listens and answers each poll
+  *         with a delayed transmission; for DS-TWR the receiver follows the
+  *         response in the same way to catch the final.
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_RangingInit(const DW_RangingConfig_t* cfg)
+{
+    uint32_t w4r_us, fwto_us;
+
+    if (!cfg) return HAL_ERROR;
+
+    memset(&dw_rng, 0, sizeof(dw_rng));
+    dw_rng.cfg = *cfg;
+    if (dw_rng.cfg.reply_delay_us == 0) {
+        dw_rng.cfg.reply_delay_us = DW_RNG_REPLY_DELAY_US;
+    }
+    if (dw_rng.cfg.reply_delay_us > DW_RNG_REPLY_DELAY_MAX_US) {
+        return HAL_ERROR;
+    }
+    dw_rng.reply_ticks = DW_TimeFromUs(dw_rng.cfg.reply_delay_us);
+    dw_rng.timeout_ms = DW_RNG_EXCHANGE_TIMEOUT_MS + 2 * dw_rng.cfg.reply_delay_us / 1000;
+
+    /* 1. One frame per RX enable, TX timestamps for every frame, RX
+     *    quality for the bias correction */
+    DW_SetTxTimestamping(true);
+    DW_RxSetQualityCapture(cfg->bias_correction);
+    if (DW_RxSetDoubleBuffer(false) != HAL_OK ||
+        DW_RxSetContinuous(false) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    /* 2. Mode-specific TX and RX timing */
+    if (cfg->role == DW_RNG_ROLE_INITIATOR) {
+        DW_RangingRxWindow(DW_RNG_POLL_LEN, DW_RNG_RESP_LEN, &w4r_us, &fwto_us);
+        dw_rng.tx_mode = DW_TX_MODE_RESPONSE;
+        if (DW_EnableTxMode(DW_TX_MODE_RESPONSE) != HAL_OK ||
+            DW_SetResponseDelay(w4r_us) != HAL_OK ||
+            DW_RxSetTimeouts(fwto_us, 0) != HAL_OK) {
+            return HAL_ERROR;
+        }
+    } else if (cfg->method == DW_RNG_DS_TWR) {
+        /* The frame wait timeout is only armed while a final is expected */
+        DW_RangingRxWindow(DW_RNG_RESP_LEN, DW_RNG_FINAL_LEN, &w4r_us, &dw_rng.final_fwto_us);
+        if (DW_EnableTxMode(DW_TX_MODE_DELAYED_RESPONSE) != HAL_OK ||
+            DW_SetResponseDelay(w4r_us) != HAL_OK ||
+            DW_RxSetTimeouts(0, 0) != HAL_OK) {
+            return HAL_ERROR;
+        }
+    } else {
+        if (DW_EnableTxMode(DW_TX_MODE_DELAYED) != HAL_OK ||
+            DW_RxSetTimeouts(0, 0) != HAL_OK) {
+            return HAL_ERROR;
+        }
+    }
+
+    /* 3. The chip adds TX_ANTD to the programmed delayed TX time */
+    if (DW_ReadReg(DW_REG_TX_ANTD, (uint8_t*)&dw_rng.tx_antd, 2) != HAL_OK ||
+        DW_SpiSetFast(true) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    if (cfg->role == DW_RNG_ROLE_RESPONDER) {
+        DW_RangingListen();
+    }
+    return HAL_OK;
+}
+
+/**
+  * @brief  Starts a ranging exchange by sending a poll (initiator)
+  * @note   An exchange that has not finished twice the reply delay plus
+  *         DW_RNG_EXCHANGE_TIMEOUT_MS after the poll is abandoned and
+  *         counted as a timeout.
+  * @retval HAL_OK if the poll was started, HAL_BUSY while an exchange is in
+  *         progress, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_RangingStart(void)
+{
+    return DW_RangingPoll(dw_rng.cfg.peer_addr, false, 0);
+}
+
+/**
+  * @brief  Starts a ranging exchange with a poll sent at a given time
+  * @param  peer: Responder short address
+  * @param  tx_time: DW1000 system time of the poll; the low 9 bits are
+  *         ignored by the chip
+  * @note   For schedulers that keep polls on the DW1000 clock. The poll is
+  *         not sent if tx_time is less than DW_RNG_TX_LEAD_US ahead, as a
+  *         late delayed TX is only detected by the driver TX timeout.
+  * @retval HAL_OK if the poll was scheduled, HAL_BUSY while an exchange is
+  *         in progress, HAL_TIMEOUT if tx_time is too close or has passed,
+  *         HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_RangingStartAt(uint16_t peer, DW_Time_t tx_time)
+{
+    return DW_RangingPoll(peer, true, tx_time);
+}
+
+/**
+  * @brief  Tells whether an exchange is in progress
+  * @retval true until the exchange completed, failed or timed out
+  */
+bool DW_RangingBusy(void)
+{
+    return dw_rng.state != DW_RNG_IDLE &&
+           HAL_GetTick() - dw_rng.start_tick <= dw_rng.timeout_ms + dw_rng.lead_ms;
+}
+
+/**
+  * @brief  Feeds a driver event to the ranging state machine
+  * @param  evt: Event from DW_GetEvent() or the event callback
+  * @param  result: Output range, may be NULL
+  * @note   RX frame buffers stay owned by the caller. Reply times are
+  *         counted from the RX timestamp, so RX events must be handled
+  *         within the reply delay. Ranges come out at the SS-TWR initiator
+  *         and at the DS-TWR responder.
+  * @retval true if a new range was written to result
+  */
+bool DW_RangingHandleEvent(const DW_Event_t* evt, DW_RangeResult_t* result)
+{
+    if (!evt) return false;
+
+    if (dw_rng.cfg.role == DW_RNG_ROLE_RESPONDER) {
+        return DW_RangingResponderEvent(evt, result);
+    }
+    return DW_RangingInitiatorEvent(evt, result);
+}
+
+/**
+  * @brief  Returns ranging statistics
+  * @param  stats: Output statistics
+  */
+void DW_RangingGetStats(DW_RangingStats_t* stats)
+{
+    if (stats) {
+        *stats = dw_rng.stats;
+    }
+}
+
+/**
+  * @brief  Measures the sustained ranging rate against one responder
+  * @param  n_exchanges: Number of back-to-back exchanges
+  * @param  bench: Output results
+  * @note   Each poll is sent as soon as the previous exchange has ended, so
+  *         the rate is bounded by the reply delays, the airtime and the SPI
+  *         work on both sides. DS-TWR ranges are computed by the responder;
+  *         here they are counted as finals sent.
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_RangingBenchmark(uint32_t n_exchanges, DW_RangingBench_t* bench)
+{
+    DW_RangeResult_t result;
+    DW_Event_t evt;
+    int64_t sum_mm = 0;
+    uint32_t ss_ranges = 0;
+
+    if (!bench || n_exchanges == 0 || dw_rng.cfg.role != DW_RNG_ROLE_INITIATOR) {
+        return HAL_ERROR;
+    }
+
+    memset(bench, 0, sizeof(*bench));
+    bench->min_mm = INT32_MAX;
+    bench->max_mm = INT32_MIN;
+
+    uint32_t done = dw_rng.stats.ranges + dw_rng.stats.finals;
+
+    DW_CycleCounterInit();
+    uint32_t start = DW_Cycles();
+
+    for (uint32_t i = 0; i < n_exchanges; i++) {
+        if (DW_RangingStart() != HAL_OK) {
+            continue;
+        }
+        bench->exchanges++;
+
+        while (DW_RangingBusy()) {
+            DW_ProcessEvents();
+            while (DW_GetEvent(&evt)) {
+                if (DW_RangingHandleEvent(&evt, &result)) {
+                    ss_ranges++;
+                    sum_mm += result.distance_mm;
+                    if (result.distance_mm < bench->min_mm) bench->min_mm = result.distance_mm;
+                    if (result.distance_mm > bench->max_mm) bench->max_mm = result.distance_mm;
+                }
+                if (evt.type == DW_EVENT_RX_FRAME) {
+                    DW_PoolFree(evt.rx.frame);
+                }
+            }
+        }
+    }
+
+    bench->total_cycles = DW_Cycles() - start;
+    bench->ranges = dw_rng.stats.ranges + dw_rng.stats.finals - done;
+
+    const DW_PhyConfig_t* phy = DW_GetPhyConfig();
+    bench->airtime_us = DW_FrameAirtimeUs(phy, DW_RNG_POLL_LEN + DW_FCS_LEN) +
+                        DW_FrameAirtimeUs(phy, DW_RNG_RESP_LEN + DW_FCS_LEN);
+    if (dw_rng.cfg.method == DW_RNG_DS_TWR) {
+        bench->airtime_us += DW_FrameAirtimeUs(phy, DW_RNG_FINAL_LEN + DW_FCS_LEN);
+    }
+    bench->ranges_per_s = (uint32_t)((uint64_t)bench->ranges * SystemCoreClock / bench->total_cycles);
+    if (ss_ranges) {
+        bench->mean_mm = (int32_t)(sum_mm / ss_ranges);
+    } else {
+        bench->min_mm = bench->max_mm = 0;
+    }
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Prints ranging benchmark results
+  * @param  bench: Results from DW_RangingBenchmark()
+  */
+void DW_RangingPrintBench(const DW_RangingBench_t* bench)
+{
+    uint32_t cyc_per_us = SystemCoreClock / 1000000;
+
+    if (!bench || bench->exchanges == 0 || cyc_per_us == 0) {
+        return;
+    }
+
+    printf("%s: %lu/%lu ranges, %lu ranges/s\n",
+           (dw_rng.cfg.method == DW_RNG_DS_TWR) ? "DS-TWR" : "SS-TWR",
+           (unsigned long)bench->ranges, (unsigned long)bench->exchanges,
+           (unsigned long)bench->ranges_per_s);
+    printf("  Per exchange: %lu us, airtime %lu us, reply delay %lu us\n",
+           (unsigned long)(bench->total_cycles / cyc_per_us / bench->exchanges),
+           (unsigned long)bench->airtime_us, (unsigned long)dw_rng.cfg.reply_delay_us);
+    if (dw_rng.cfg.method == DW_RNG_SS_TWR) {
+        printf("  Distance: mean %ld mm, min %ld mm, max %ld mm\n",
+               (long)bench->mean_mm, (long)bench->min_mm, (long)bench->max_mm);
+        printf("  Clock offset: %ld ppb from RX tracking, %ld ppb from timestamps\n",
+               (long)dw_rng.rx_offset_ppb, (long)dw_rng.offset.ppb);
+    }
+}
+
+/**
+  * @brief  Compares SS-TWR and DS-TWR on a simulated clock drift model
+  * @param  model: Distance, crystal offset, reply delays and noise
+  * @param  sim: Output errors, update rates and computation cost
+  * @note   Timestamps are generated with 1/64-tick resolution from the
+  *         initiator clock, quantised to whole ticks and wrap at 40 bits
+  *         like on the chip. The consecutive-response estimate is counted
+  *         from the second exchange on, when it becomes valid; the RX time
+  *         tracking estimate is the true offset plus uniform noise. Delayed TX drops the low 9 bits of DX_TIME as
+  *         the DW1000 does, so reply times vary by up to 8 ns even without
+  *         jitter. Rates are upper bounds from the airtime of the current
+  *         PHY configuration plus the reply delays.
+  * @retval HAL_OK if successful, HAL_ERROR on invalid model
+  */
+HAL_StatusTypeDef DW_RangingSimulate(const DW_RangingSimModel_t* model, DW_RangingSim_t* sim)
+{
+    DW_RangingOffsetEst_t est = {0};
+    int64_t sum[4] = {0}, sum_sq[4] = {0};
+    uint32_t n[4] = {0};
+    uint64_t ss_cycles = 0, ds_cycles = 0;
+
+    if (!model || !sim || model->iterations == 0 ||
+        model->reply1_us + model->jitter_us > DW_RNG_REPLY_DELAY_MAX_US ||
+        model->reply2_us + model->jitter_us > DW_RNG_REPLY_DELAY_MAX_US) {
+        return HAL_ERROR;
+    }
+
+    memset(sim, 0, sizeof(*sim));
+
+    /* True time of flight in 1/64 tick (4.6917 mm per tick) */
+    int64_t tof = ((int64_t)model->distance_mm << 22) / 307480;
+    int64_t period = (int64_t)DW_TimeFromUs(model->period_us) << 6;
+    int32_t e = model->offset_ppb;
+    uint16_t noise = model->noise_ticks;
+    uint16_t rx_noise = model->rx_offset_noise_ppb;
+
+    /* Local clocks at the start of an exchange: whole ticks plus 1/64 fraction */
+    DW_Time_t a0 = 0x123456789AULL, b0 = 0xFFFFF00000ULL;   // B wraps during the run
+    int64_t fa = 0, fb = 0;
+
+    DW_CycleCounterInit();
+
+    for (uint32_t i = 0; i < model->iterations; i++) {
+        e = model->offset_ppb + (int32_t)((int64_t)model->drift_ppb_s * i * model->period_us / 1000000);
+
+        /* 1. Poll leaves A at t = 0 and reaches B after the ToF */
+        DW_Time_t poll_tx = DW_TimeAdd(a0, (DW_Time_t)(fa >> 6));
+        int64_t t = tof;
+        DW_Time_t poll_rx = DW_TimeAdd(b0, (DW_Time_t)((fb + t + DW_RangingSimDrift(t, e)) >> 6) +
+                                           (int32_t)DW_RangingSimRand(2u * noise + 1) - noise);
+
+        /* 2. Delayed response; the true TX time follows from B's clock */
+        uint32_t jit = DW_RangingSimRand(model->jitter_us + 1);
+        DW_Time_t resp_tx = DW_TimeAdd(poll_rx, DW_TimeFromUs(model->reply1_us + jit)) & DW_TIME_DX_MASK;
+        int64_t local = ((int64_t)DW_TimeSub(resp_tx, b0) << 6) - fb;
+        t = local - local * e / (1000000000 + e) + tof;
+        DW_Time_t resp_rx = DW_TimeAdd(a0, (DW_Time_t)((fa + t) >> 6) +
+                                           (int32_t)DW_RangingSimRand(2u * noise + 1) - noise);
+
+        /* 3. Delayed final from A */
+        jit = DW_RangingSimRand(model->jitter_us + 1);
+        DW_Time_t final_tx = DW_TimeAdd(resp_rx, DW_TimeFromUs(model->reply2_us + jit)) & DW_TIME_DX_MASK;
+        t = ((int64_t)DW_TimeSub(final_tx, a0) << 6) - fa + tof;
+        DW_Time_t final_rx = DW_TimeAdd(b0, (DW_Time_t)((fb + t + DW_RangingSimDrift(t, e)) >> 6) +
+                                            (int32_t)DW_RangingSimRand(2u * noise + 1) - noise);
+
+        /* 4. Same computations as on the radio */
+        int64_t round1 = (int64_t)DW_TimeSub(resp_rx, poll_tx);
+        int64_t reply1 = (int64_t)DW_TimeSub(resp_tx, poll_rx);
+        int64_t round2 = (int64_t)DW_TimeSub(final_rx, resp_tx);
+        int64_t reply2 = (int64_t)DW_TimeSub(final_tx, resp_rx);
+
+        uint32_t c0 = DW_Cycles();
+        DW_RangingOffsetUpdate(&est, resp_tx, resp_rx);
+        int64_t ss = DW_RangingSsTof(round1, reply1, est.ppb);
+        uint32_t c1 = DW_Cycles();
+        int64_t ds = DW_RangingDsTof(round1, reply1, round2, reply2);
+        uint32_t c2 = DW_Cycles();
+
+        ss_cycles += c1 - c0;
+        ds_cycles += c2 - c1;
+
+        /* The RX tracking estimate is the current offset plus noise */
+        int32_t rx_ppb = e + (int32_t)DW_RangingSimRand(2u * rx_noise + 1) - rx_noise;
+        int64_t ss_rx = DW_RangingSsTof(round1, reply1, rx_ppb);
+
+        DW_RangingSimAdd(&sim->ss_raw, &sum[0], &sum_sq[0],
+                         DW_TimeToMm(DW_RangingSsTof(round1, reply1, 0)) - model->distance_mm);
+        n[0]++;
+        if (est.valid) {
+            DW_RangingSimAdd(&sim->ss, &sum[1], &sum_sq[1], DW_TimeToMm(ss) - model->distance_mm);
+            n[1]++;
+        }
+        DW_RangingSimAdd(&sim->ss_rx, &sum[2], &sum_sq[2], DW_TimeToMm(ss_rx) - model->distance_mm);
+        n[2]++;
+        DW_RangingSimAdd(&sim->ds, &sum[3], &sum_sq[3], DW_TimeToMm(ds) - model->distance_mm);
+        n[3]++;
+
+        /* 5. Advance both clocks to the next exchange */
+        fa += period;
+        a0 = DW_TimeAdd(a0, (DW_Time_t)(fa >> 6));
+        fa &= 0x3F;
+        fb += period + DW_RangingSimDrift(period, e);
+        b0 = DW_TimeAdd(b0, (DW_Time_t)(fb >> 6));
+        fb &= 0x3F;
+    }
+
+    /* Mean and standard deviation from the sums */
+    DW_RangingSimError_t* err[4] = { &sim->ss_raw, &sim->ss, &sim->ss_rx, &sim->ds };
+    for (uint8_t k = 0; k < 4; k++) {
+        if (n[k] == 0) continue;
+
+        int64_t mean = sum[k] / (int64_t)n[k];
+        int64_t var = sum_sq[k] / n[k] - mean * mean;
+
+        err[k]->mean_mm = (int32_t)mean;
+        err[k]->std_mm = (int32_t)DW_Isqrt(var > 0 ? (uint64_t)var : 0);
+    }
+
+    const DW_PhyConfig_t* phy = DW_GetPhyConfig();
+    if (phy->channel == 0) {
+        phy = &DW_PHY_DEFAULT;
+    }
+    uint32_t ss_us = DW_FrameAirtimeUs(phy, DW_RNG_POLL_LEN + DW_FCS_LEN) +
+                     DW_FrameAirtimeUs(phy, DW_RNG_RESP_LEN + DW_FCS_LEN) +
+                     model->reply1_us + model->jitter_us / 2;
+    uint32_t ds_us = ss_us + DW_FrameAirtimeUs(phy, DW_RNG_FINAL_LEN + DW_FCS_LEN) +
+                     model->reply2_us + model->jitter_us / 2;
+
+    sim->ss_ranges_per_s = 1000000 / ss_us;
+    sim->ds_ranges_per_s = 1000000 / ds_us;
+    sim->ss_cycles = (uint32_t)(ss_cycles / model->iterations);
+    sim->ds_cycles = (uint32_t)(ds_cycles / model->iterations);
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Prints ranging simulation results
+  * @param  model: Simulated model
+  * @param  sim: Results from DW_RangingSimulate()
+  */
+void DW_RangingPrintSim(const DW_RangingSimModel_t* model, const DW_RangingSim_t* sim)
+{
+    if (!model || !sim) return;
+
+    printf("TWR sim: %ld mm, offset %ld ppb %+ld ppb/s, reply %lu/%lu us (+0..%lu us), noise +-%u ticks\n",
+           (long)model->distance_mm, (long)model->offset_ppb, (long)model->drift_ppb_s,
+           (unsigned long)model->reply1_us, (unsigned long)model->reply2_us,
+           (unsigned long)model->jitter_us, model->noise_ticks);
+    printf("  SS-TWR raw:       bias %ld mm, std %ld mm, max %ld mm\n",
+           (long)sim->ss_raw.mean_mm, (long)sim->ss_raw.std_mm, (long)sim->ss_raw.max_abs_mm);
+    printf("  SS-TWR corrected: bias %ld mm, std %ld mm, max %ld mm, %lu ranges/s, %lu cycles\n",
+           (long)sim->ss.mean_mm, (long)sim->ss.std_mm, (long)sim->ss.max_abs_mm,
+           (unsigned long)sim->ss_ranges_per_s, (unsigned long)sim->ss_cycles);
+    printf("  SS-TWR RX offset: bias %ld mm, std %ld mm, max %ld mm (+-%u ppb)\n",
+           (long)sim->ss_rx.mean_mm, (long)sim->ss_rx.std_mm, (long)sim->ss_rx.max_abs_mm,
+           model->rx_offset_noise_ppb);
+    printf("  DS-TWR:           bias %ld mm, std %ld mm, max %ld mm, %lu ranges/s, %lu cycles\n",
+           (long)sim->ds.mean_mm, (long)sim->ds.std_mm, (long)sim->ds.max_abs_mm,
+           (unsigned long)sim->ds_ranges_per_s, (unsigned long)sim->ds_cycles);
+}
+
+/**
+  * @brief  SS-TWR time of flight
+  * @param  t_round: Poll TX to response RX, our clock
+  * @param  t_reply: Poll RX to response TX, responder clock
+  * @param  offset_ppb: Responder clock offset relative to ours
+  * @retval Time of flight in ticks
+  */
+int64_t DW_RangingSsTof(int64_t t_round, int64_t t_reply, int32_t offset_ppb)
+{
+    return (t_round - t_reply + t_reply * offset_ppb / 1000000000) / 2;
+}
+
+/**
+  * @brief  DS-TWR time of flight, asymmetric formula
+  * @param  round1: Poll TX to response RX, initiator clock
+  * @param  reply1: Poll RX to response TX, responder clock
+  * @param  round2: Response TX to final RX, responder clock
+  * @param  reply2: Response RX to final TX, initiator clock
+  * @note   All terms must be below 2^31 ticks.
+  * @retval Time of flight in ticks
+  */
+int64_t DW_RangingDsTof(int64_t round1, int64_t reply1, int64_t round2, int64_t reply2)
+{
+    int64_t den = round1 + round2 + reply1 + reply2;
+
+    return den ? (round1 * round2 - reply1 * reply2) / den : 0;
+}
+
+/**
+  * @brief  Checks that a received frame is a ranging message for us
+  * @param  rx: RX frame event
+  * @param  pan_id: Our PAN
+  * @param  short_addr: Our address; broadcasts are accepted as well
+  * @param  fcode: Expected function code
+  * @param  min_len: Minimum length with a short-address header
+  * @param  hdr: Output parsed MAC header
+  * @note   Shared by the ranging protocols built on this module.
+  * @retval Pointer to the function code, NULL if the frame does not match
+  */
+const uint8_t* DW_RangingParseMsg(const DW_RxEvent_t* rx, uint16_t pan_id, uint16_t short_addr,
+                                  uint8_t fcode, uint16_t min_len, DW_MacHeader_t* hdr)
+{
+    /* Without a valid leading edge the RX timestamp is useless */
+    if (!rx->frame || rx->status != DW_RX_OK || rx->info.length < min_len ||
+        DW_MacParseHeader(rx->frame->data, rx->info.length, hdr) != HAL_OK) {
+        return NULL;
+    }
+
+    if ((hdr->frame_ctrl & DW_FC_TYPE_MASK) != DW_FC_TYPE_DATA ||
+        hdr->dst_pan != pan_id ||
+        (hdr->dst_addr != short_addr && hdr->dst_addr != 0xFFFF) ||
+        rx->info.length < hdr->length + (min_len - DW_MAC_HDR_SHORT_LEN) ||
+        rx->frame->data[hdr->length] != fcode) {
+        return NULL;
+    }
+
+    return &rx->frame->data[hdr->length];
+}
+
+/**
+  * @brief  Responder side: drops a pending reply timeout and turns the
+  *         receiver back on for the next poll
+  * @param  timeout_armed: Caller's flag for a timeout set with
+  *         DW_RxSetTimeouts(); cleared here
+  */
+void DW_RangingRxRestart(bool* timeout_armed)
+{
+    if (*timeout_armed) {
+        DW_RxSetTimeouts(0, 0);
+        *timeout_armed = false;
+    }
+    DW_RxEnable();
+}
+
+/* Private Functions */
+
+/**
+  * @brief  Sends a poll, immediately or delayed, and waits for the response
+  * @param  peer: Responder short address
+  * @param  delayed: true to send at tx_time
+  * @param  tx_time: DW1000 system time of the poll if delayed
+  * @retval HAL_OK if the poll was started, HAL_BUSY while an exchange is in
+  *         progress, HAL_TIMEOUT if tx_time is too close, HAL_ERROR on failure
+  */
+static HAL_StatusTypeDef DW_RangingPoll(uint16_t peer, bool delayed, DW_Time_t tx_time)
+{
+    DW_FrameBuilder_t fb;
+    uint32_t lead_ms = 0;
+    uint8_t* p;
+
+    if (dw_rng.cfg.role != DW_RNG_ROLE_INITIATOR) {
+        return HAL_ERROR;
+    }
+
+    if (dw_rng.state != DW_RNG_IDLE) {
+        if (DW_RangingBusy()) {
+            return HAL_BUSY;
+        }
+        dw_rng.stats.timeouts++;
+        dw_rng.state = DW_RNG_IDLE;
+        DW_RxDisable();
+    }
+
+    /* 1. A delayed poll must leave time to load the frame */
+    if (delayed) {
+        DW_Time_t now;
+
+        if (DW_ReadSysTime(&now) != HAL_OK) {
+            return HAL_ERROR;
+        }
+        int64_t lead = DW_TimeDiff(tx_time & DW_TIME_DX_MASK, now);
+        if (lead < (int64_t)DW_TimeFromUs(DW_RNG_TX_LEAD_US)) {
+            dw_rng.stats.late++;
+            return HAL_TIMEOUT;
+        }
+        lead_ms = DW_TimeToUs((DW_Time_t)lead) / 1000;
+    }
+
+    /* 2. The offset estimate from response timestamps is per responder */
+    if (peer != dw_rng.peer) {
+        memset(&dw_rng.offset, 0, sizeof(dw_rng.offset));
+        dw_rng.peer = peer;
+    }
+
+    /* 3. DS-TWR sends its finals in delayed mode */
+    DW_TxMode_t mode = delayed ? DW_TX_MODE_DELAYED_RESPONSE : DW_TX_MODE_RESPONSE;
+    if (mode != dw_rng.tx_mode) {
+        if (DW_EnableTxMode(mode) != HAL_OK) {
+            return HAL_ERROR;
+        }
+        dw_rng.tx_mode = mode;
+    }
+
+    /* 4. Poll: MAC header and function code */
+    DW_FrameBegin(&fb);
+    if (DW_FrameWriteMacHeader(&fb, DW_FC_TYPE_DATA, ++dw_rng.seq, dw_rng.cfg.pan_id,
+                               peer, dw_rng.cfg.short_addr) != HAL_OK ||
+        (p = DW_FrameReserve(&fb, 1)) == NULL) {
+        return HAL_ERROR;
+    }
+    p[0] = DW_RNG_FC_POLL;
+
+    /* 5. Send; the receiver follows automatically in response mode */
+    if ((delayed && DW_SetDelayedTime(tx_time) != HAL_OK) || DW_FrameSend(&fb) != HAL_OK) {
+        dw_rng.stats.errors++;
+        return HAL_ERROR;
+    }
+
+    dw_rng.tx_handle = DW_GetLastTxHandle();
+    dw_rng.poll_sent = false;
+    dw_rng.start_tick = HAL_GetTick();
+    dw_rng.lead_ms = lead_ms;
+    dw_rng.state = DW_RNG_WAIT_RESP;
+    dw_rng.stats.polls++;
+    return HAL_OK;
+}
+
+/**
+  * @brief  Initiator: collects poll TX and response RX, then computes the
+  *         SS-TWR range or sends the DS-TWR final
+  * @param  evt: Driver event
+  * @param  result: Output range, may be NULL
+  * @retval true if a new range was computed
+  */
+static bool DW_RangingInitiatorEvent(const DW_Event_t* evt, DW_RangeResult_t* result)
+{
+    DW_MacHeader_t hdr;
+
+    switch (evt->type) {
+        case DW_EVENT_TX_DONE:
+            if (evt->tx.handle != dw_rng.tx_handle) {
+                return false;
+            }
+            if (dw_rng.state == DW_RNG_WAIT_FINAL_TX) {
+                if (evt->tx.status == DW_TX_OK) {
+                    dw_rng.stats.finals++;
+                } else if (evt->tx.status == DW_TX_LATE) {
+                    dw_rng.stats.late++;
+                } else {
+                    dw_rng.stats.errors++;
+                }
+                dw_rng.state = DW_RNG_IDLE;
+                return false;
+            }
+            if (dw_rng.state != DW_RNG_WAIT_RESP) {
+                return false;
+            }
+            if (evt->tx.status != DW_TX_OK) {
+                dw_rng.stats.errors++;
+                dw_rng.state = DW_RNG_IDLE;
+                DW_RxDisable();
+                return false;
+            }
+            dw_rng.poll_tx = evt->tx.tx_time;
+            dw_rng.poll_sent = true;
+            return false;
+        case DW_EVENT_RX_TIMEOUT:
+        case DW_EVENT_RX_ERROR:
+            if (dw_rng.state == DW_RNG_WAIT_RESP) {
+                if (evt->type == DW_EVENT_RX_TIMEOUT) {
+                    dw_rng.stats.timeouts++;
+                } else {
+                    dw_rng.stats.errors++;
+                }
+                dw_rng.state = DW_RNG_IDLE;
+            }
+            return false;
+        case DW_EVENT_RX_FRAME:
+            if (dw_rng.state == DW_RNG_WAIT_RESP) {
+                break;
+            }
+            return false;
+        default:
+            return false;
+    }
+
+    /* 1. The receiver is off after any frame: this was the response or the
+     *    exchange is lost */
+    dw_rng.state = DW_RNG_IDLE;
+
+    const uint8_t* msg = DW_RangingParseMsg(&evt->rx, dw_rng.cfg.pan_id, dw_rng.cfg.short_addr,
+                                            DW_RNG_FC_RESP, DW_RNG_RESP_LEN, &hdr);
+    if (!msg || !dw_rng.poll_sent || hdr.seq != dw_rng.seq ||
+        (uint16_t)hdr.src_addr != dw_rng.peer) {
+        dw_rng.stats.errors++;
+        return false;
+    }
+
+    DW_Time_t resp_rx = evt->rx.rx_time;
+
+    /* 2. DS-TWR: the responder computes the range from the final */
+    if (dw_rng.cfg.method == DW_RNG_DS_TWR) {
+        const DW_Time_t ts[2] = { dw_rng.poll_tx, resp_rx };
+
+        dw_rng.tx_mode = DW_TX_MODE_DELAYED;
+        if (DW_EnableTxMode(DW_TX_MODE_DELAYED) != HAL_OK ||
+            DW_RangingSendTimestamped(DW_RNG_FC_FINAL, dw_rng.peer, dw_rng.seq,
+                                      resp_rx, ts, 2, NULL) != HAL_OK) {
+            dw_rng.stats.errors++;
+            return false;
+        }
+        dw_rng.tx_handle = DW_GetLastTxHandle();
+        dw_rng.state = DW_RNG_WAIT_FINAL_TX;
+        return false;
+    }
+
+    DW_Time_t poll_rx = DW_TimeUnpack(msg + 1);
+    DW_Time_t resp_tx = DW_TimeUnpack(msg + 1 + DW_TIME_BYTES);
+
+    /* 3. Responder clock offset: RX time tracking of this response, else
+     *    the estimate from this and the previous response */
+    uint32_t now = HAL_GetTick();
+    if (now - dw_rng.prev_tick > DW_RNG_OFFSET_MAX_AGE_MS) {
+        dw_rng.offset.prev_valid = false;
+    }
+    dw_rng.prev_tick = now;
+    DW_RangingOffsetUpdate(&dw_rng.offset, resp_tx, resp_rx);
+
+    int32_t offset_ppb = dw_rng.offset.ppb;
+    bool offset_valid = dw_rng.offset.valid;
+    int32_t rx_ppb = evt->rx.clock_offset_ppb;
+
+    if (rx_ppb != DW_RX_OFFSET_INVALID && rx_ppb <= DW_RNG_OFFSET_MAX_PPB &&
+        rx_ppb >= -DW_RNG_OFFSET_MAX_PPB) {
+        offset_ppb = rx_ppb;
+        offset_valid = true;
+    }
+    dw_rng.rx_offset_ppb = rx_ppb;
+
+    /* 4. ToF = (T_round - T_reply * (1 - e)) / 2 */
+    int64_t tof = DW_RangingSsTof((int64_t)DW_TimeSub(resp_rx, dw_rng.poll_tx),
+                                  (int64_t)DW_TimeSub(resp_tx, poll_rx), offset_ppb);
+    int16_t rx_level = DW_DIAG_LEVEL_INVALID;
+
+    if (dw_rng.cfg.bias_correction) {
+        tof = DW_RangeBiasCorrect(&evt->rx, tof, &rx_level);
+    }
+
+    dw_rng.stats.ranges++;
+
+    if (result) {
+        result->peer = dw_rng.peer;
+        result->seq = dw_rng.seq;
+        result->tof_ticks = (int32_t)tof;
+        result->distance_mm = DW_TimeToMm(tof);
+        result->clock_offset_ppb = offset_ppb;
+        result->offset_valid = offset_valid;
+        result->rx_level = rx_level;
+    }
+    return true;
+}
+
+/**
+  * @brief  Responder: answers polls with a delayed response and, for
+  *         DS-TWR, computes the range from the final
+  * @param  evt: Driver event
+  * @param  result: Output range, may be NULL
+  * @retval true if a new range was computed
+  */
+static bool DW_RangingResponderEvent(const DW_Event_t* evt, DW_RangeResult_t* result)
+{
+    DW_MacHeader_t hdr;
+
+    if (evt->type == DW_EVENT_TX_DONE) {
+        if (evt->tx.status == DW_TX_LATE) {
+            dw_rng.stats.late++;
+            DW_RangingListen();
+        } else if (evt->tx.status != DW_TX_OK) {
+            dw_rng.stats.errors++;
+            DW_RangingListen();
+        } else if (dw_rng.state != DW_RNG_WAIT_FINAL) {
+            DW_RangingListen();
+        }
+        /* DS-TWR: the receiver comes up by itself for the final */
+        return false;
+    }
+
+    /* Errors and timeouts leave the receiver off */
+    if (evt->type != DW_EVENT_RX_FRAME) {
+        if (dw_rng.state == DW_RNG_WAIT_FINAL) {
+            if (evt->type == DW_EVENT_RX_TIMEOUT) {
+                dw_rng.stats.timeouts++;
+            } else {
+                dw_rng.stats.errors++;
+            }
+        }
+        DW_RangingListen();
+        return false;
+    }
+
+    if (dw_rng.state == DW_RNG_WAIT_FINAL) {
+        return DW_RangingFinal(&evt->rx, result);
+    }
+
+    const uint8_t* msg = DW_RangingParseMsg(&evt->rx, dw_rng.cfg.pan_id, dw_rng.cfg.short_addr,
+                                            DW_RNG_FC_POLL, DW_RNG_POLL_LEN, &hdr);
+    if (!msg || (hdr.frame_ctrl & DW_FC_SRC_MODE_MASK) != DW_FC_SRC_SHORT) {
+        DW_RangingListen();
+        return false;
+    }
+
+    /* 1. DS-TWR: bound the wait for the final */
+    bool ds = (dw_rng.cfg.method == DW_RNG_DS_TWR);
+    if (ds) {
+        if (DW_RxSetTimeouts(dw_rng.final_fwto_us, 0) != HAL_OK) {
+            DW_RangingListen();
+            return false;
+        }
+        dw_rng.rx_timeout_armed = true;
+    }
+
+    /* 2. Response carrying poll RX and response TX timestamps */
+    if (DW_RangingSendTimestamped(DW_RNG_FC_RESP, (uint16_t)hdr.src_addr, hdr.seq,
+                                  evt->rx.rx_time, &evt->rx.rx_time, 1, &dw_rng.resp_tx) != HAL_OK) {
+        dw_rng.stats.errors++;
+        DW_RangingListen();
+        return false;
+    }
+
+    dw_rng.peer = (uint16_t)hdr.src_addr;
+    dw_rng.seq = hdr.seq;
+    dw_rng.poll_rx = evt->rx.rx_time;
+    dw_rng.state = ds ? DW_RNG_WAIT_FINAL : DW_RNG_WAIT_TX;
+    dw_rng.stats.responses++;
+    return false;
+}
+
+/**
+  * @brief  Sends a reply at the reply delay after a received frame
+  * @param  fcode: Function code
+  * @param  dst: Destination short address
+  * @param  seq: Sequence number
+  * @param  rx_time: RX timestamp the reply delay counts from
+  * @param  ts: Timestamps to embed before the TX timestamp
+  * @param  n_ts: Number of timestamps in ts
+  * @param  tx_stamp: Output TX timestamp of the reply, may be NULL
+  * @note   DX_TIME drops the low 9 bits and the chip adds TX_ANTD, so the
+  *         exact TX timestamp is known before sending and is appended to
+  *         the message. A late start is reported by the driver.
+  * @retval HAL_OK if the reply was started, HAL_ERROR on failure
+  */
+static HAL_StatusTypeDef DW_RangingSendTimestamped(uint8_t fcode, uint16_t dst, uint8_t seq,
+                                                   DW_Time_t rx_time, const DW_Time_t* ts,
+                                                   uint8_t n_ts, DW_Time_t* tx_stamp)
+{
+    DW_FrameBuilder_t fb;
+    uint8_t* p;
+
+    DW_Time_t tx_dx = DW_TimeAdd(rx_time, dw_rng.reply_ticks) & DW_TIME_DX_MASK;
+    DW_Time_t stamp = DW_TimeAdd(tx_dx, dw_rng.tx_antd);
+
+    DW_FrameBegin(&fb);
+    if (DW_FrameWriteMacHeader(&fb, DW_FC_TYPE_DATA, seq, dw_rng.cfg.pan_id,
+                               dst, dw_rng.cfg.short_addr) != HAL_OK ||
+        (p = DW_FrameReserve(&fb, 1 + (n_ts + 1) * DW_TIME_BYTES)) == NULL) {
+        return HAL_ERROR;
+    }
+
+    *p++ = fcode;
+    for (uint8_t i = 0; i < n_ts; i++, p += DW_TIME_BYTES) {
+        DW_TimePack(p, ts[i]);
+    }
+    DW_TimePack(p, stamp);
+
+    if (DW_SetDelayedTime(tx_dx) != HAL_OK || DW_FrameSend(&fb) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    if (tx_stamp) {
+        *tx_stamp = stamp;
+    }
+    return HAL_OK;
+}
+
+/**
+  * @brief  DS-TWR responder: computes the range from the final
+  * @param  rx: RX frame event
+  * @param  result: Output range, may be NULL
+  * @retval true if a new range was computed
+  */
+static bool DW_RangingFinal(const DW_RxEvent_t* rx, DW_RangeResult_t* result)
+{
+    DW_MacHeader_t hdr;
+    int32_t ppb = 0;
+
+    const uint8_t* msg = DW_RangingParseMsg(rx, dw_rng.cfg.pan_id, dw_rng.cfg.short_addr,
+                                            DW_RNG_FC_FINAL, DW_RNG_FINAL_LEN, &hdr);
+    bool match = msg && hdr.seq == dw_rng.seq && (uint16_t)hdr.src_addr == dw_rng.peer;
+
+    /* 1. Listen for the next poll before doing the arithmetic */
+    DW_RangingListen();
+    if (!match) {
+        dw_rng.stats.errors++;
+        return false;
+    }
+
+    /* 2. Round and reply times: R1, D2 initiator clock; D1, R2 ours */
+    DW_Time_t poll_tx = DW_TimeUnpack(msg + 1);
+    DW_Time_t resp_rx = DW_TimeUnpack(msg + 1 + DW_TIME_BYTES);
+    DW_Time_t final_tx = DW_TimeUnpack(msg + 1 + 2 * DW_TIME_BYTES);
+
+    int64_t round1 = (int64_t)DW_TimeSub(resp_rx, poll_tx);
+    int64_t reply2 = (int64_t)DW_TimeSub(final_tx, resp_rx);
+    int64_t reply1 = (int64_t)DW_TimeSub(dw_rng.resp_tx, dw_rng.poll_rx);
+    int64_t round2 = (int64_t)DW_TimeSub(rx->rx_time, dw_rng.resp_tx);
+
+    /* The products below need every term under 2^31 ticks (33 ms) */
+    if ((round1 | reply2 | reply1 | round2) >> 31) {
+        dw_rng.stats.errors++;
+        return false;
+    }
+
+    int64_t tof = DW_RangingDsTof(round1, reply1, round2, reply2);
+    bool offset_valid = DW_RangingOffsetPpb(reply1 + round2, round1 + reply2, &ppb);
+    int16_t rx_level = DW_DIAG_LEVEL_INVALID;
+
+    if (dw_rng.cfg.bias_correction) {
+        tof = DW_RangeBiasCorrect(rx, tof, &rx_level);
+    }
+
+    dw_rng.stats.ranges++;
+
+    if (result) {
+        result->peer = dw_rng.peer;
+        result->seq = dw_rng.seq;
+        result->tof_ticks = (int32_t)tof;
+        result->distance_mm = DW_TimeToMm(tof);
+        result->clock_offset_ppb = offset_valid ? ppb : 0;
+        result->offset_valid = offset_valid;
+        result->rx_level = rx_level;
+    }
+    return true;
+}
+
+/**
+  * @brief  Computes the receiver turn-on delay and frame wait timeout for
+  *         a reply expected after one of our frames
+  * @param  tx_len: Length of our frame, excluding FCS
+  * @param  rx_len: Length of the expected reply, excluding FCS
+  * @param  w4r_us: Output delay from end of TX to RX enable
+  * @param  fwto_us: Output frame wait timeout from RX enable
+  * @note   The reply delay counts from our RMARKER to the reply's RMARKER.
+  *         Full frame airtimes bound both the part of our frame after the
+  *         RMARKER and the reply preamble, so the receiver is on early.
+  */
+static void DW_RangingRxWindow(uint16_t tx_len, uint16_t rx_len, uint32_t* w4r_us, uint32_t* fwto_us)
+{
+    const DW_PhyConfig_t* phy = DW_GetPhyConfig();
+    uint32_t reply_us = dw_rng.cfg.reply_delay_us;
+    uint32_t rx_us = DW_FrameAirtimeUs(phy, rx_len + DW_FCS_LEN);
+    uint32_t early_us = DW_FrameAirtimeUs(phy, tx_len + DW_FCS_LEN) + rx_us + DW_RNG_RX_MARGIN_US;
+
+    *w4r_us = (reply_us > early_us) ? reply_us - early_us : 0;
+    *fwto_us = reply_us + rx_us + DW_RNG_RX_MARGIN_US - *w4r_us;
+}
+
+/**
+  * @brief  Clock offset from the same interval measured by both clocks
+  * @param  d_local: Interval, our clock
+  * @param  d_remote: Interval, the other clock
+  * @param  ppb: Output offset of the other clock relative to ours
+  * @retval true if the estimate is plausible
+  */
+static bool DW_RangingOffsetPpb(int64_t d_local, int64_t d_remote, int32_t* ppb)
+{
+    int64_t diff = d_remote - d_local;
+
+    /* Reject pairs more than ~1000 ppm apart before scaling to ppb */
+    if (d_local <= 0 || diff >= (d_local >> 10) || -diff >= (d_local >> 10)) {
+        return false;
+    }
+
+    *ppb = (int32_t)(diff * 1000000000 / d_local);
+    return *ppb < DW_RNG_OFFSET_MAX_PPB && *ppb > -DW_RNG_OFFSET_MAX_PPB;
+}
+
+/**
+  * @brief  Updates a clock offset estimate with a new timestamp pair
+  * @param  est: Estimate to update
+  * @param  remote: TX time of a message, remote clock
+  * @param  local: RX time of the same message, our clock
+  * @note   Between two messages the remote clock advances by (1 + e) times
+  *         our interval, which gives e without extra messages.
+  */
+static void DW_RangingOffsetUpdate(DW_RangingOffsetEst_t* est, DW_Time_t remote, DW_Time_t local)
+{
+    int32_t ppb;
+
+    if (est->prev_valid &&
+        DW_RangingOffsetPpb((int64_t)DW_TimeSub(local, est->prev_local),
+                            (int64_t)DW_TimeSub(remote, est->prev_remote), &ppb)) {
+        if (est->valid) {
+            est->ppb += (ppb - est->ppb) >> DW_RNG_OFFSET_SHIFT;
+        } else {
+            est->ppb = ppb;
+            est->valid = true;
+        }
+    }
+
+    est->prev_valid = true;
+    est->prev_remote = remote;
+    est->prev_local = local;
+}
+
+/**
+  * @brief  Responder: turns the receiver back on for the next poll
+  */
+static void DW_RangingListen(void)
+{
+    dw_rng.state = DW_RNG_IDLE;
+    DW_RangingRxRestart(&dw_rng.rx_timeout_armed);
+}
+
+/**
+  * @brief  Simulation random numbers (xorshift32)
+  * @param  range: Number of possible values
+  * @retval Uniform value in 0..range-1
+  */
+static uint32_t DW_RangingSimRand(uint32_t range)
+{
+    dw_rng_sim_seed ^= dw_rng_sim_seed << 13;
+    dw_rng_sim_seed ^= dw_rng_sim_seed >> 17;
+    dw_rng_sim_seed ^= dw_rng_sim_seed << 5;
+
+    return dw_rng_sim_seed % range;
+}
+
+/**
+  * @brief  Extra time a clock with the given offset counts over t
+  * @param  t: Interval
+  * @param  ppb: Clock offset
+  * @retval t * ppb / 10^9, split so the product cannot overflow
+  */
+static int64_t DW_RangingSimDrift(int64_t t, int32_t ppb)
+{
+    return (t / 1000000000) * ppb + (t % 1000000000) * ppb / 1000000000;
+}
+
+/**
+  * @brief  Adds one error sample
+  * @param  acc: Error statistics, max_abs_mm is updated here
+  * @param  sum: Running sum
+  * @param  sum_sq: Running sum of squares
+  * @param  err: Error in mm
+  */
+static void DW_RangingSimAdd(DW_RangingSimError_t* acc, int64_t* sum, int64_t* sum_sq, int32_t err)
+{
+    *sum += err;
+    *sum_sq += (int64_t)err * err;
+    if (err > acc->max_abs_mm) acc->max_abs_mm = err;
+    if (-err > acc->max_abs_mm) acc->max_abs_mm = -err;
+}
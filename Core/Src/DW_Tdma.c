@@ -0,0 +1,416 @@
+/**
+  * @file    DW_Tdma.c
+  * @brief   TDMA superframe scheduler for ranging with many tags (anchor)
+  * @author  36dhe
+  * @date    Jul 12, 2025
+  */
+
+#include "DW_Tdma.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private Variables */
+
+static struct {
+    DW_TdmaConfig_t cfg;
+    DW_TdmaTag_t tags[DW_TDMA_MAX_TAGS];
+    uint8_t schedule[DW_TDMA_MAX_TAGS];  // Tag table index per slot
+    uint8_t n_slots;
+    uint8_t slot;               // Slot polled now or next
+    uint8_t probe;              // Next table entry for the probe slot
+    bool pending;               // Exchange of the current slot in progress
+    bool synced;                // t0 is on the current DW1000 timebase
+    DW_Time_t t0;               // Start of the current superframe
+    DW_Time_t slot_ticks;
+    uint32_t last_tick;         // Last poll scheduled
+    uint32_t stats_tick;        // Statistics reset
+    DW_TdmaStats_t stats;
+} dw_tdma;
+
+/* Private Function Prototypes */
+static HAL_StatusTypeDef DW_TdmaNext(void);
+static void DW_TdmaBuild(void);
+static HAL_StatusTypeDef DW_TdmaResync(void);
+static void DW_TdmaEndSlot(const DW_RangeResult_t* range);
+static int8_t DW_TdmaFind(uint16_t addr);
+
+/* Exported Functions */
+
+/**
+  * @brief  Configures the anchor as SS-TWR initiator and sizes the slots
+  * @param  cfg: Addresses, reply delay and superframe bound
+  * @note   A slot holds the whole poll, the reply delay, the whole response,
+  *         DW_TDMA_GUARD_US of idle air and DW_TDMA_HOST_US for handling
+  *         the response and loading the next poll. Tags answer polls at
+  *         the fixed reply delay, so there is nothing to negotiate.
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_TdmaInit(const DW_TdmaConfig_t* cfg)
+{
+    if (!cfg) return HAL_ERROR;
+
+    memset(&dw_tdma, 0, sizeof(dw_tdma));
+    dw_tdma.cfg = *cfg;
+    for (uint8_t i = 0; i < DW_TDMA_MAX_TAGS; i++) {
+        dw_tdma.tags[i].addr = DW_TDMA_ADDR_NONE;
+    }
+
+    /* 1. Ranging initiator; each poll names its tag */
+    const DW_RangingConfig_t rng_cfg = {
+        .role = DW_RNG_ROLE_INITIATOR,
+        .method = DW_RNG_SS_TWR,
+        .pan_id = cfg->pan_id,
+        .short_addr = cfg->short_addr,
+        .peer_addr = DW_TDMA_ADDR_NONE,
+        .reply_delay_us = cfg->reply_delay_us,
+        .bias_correction = cfg->bias_correction
+    };
+    if (DW_RangingInit(&rng_cfg) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    /* 2. Slot length from the airtime of the current PHY configuration */
+    const DW_PhyConfig_t* phy = DW_GetPhyConfig();
+    uint32_t reply_us = cfg->reply_delay_us ? cfg->reply_delay_us : DW_RNG_REPLY_DELAY_US;
+
+    dw_tdma.stats.slot_us = DW_FrameAirtimeUs(phy, DW_RNG_POLL_LEN + DW_FCS_LEN) + reply_us +
+                            DW_FrameAirtimeUs(phy, DW_RNG_RESP_LEN + DW_FCS_LEN) +
+                            DW_TDMA_GUARD_US + DW_TDMA_HOST_US;
+    dw_tdma.slot_ticks = DW_TimeFromUs(dw_tdma.stats.slot_us);
+
+    DW_TdmaResetStats();
+    return HAL_OK;
+}
+
+/**
+  * @brief  Registers a tag; it owns a slot from the next superframe on
+  * @param  addr: Tag short address
+  * @retval HAL_OK if registered or already known, HAL_ERROR if the table
+  *         is full or addr is invalid
+  */
+HAL_StatusTypeDef DW_TdmaAddTag(uint16_t addr)
+{
+    if (addr == DW_TDMA_ADDR_NONE) return HAL_ERROR;
+    if (DW_TdmaFind(addr) >= 0) return HAL_OK;
+
+    int8_t i = DW_TdmaFind(DW_TDMA_ADDR_NONE);
+    if (i < 0) {
+        return HAL_ERROR;
+    }
+
+    memset(&dw_tdma.tags[i], 0, sizeof(dw_tdma.tags[i]));
+    dw_tdma.tags[i].addr = addr;
+    dw_tdma.tags[i].active = true;
+    return HAL_OK;
+}
+
+/**
+  * @brief  Removes a tag; its slot is dropped from the next superframe
+  * @param  addr: Tag short address
+  * @retval HAL_OK if removed, HAL_ERROR if not registered
+  */
+HAL_StatusTypeDef DW_TdmaRemoveTag(uint16_t addr)
+{
+    int8_t i = (addr == DW_TDMA_ADDR_NONE) ? -1 : DW_TdmaFind(addr);
+
+    if (i < 0) {
+        return HAL_ERROR;
+    }
+
+    dw_tdma.tags[i].addr = DW_TDMA_ADDR_NONE;
+    dw_tdma.tags[i].active = false;
+    return HAL_OK;
+}
+
+/**
+  * @brief  Keeps the superframe running; call from the main loop
+  * @note   Slots normally follow each other from DW_TdmaHandleEvent(). This
+  *         starts the first superframe, picks up new tags after an idle
+  *         period and ends exchanges that finished without an event.
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_TdmaRun(void)
+{
+    if (dw_tdma.pending) {
+        if (DW_RangingBusy()) {
+            return HAL_OK;
+        }
+        DW_TdmaEndSlot(NULL);
+    }
+
+    /* Stale superframe times would be misread after the 40-bit wrap */
+    if (HAL_GetTick() - dw_tdma.last_tick > DW_TDMA_RESYNC_MS) {
+        dw_tdma.synced = false;
+    }
+
+    return DW_TdmaNext();
+}
+
+/**
+  * @brief  Feeds a driver event to the ranging exchange of the current slot
+  * @param  evt: Event from DW_GetEvent() or the event callback
+  * @param  result: Output range, may be NULL
+  * @note   The next slot is scheduled from here as soon as the current
+  *         exchange ends, so events must be handled within DW_TDMA_HOST_US.
+  *         RX frame buffers stay owned by the caller.
+  * @retval true if a new range was written to result
+  */
+bool DW_TdmaHandleEvent(const DW_Event_t* evt, DW_RangeResult_t* result)
+{
+    DW_RangeResult_t range;
+
+    if (!evt) return false;
+
+    bool ranged = DW_RangingHandleEvent(evt, &range);
+    if (ranged && result) {
+        *result = range;
+    }
+
+    if (dw_tdma.pending && !DW_RangingBusy()) {
+        DW_TdmaEndSlot(ranged ? &range : NULL);
+        DW_TdmaNext();
+    }
+    return ranged;
+}
+
+/**
+  * @brief  Returns a tag table entry with its achieved update rate
+  * @param  index: Table index, 0 to DW_TDMA_MAX_TAGS - 1
+  * @param  tag: Output entry
+  * @retval HAL_OK if the entry holds a tag, HAL_ERROR otherwise
+  */
+HAL_StatusTypeDef DW_TdmaGetTag(uint8_t index, DW_TdmaTag_t* tag)
+{
+    if (!tag || index >= DW_TDMA_MAX_TAGS || dw_tdma.tags[index].addr == DW_TDMA_ADDR_NONE) {
+        return HAL_ERROR;
+    }
+
+    uint32_t elapsed_ms = HAL_GetTick() - dw_tdma.stats_tick;
+
+    *tag = dw_tdma.tags[index];
+    tag->rate_mhz = elapsed_ms ? (uint32_t)((uint64_t)tag->ranges * 1000000 / elapsed_ms) : 0;
+    return HAL_OK;
+}
+
+/**
+  * @brief  Returns scheduler statistics
+  * @param  stats: Output statistics
+  */
+void DW_TdmaGetStats(DW_TdmaStats_t* stats)
+{
+    if (!stats) return;
+
+    *stats = dw_tdma.stats;
+    stats->elapsed_ms = HAL_GetTick() - dw_tdma.stats_tick;
+    stats->ranges_per_s = stats->elapsed_ms ?
+        (uint32_t)((uint64_t)stats->ranges * 1000 / stats->elapsed_ms) : 0;
+}
+
+/**
+  * @brief  Restarts the statistics and per-tag rates
+  */
+void DW_TdmaResetStats(void)
+{
+    uint32_t slot_us = dw_tdma.stats.slot_us;
+    uint32_t superframe_us = dw_tdma.stats.superframe_us;
+
+    memset(&dw_tdma.stats, 0, sizeof(dw_tdma.stats));
+    dw_tdma.stats.slot_us = slot_us;
+    dw_tdma.stats.superframe_us = superframe_us;
+
+    for (uint8_t i = 0; i < DW_TDMA_MAX_TAGS; i++) {
+        dw_tdma.tags[i].polls = 0;
+        dw_tdma.tags[i].ranges = 0;
+    }
+    dw_tdma.stats_tick = HAL_GetTick();
+}
+
+/**
+  * @brief  Prints scheduler statistics and the update rate of every tag
+  */
+void DW_TdmaPrintStats(void)
+{
+    DW_TdmaStats_t stats;
+    DW_TdmaTag_t tag;
+
+    DW_TdmaGetStats(&stats);
+
+    printf("TDMA: %u slots of %lu us, superframe %lu us, %lu ranges/s\n",
+           dw_tdma.n_slots, (unsigned long)stats.slot_us,
+           (unsigned long)stats.superframe_us, (unsigned long)stats.ranges_per_s);
+    printf("  Polls %lu, ranges %lu, misses %lu, resyncs %lu, reclaimed %lu, restored %lu\n",
+           (unsigned long)stats.polls, (unsigned long)stats.ranges, (unsigned long)stats.misses,
+           (unsigned long)stats.resyncs, (unsigned long)stats.reclaimed,
+           (unsigned long)stats.restored);
+
+    for (uint8_t i = 0; i < DW_TDMA_MAX_TAGS; i++) {
+        if (DW_TdmaGetTag(i, &tag) != HAL_OK) continue;
+
+        printf("  Tag %04X: %lu.%03lu Hz, %lu/%lu, %ld mm%s\n", tag.addr,
+               (unsigned long)(tag.rate_mhz / 1000), (unsigned long)(tag.rate_mhz % 1000),
+               (unsigned long)tag.ranges, (unsigned long)tag.polls, (long)tag.last_mm,
+               tag.active ? "" : ", probed");
+    }
+}
+
+/* Private Functions */
+
+/**
+  * @brief  Schedules the poll of the next slot, starting a new superframe
+  *         after the last one
+  * @note   If the poll time of a slot has already passed, the rest of the
+  *         superframe is moved to start now instead of skipping slots.
+  * @retval HAL_OK if a poll was scheduled or there is no tag, HAL_ERROR on
+  *         failure
+  */
+static HAL_StatusTypeDef DW_TdmaNext(void)
+{
+    bool resynced = false;
+
+    for (;;) {
+        /* 1. New superframe, right after the previous one */
+        if (dw_tdma.slot >= dw_tdma.n_slots) {
+            if (dw_tdma.synced) {
+                dw_tdma.t0 = DW_TimeAdd(dw_tdma.t0, DW_TimeFromUs(dw_tdma.stats.superframe_us));
+            }
+            DW_TdmaBuild();
+            if (dw_tdma.n_slots == 0) {
+                dw_tdma.synced = false;
+                return HAL_OK;
+            }
+            dw_tdma.stats.superframes++;
+            if (!dw_tdma.synced && DW_TdmaResync() != HAL_OK) {
+                return HAL_ERROR;
+            }
+        }
+
+        /* 2. Tags removed since the superframe was built leave a gap */
+        DW_TdmaTag_t* tag = &dw_tdma.tags[dw_tdma.schedule[dw_tdma.slot]];
+        if (tag->addr == DW_TDMA_ADDR_NONE) {
+            dw_tdma.slot++;
+            continue;
+        }
+
+        /* 3. Poll on the DW1000 clock */
+        DW_Time_t at = DW_TimeAdd(dw_tdma.t0, dw_tdma.slot * dw_tdma.slot_ticks);
+        HAL_StatusTypeDef status = DW_RangingStartAt(tag->addr, at);
+
+        if (status == HAL_OK) {
+            dw_tdma.pending = true;
+            dw_tdma.last_tick = HAL_GetTick();
+            tag->polls++;
+            dw_tdma.stats.polls++;
+            return HAL_OK;
+        }
+        if (status != HAL_TIMEOUT || resynced || DW_TdmaResync() != HAL_OK) {
+            return HAL_ERROR;
+        }
+        resynced = true;
+        dw_tdma.stats.resyncs++;
+    }
+}
+
+/**
+  * @brief  Lays out the next superframe: one slot per active tag and one
+  *         probe slot shared by the others
+  */
+static void DW_TdmaBuild(void)
+{
+    uint8_t n = 0;
+
+    for (uint8_t i = 0; i < DW_TDMA_MAX_TAGS; i++) {
+        if (dw_tdma.tags[i].addr != DW_TDMA_ADDR_NONE && dw_tdma.tags[i].active) {
+            dw_tdma.schedule[n++] = i;
+        }
+    }
+
+    for (uint8_t k = 0; k < DW_TDMA_MAX_TAGS; k++) {
+        uint8_t i = (dw_tdma.probe + k) % DW_TDMA_MAX_TAGS;
+
+        if (dw_tdma.tags[i].addr != DW_TDMA_ADDR_NONE && !dw_tdma.tags[i].active) {
+            dw_tdma.schedule[n++] = i;
+            dw_tdma.probe = (i + 1) % DW_TDMA_MAX_TAGS;
+            break;
+        }
+    }
+
+    dw_tdma.n_slots = n;
+    dw_tdma.slot = 0;
+    dw_tdma.stats.superframe_us = n * dw_tdma.stats.slot_us;
+    if (n && dw_tdma.stats.superframe_us < dw_tdma.cfg.superframe_min_us) {
+        dw_tdma.stats.superframe_us = dw_tdma.cfg.superframe_min_us;
+    }
+}
+
+/**
+  * @brief  Moves the superframe so that the current slot starts after the
+  *         host time from now
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+static HAL_StatusTypeDef DW_TdmaResync(void)
+{
+    DW_Time_t now;
+
+    if (DW_ReadSysTime(&now) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    dw_tdma.t0 = DW_TimeSub(DW_TimeAdd(now, DW_TimeFromUs(DW_TDMA_HOST_US)),
+                            dw_tdma.slot * dw_tdma.slot_ticks);
+    dw_tdma.synced = true;
+    return HAL_OK;
+}
+
+/**
+  * @brief  Books the outcome of the current slot and moves on
+  * @param  range: Range of the exchange, NULL if it failed
+  * @note   A tag keeps its slot until DW_TDMA_MISS_LIMIT misses in a row;
+  *         a probed tag gets its slot back with the first range.
+  */
+static void DW_TdmaEndSlot(const DW_RangeResult_t* range)
+{
+    DW_TdmaTag_t* tag = &dw_tdma.tags[dw_tdma.schedule[dw_tdma.slot]];
+
+    dw_tdma.pending = false;
+    dw_tdma.slot++;
+
+    if (tag->addr == DW_TDMA_ADDR_NONE) {
+        return;
+    }
+
+    if (range && range->peer == tag->addr) {
+        tag->ranges++;
+        tag->last_mm = range->distance_mm;
+        tag->misses = 0;
+        dw_tdma.stats.ranges++;
+        if (!tag->active) {
+            tag->active = true;
+            dw_tdma.stats.restored++;
+        }
+        return;
+    }
+
+    dw_tdma.stats.misses++;
+    if (tag->misses < UINT8_MAX) {
+        tag->misses++;
+    }
+    if (tag->active && tag->misses >= DW_TDMA_MISS_LIMIT) {
+        tag->active = false;
+        dw_tdma.stats.reclaimed++;
+    }
+}
+
+/**
+  * @brief  Looks up a tag table entry
+  * @param  addr: Short address, DW_TDMA_ADDR_NONE for a free entry
+  * @retval Table index, -1 if not found
+  */
+static int8_t DW_TdmaFind(uint16_t addr)
+{
+    for (uint8_t i = 0; i < DW_TDMA_MAX_TAGS; i++) {
+        if (dw_tdma.tags[i].addr == addr) {
+            return (int8_t)i;
+        }
+    }
+    return -1;
+}
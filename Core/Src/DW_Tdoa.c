@@ -0,0 +1,343 @@
+/**
+  * @file    DW_Tdoa.c
+  * @brief   TDoA anchor: continuous blink reception with batched reports
+  * @author  36dhe
+  * @date    Jul 15, 2025
+  */
+
+#include "DW_Tdoa.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private Variables */
+
+static struct {
+    DW_TdoaConfig_t cfg;
+    uint8_t buf[sizeof(DW_TdoaBatchHdr_t) + DW_TDOA_BATCH_MAX * sizeof(DW_TdoaReport_t) +
+                DW_LINK_CHECKSUM_LEN];
+    uint8_t count;              // Reports in buf
+    uint16_t batch_seq;
+    uint32_t batch_tick;        // First report of the current batch
+    uint32_t buffer_errors;     // Blinks the driver could not read out
+    uint32_t lost_sent;         // Lost total at the last batch
+    uint32_t lost_base;         // Lost total at the statistics reset
+    uint32_t discarded_base;
+    uint64_t busy_cycles;       // Host time spent on blinks
+    uint32_t stats_tick;
+    DW_TdoaStats_t stats;
+} dw_tdoa;
+
+/* Private Function Prototypes */
+static bool DW_TdoaClassify(const uint8_t* header, uint8_t length, const DW_RxFrameInfo_t* info);
+static void DW_TdoaReport(const DW_RxEvent_t* rx);
+static uint32_t DW_TdoaLostTotal(void);
+
+/* Exported Functions */
+
+/**
+  * @brief  Starts continuous blink reception
+  * @param  cfg: Anchor ID, flush interval and RX buffering
+  * @note   Frame filtering is turned off: blinks carry no PAN or address.
+  * @retval HAL_OK if successful, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_TdoaInit(const DW_TdoaConfig_t* cfg)
+{
+    if (!cfg) return HAL_ERROR;
+
+    memset(&dw_tdoa, 0, sizeof(dw_tdoa));
+    dw_tdoa.cfg = *cfg;
+    if (dw_tdoa.cfg.flush_ms == 0) {
+        dw_tdoa.cfg.flush_ms = DW_TDOA_FLUSH_MS;
+    }
+
+    /* 1. Only blinks are read out, with timestamp and quality */
+    DW_SetSoftwareFilter(NULL);
+    DW_RxSetQualityCapture(true);
+    if (DW_DisableFrameFilter() != HAL_OK ||
+        DW_RxSetClassifier(DW_TdoaClassify, DW_TDOA_BLINK_LEN) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    /* 2. Receiver never waits for the host */
+    if (DW_RxSetDoubleBuffer(cfg->double_buffer) != HAL_OK ||
+        DW_RxSetContinuous(true) != HAL_OK ||
+        DW_SpiSetFast(true) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    DW_CycleCounterInit();
+    DW_RxResetCounters();
+    DW_TdoaResetStats();
+    dw_tdoa.lost_sent = dw_tdoa.lost_base;
+    return DW_RxEnable();
+}
+
+/**
+  * @brief  Collects blinks and sends due batches; call from the main loop
+  * @retval HAL_OK if successful, HAL_ERROR if a batch was not accepted
+  */
+HAL_StatusTypeDef DW_TdoaRun(void)
+{
+    HAL_StatusTypeDef status = HAL_OK;
+    DW_Event_t evt;
+    bool work = false;
+    uint32_t t0 = DW_Cycles();
+
+    DW_ClockSyncRun();
+    DW_ProcessEvents();
+    while (DW_GetEvent(&evt)) {
+        work = true;
+        if (DW_ClockSyncHandleEvent(&evt)) {
+            /* Sync frame or the master's sync TX */
+        } else if (evt.type == DW_EVENT_RX_FRAME) {
+            DW_TdoaReport(&evt.rx);
+        } else if (evt.type == DW_EVENT_RX_ERROR && evt.rx.status == DW_RX_ERR_BUFFER) {
+            dw_tdoa.buffer_errors++;
+        }
+        if (evt.type == DW_EVENT_RX_FRAME) {
+            DW_PoolFree(evt.rx.frame);
+        }
+    }
+
+    /* 1. Full batches are sent at once, others when their oldest report is due */
+    if (dw_tdoa.count == DW_TDOA_BATCH_MAX ||
+        (dw_tdoa.count && HAL_GetTick() - dw_tdoa.batch_tick >= dw_tdoa.cfg.flush_ms)) {
+        status = DW_TdoaFlush();
+        work = true;
+    }
+
+    if (work) {
+        dw_tdoa.busy_cycles += DW_Cycles() - t0;
+    }
+    return status;
+}
+
+/**
+  * @brief  Sends the collected reports as one host packet
+  * @note   The lost count travels with the next batch even if it is empty
+  *         of reports, so the host can tell silence from loss.
+  * @retval HAL_OK if sent or nothing to send, HAL_ERROR on a link error
+  */
+HAL_StatusTypeDef DW_TdoaFlush(void)
+{
+    DW_TdoaBatchHdr_t* hdr = (DW_TdoaBatchHdr_t*)dw_tdoa.buf;
+    uint32_t lost = DW_TdoaLostTotal();
+
+    if (dw_tdoa.count == 0 && lost == dw_tdoa.lost_sent) {
+        return HAL_OK;
+    }
+
+    hdr->magic = DW_TDOA_MAGIC;
+    hdr->count = dw_tdoa.count;
+    hdr->anchor = dw_tdoa.cfg.anchor_id;
+    hdr->batch_seq = dw_tdoa.batch_seq++;
+    hdr->lost = (lost - dw_tdoa.lost_sent > UINT16_MAX) ? UINT16_MAX : (uint16_t)(lost - dw_tdoa.lost_sent);
+
+    uint16_t length = sizeof(DW_TdoaBatchHdr_t) + dw_tdoa.count * sizeof(DW_TdoaReport_t);
+    uint16_t sum = DW_LinkChecksum(dw_tdoa.buf, length);
+    dw_tdoa.buf[length] = (uint8_t)sum;
+    dw_tdoa.buf[length + 1] = (uint8_t)(sum >> 8);
+
+    HAL_StatusTypeDef status = DW_TdoaLinkWrite(dw_tdoa.buf, length + DW_LINK_CHECKSUM_LEN);
+    if (status == HAL_OK) {
+        dw_tdoa.stats.batches++;
+    } else {
+        dw_tdoa.stats.link_errors++;
+    }
+
+    dw_tdoa.lost_sent = lost;
+    dw_tdoa.count = 0;
+    return status;
+}
+
+/**
+  * @brief  Returns anchor statistics and the measured blink capacity
+  * @param  stats: Output statistics
+  * @note   Capacity is the host time per blink turned into a rate: how
+  *         many blinks this anchor could report if they arrived back to
+  *         back. Compare with airtime_per_s, the limit of the channel.
+  */
+void DW_TdoaGetStats(DW_TdoaStats_t* stats)
+{
+    DW_RxStats_t rx;
+
+    if (!stats) return;
+
+    DW_RxGetStats(&rx);
+    *stats = dw_tdoa.stats;
+    stats->lost = DW_TdoaLostTotal() - dw_tdoa.lost_base;
+    stats->discarded = rx.discarded - dw_tdoa.discarded_base;
+    stats->elapsed_ms = HAL_GetTick() - dw_tdoa.stats_tick;
+    stats->blinks_per_s = stats->elapsed_ms ?
+        (uint32_t)((uint64_t)stats->blinks * 1000 / stats->elapsed_ms) : 0;
+
+    uint32_t handled = stats->blinks + stats->no_stamp;
+    if (handled) {
+        stats->cycles_per_blink = (uint32_t)(dw_tdoa.busy_cycles / handled);
+    }
+    if (stats->cycles_per_blink) {
+        stats->capacity_per_s = SystemCoreClock / stats->cycles_per_blink;
+    }
+    stats->airtime_per_s = 1000000 / DW_FrameAirtimeUs(DW_GetPhyConfig(), DW_TDOA_BLINK_LEN + DW_FCS_LEN);
+}
+
+/**
+  * @brief  Restarts the statistics
+  */
+void DW_TdoaResetStats(void)
+{
+    DW_RxStats_t rx;
+
+    DW_RxGetStats(&rx);
+    memset(&dw_tdoa.stats, 0, sizeof(dw_tdoa.stats));
+    dw_tdoa.busy_cycles = 0;
+    dw_tdoa.lost_base = DW_TdoaLostTotal();
+    dw_tdoa.discarded_base = rx.discarded;
+    dw_tdoa.stats_tick = HAL_GetTick();
+}
+
+/**
+  * @brief  Prints blink rate, capacity and losses
+  */
+void DW_TdoaPrintStats(void)
+{
+    DW_TdoaStats_t stats;
+    DW_RxCounters_t cnt;
+
+    DW_TdoaGetStats(&stats);
+    DW_RxGetCounters(&cnt);
+
+    printf("TDoA anchor %04X: %lu blinks/s, capacity %lu blinks/s (%lu cycles/blink), airtime limit %lu blinks/s\n",
+           dw_tdoa.cfg.anchor_id, (unsigned long)stats.blinks_per_s,
+           (unsigned long)stats.capacity_per_s, (unsigned long)stats.cycles_per_blink,
+           (unsigned long)stats.airtime_per_s);
+    printf("  Blinks %lu (local time %lu), no stamp %lu, lost %lu, discarded %lu, batches %lu, link errors %lu, deaf %lu us\n",
+           (unsigned long)stats.blinks, (unsigned long)stats.local_time,
+           (unsigned long)stats.no_stamp, (unsigned long)stats.lost,
+           (unsigned long)stats.discarded, (unsigned long)stats.batches,
+           (unsigned long)stats.link_errors, (unsigned long)cnt.deaf_us);
+}
+
+/**
+  * @brief  Transmits one blink (tag)
+  * @param  tag_id: 64-bit tag ID, e.g. the EUI
+  * @param  seq: Sequence number
+  * @retval HAL_OK if started, HAL_ERROR on failure
+  */
+HAL_StatusTypeDef DW_TdoaBlink(uint64_t tag_id, uint8_t seq)
+{
+    DW_FrameBuilder_t fb;
+    uint8_t* p;
+
+    DW_FrameBegin(&fb);
+    if ((p = DW_FrameReserve(&fb, DW_TDOA_BLINK_LEN)) == NULL) {
+        return HAL_ERROR;
+    }
+
+    p[0] = DW_TDOA_BLINK_FC;
+    p[1] = seq;
+    for (uint8_t i = 0; i < 8; i++) {
+        p[2 + i] = (uint8_t)(tag_id >> (8 * i));
+    }
+    return DW_FrameSend(&fb);
+}
+
+/**
+  * @brief  Hands one batch to the host link
+  * @param  data: Batch header, reports and checksum
+  * @param  length: Bytes
+  * @note   Weak default writes to stdout (see syscalls.c), shared with the
+  *         statistics text; the host finds batches by magic, count and
+  *         checksum. Override for a DMA UART or USB link.
+  * @retval HAL_OK if accepted, HAL_ERROR otherwise
+  */
+__attribute__((weak)) HAL_StatusTypeDef DW_TdoaLinkWrite(const uint8_t* data, uint16_t length)
+{
+    extern int _write(int file, char* ptr, int len);
+
+    return (_write(1, (char*)data, length) == length) ? HAL_OK : HAL_ERROR;
+}
+
+/* Private Functions */
+
+/**
+  * @brief  Accepts blink and clock sync frames after the first
+  *         DW_TDOA_BLINK_LEN bytes
+  * @param  header: Frame start
+  * @param  length: Bytes in header
+  * @param  info: Frame info
+  * @retval true to read out the frame
+  */
+static bool DW_TdoaClassify(const uint8_t* header, uint8_t length, const DW_RxFrameInfo_t* info)
+{
+    (void)info;
+    return (length >= DW_TDOA_BLINK_LEN && header[0] == DW_TDOA_BLINK_FC) ||
+           DW_ClockSyncClassify(header, length);
+}
+
+/**
+  * @brief  Adds the report of one blink to the current batch
+  * @param  rx: RX frame event with quality captured
+  */
+static void DW_TdoaReport(const DW_RxEvent_t* rx)
+{
+    DW_RxDiag_t diag;
+
+    /* Only blinks are reported, whatever else the classifier lets through */
+    if (rx->info.length < DW_TDOA_BLINK_LEN || rx->frame->data[0] != DW_TDOA_BLINK_FC) {
+        return;
+    }
+
+    /* Without a valid leading edge the timestamp is useless for TDoA */
+    if (rx->status != DW_RX_OK) {
+        dw_tdoa.stats.no_stamp++;
+        return;
+    }
+
+    if (dw_tdoa.count == DW_TDOA_BATCH_MAX) {
+        DW_TdoaFlush();
+    }
+    if (dw_tdoa.count == 0) {
+        dw_tdoa.batch_tick = HAL_GetTick();
+    }
+
+    DW_TdoaReport_t* r = (DW_TdoaReport_t*)(dw_tdoa.buf + sizeof(DW_TdoaBatchHdr_t)) + dw_tdoa.count;
+    const uint8_t* data = rx->frame->data;
+
+    r->tag_id = 0;
+    for (uint8_t i = 0; i < 8; i++) {
+        r->tag_id |= (uint64_t)data[2 + i] << (8 * i);
+    }
+    r->seq = data[1];
+
+    /* Master time once clock sync is locked, so the host need not convert */
+    DW_Time_t rx_time = rx->rx_time;
+    if (DW_ClockSyncToMaster(rx->rx_time, &rx_time)) {
+        r->flags = DW_TDOA_FLAG_MASTER;
+    } else {
+        r->flags = 0;
+        dw_tdoa.stats.local_time++;
+    }
+    DW_TimePack(r->rx_time, rx_time);
+
+    DW_DiagFromQuality(&rx->quality, rx->info.preamble_count,
+                       rx->info.preamble_count == rx->quality.rxpacc_nosat, &diag);
+    r->fp_index = diag.fp_index;
+    r->rx_level = diag.rx_level;
+    r->fp_level = diag.fp_level;
+
+    dw_tdoa.count++;
+    dw_tdoa.stats.blinks++;
+}
+
+/**
+  * @brief  Blinks lost anywhere between the antenna and the batch
+  * @retval Running total of RX overruns, event queue drops and read-out errors
+  */
+static uint32_t DW_TdoaLostTotal(void)
+{
+    DW_RxStats_t rx;
+
+    DW_RxGetStats(&rx);
+    return rx.overruns + DW_GetEventDrops() + dw_tdoa.buffer_errors;
+}
@@ -21,7 +21,17 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include <stdio.h>
 #include "DWM1000.h"
+#include "DW_Stream.h"
+#include "DW_Cir.h"
+#include "DW_Diag.h"
+#include "DW_Ranging.h"
+#include "DW_Tdma.h"
+#include "DW_Group.h"
+#include "DW_Tdoa.h"
+#include "DW_AntCal.h"
+#include "DW_RangeFilter.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -31,7 +41,67 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
-
+/* Application modes, select one with -DAPP_MODE=... */
+#define APP_MODE_BEACON        0   // Periodic demo frame
+#define APP_MODE_STREAM_BENCH  1   // 6.8 Mbit/s streaming throughput benchmark
+#define APP_MODE_RECEIVER      2   // Receive and count frames
+#define APP_MODE_DIAG_BENCH    3   // Fixed-point vs soft-float RX diagnostics benchmark
+#define APP_MODE_TWR_INITIATOR 4   // TWR ranging rate benchmark against one responder
+#define APP_MODE_TWR_RESPONDER 5   // Answer SS-TWR polls, compute DS-TWR ranges
+#define APP_MODE_TWR_SIM       6   // SS-TWR vs DS-TWR error on a simulated clock drift model
+#define APP_MODE_TDMA_ANCHOR   7   // Range with many tags in TDMA slots (tags: APP_MODE_TWR_RESPONDER)
+#define APP_MODE_GROUP_TAG     8   // Group ranging rate benchmark: one poll, all anchors answer
+#define APP_MODE_GROUP_ANCHOR  9   // Answer group polls in slot order, compute DS-TWR ranges
+#define APP_MODE_TDOA_ANCHOR   10  // Timestamp blinks in master time, batched reports, blinks/s capacity
+#define APP_MODE_TDOA_TAG      11  // Blink every TDOA_BLINK_PERIOD_MS
+#define APP_MODE_ANTCAL        12  // Three-node antenna delay calibration, stored to flash
+
+#ifndef APP_MODE
+#define APP_MODE APP_MODE_BEACON
+#endif
+
+#define STREAM_BENCH_FRAMES    1000
+#define DIAG_BENCH_FRAMES      1000
+#define RX_DOUBLE_BUFFER       1   // Receiver mode: use both DW1000 RX buffers
+#define RX_BURST_GAP_MS        5   // Receiver mode: silence that ends a burst
+#define RX_CIR_EVERY           0   // Receiver mode: stream the CIR of every Nth frame, 0 = off
+#define TWR_BENCH_EXCHANGES    500
+#define TWR_PAN_ID             0xDECA
+#define TWR_INITIATOR_ADDR     0x0001
+#ifndef TWR_RESPONDER_ADDR
+#define TWR_RESPONDER_ADDR     0x0002  // Tags: -DTWR_RESPONDER_ADDR=TDMA_TAG_FIRST_ADDR + n
+#endif
+#define TWR_REPLY_DELAY_US     DW_RNG_REPLY_DELAY_US
+#define TWR_METHOD             DW_RNG_SS_TWR
+#define TWR_BIAS_CORRECTION    1   // Correct ranges by RX level
+#ifndef RANGE_FILTER
+#define RANGE_FILTER           1   // Print filtered estimates, 0 for every raw range
+#endif
+#define TDMA_TAG_FIRST_ADDR    0x0010
+#define TDMA_TAG_COUNT         8
+#define TDMA_REPORT_MS         5000
+#define GROUP_FIRST_ANCHOR_ADDR 0x0002 // Anchors: -DTWR_RESPONDER_ADDR=GROUP_FIRST_ANCHOR_ADDR + n
+#define GROUP_ANCHOR_COUNT     4
+#define GROUP_BENCH_ROUNDS     500
+#ifndef TDOA_ANCHOR_ID
+#define TDOA_ANCHOR_ID         0x0001  // Anchors: -DTDOA_ANCHOR_ID=n
+#endif
+#define TDOA_MASTER_ID         0x0001  // Anchor that sends clock sync frames
+#ifndef TDOA_MASTER_DIST_MM
+#define TDOA_MASTER_DIST_MM    0       // Other anchors: surveyed distance to the master
+#endif
+#define TDOA_WIRED_SYNC        0       // 1: anchors share SYNC pulse and reference clock
+#define TDOA_REPORT_MS         5000
+#define TDOA_BLINK_PERIOD_MS   0       // Tag: 0 blinks back to back (load test)
+#ifndef ANTCAL_NODE
+#define ANTCAL_NODE            0       // Nodes: -DANTCAL_NODE=0, 1 or 2
+#endif
+#define ANTCAL_FIRST_ADDR      0x0020
+#define ANTCAL_DIST_01_MM      5000    // Surveyed distances between the nodes
+#define ANTCAL_DIST_02_MM      5000
+#define ANTCAL_DIST_12_MM      5000
+#define ANTCAL_START_DELAY_MS  3000    // Node 0 gives the others time to boot
+#define ANTCAL_REPORT_MS       2000
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -49,6 +119,13 @@ uint8_t dev_id[4]; // Buffer to store DEV_ID
 uint8_t sys_cfg[4];
 DW1000_Registers_t dw_registers;
 uint8_t current_eui[8];
+uint8_t tx_seq;
+DW_Time_t last_tx_time;
+uint32_t rx_frames, rx_errors;
+uint32_t rx_burst_frames, rx_last_tick;
+uint32_t tdma_report_tick;
+uint32_t tdoa_report_tick;
+uint32_t antcal_report_tick;
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -118,6 +195,112 @@ int main(void)
       printf("\n");
   }
 
+  /* Frame buffers for received frames */
+  DW_PoolInit();
+
+  /* Configure the PHY and standard transmission */
+  if (DW_Configure(&DW_PHY_DEFAULT) != HAL_OK ||
+      DW_EnableTxMode(DW_TX_MODE_STANDARD) != HAL_OK) {
+
+  }
+
+  /* Calibrated antenna delays, before any module reads TX_ANTD */
+  DW_AntCalLoad();
+
+#if APP_MODE == APP_MODE_RECEIVER
+  DW_RxSetDoubleBuffer(RX_DOUBLE_BUFFER);
+  DW_RxSetContinuous(true);
+  DW_RxEnable();
+#endif
+
+#if APP_MODE == APP_MODE_TWR_INITIATOR || APP_MODE == APP_MODE_TWR_RESPONDER
+  const DW_RangingConfig_t rng_cfg = {
+      .role = (APP_MODE == APP_MODE_TWR_INITIATOR) ? DW_RNG_ROLE_INITIATOR : DW_RNG_ROLE_RESPONDER,
+      .method = TWR_METHOD,
+      .pan_id = TWR_PAN_ID,
+      .short_addr = (APP_MODE == APP_MODE_TWR_INITIATOR) ? TWR_INITIATOR_ADDR : TWR_RESPONDER_ADDR,
+      .peer_addr = (APP_MODE == APP_MODE_TWR_INITIATOR) ? TWR_RESPONDER_ADDR : TWR_INITIATOR_ADDR,
+      .reply_delay_us = TWR_REPLY_DELAY_US,
+      .bias_correction = TWR_BIAS_CORRECTION
+  };
+  DW_RangingInit(&rng_cfg);
+#endif
+
+#if APP_MODE == APP_MODE_TWR_RESPONDER || APP_MODE == APP_MODE_TDMA_ANCHOR || \
+    APP_MODE == APP_MODE_GROUP_ANCHOR
+  DW_RangeFilterInit(NULL);
+#endif
+
+#if APP_MODE == APP_MODE_TDMA_ANCHOR
+  const DW_TdmaConfig_t tdma_cfg = {
+      .pan_id = TWR_PAN_ID,
+      .short_addr = TWR_INITIATOR_ADDR,
+      .reply_delay_us = TWR_REPLY_DELAY_US,
+      .superframe_min_us = 0,
+      .bias_correction = TWR_BIAS_CORRECTION
+  };
+  DW_TdmaInit(&tdma_cfg);
+  for (uint16_t i = 0; i < TDMA_TAG_COUNT; i++) {
+	  DW_TdmaAddTag(TDMA_TAG_FIRST_ADDR + i);
+  }
+  tdma_report_tick = HAL_GetTick();
+#endif
+
+#if APP_MODE == APP_MODE_GROUP_TAG || APP_MODE == APP_MODE_GROUP_ANCHOR
+  DW_GroupConfig_t grp_cfg = {
+      .role = (APP_MODE == APP_MODE_GROUP_TAG) ? DW_RNG_ROLE_INITIATOR : DW_RNG_ROLE_RESPONDER,
+      .pan_id = TWR_PAN_ID,
+      .short_addr = (APP_MODE == APP_MODE_GROUP_TAG) ? TWR_INITIATOR_ADDR : TWR_RESPONDER_ADDR,
+      .reply_delay_us = TWR_REPLY_DELAY_US,
+      .n_anchors = GROUP_ANCHOR_COUNT,
+      .bias_correction = TWR_BIAS_CORRECTION
+  };
+  for (uint8_t i = 0; i < GROUP_ANCHOR_COUNT; i++) {
+	  grp_cfg.anchors[i] = GROUP_FIRST_ANCHOR_ADDR + i;
+  }
+  DW_GroupInit(&grp_cfg);
+#endif
+
+#if APP_MODE == APP_MODE_TDOA_ANCHOR
+  const DW_TdoaConfig_t tdoa_cfg = {
+      .anchor_id = TDOA_ANCHOR_ID,
+      .flush_ms = DW_TDOA_FLUSH_MS,
+      .double_buffer = true
+  };
+  const DW_ClockSyncConfig_t csync_cfg = {
+#if TDOA_WIRED_SYNC
+      .role = DW_CSYNC_ROLE_WIRED,
+#else
+      .role = (TDOA_ANCHOR_ID == TDOA_MASTER_ID) ? DW_CSYNC_ROLE_MASTER : DW_CSYNC_ROLE_SLAVE,
+#endif
+      .pan_id = TWR_PAN_ID,
+      .short_addr = TDOA_ANCHOR_ID,
+      .master_addr = TDOA_MASTER_ID,
+      .master_dist_mm = TDOA_MASTER_DIST_MM,
+      .period_ms = DW_CSYNC_PERIOD_MS
+  };
+  DW_TdoaInit(&tdoa_cfg);
+  DW_ClockSyncInit(&csync_cfg);
+  tdoa_report_tick = HAL_GetTick();
+#endif
+
+#if APP_MODE == APP_MODE_ANTCAL
+  const DW_AntCalConfig_t antcal_cfg = {
+      .node = ANTCAL_NODE,
+      .pan_id = TWR_PAN_ID,
+      .addr = { ANTCAL_FIRST_ADDR, ANTCAL_FIRST_ADDR + 1, ANTCAL_FIRST_ADDR + 2 },
+      .dist_mm = { ANTCAL_DIST_01_MM, ANTCAL_DIST_02_MM, ANTCAL_DIST_12_MM },
+      .ranges = DW_ANTCAL_RANGES,
+      .reply_delay_us = TWR_REPLY_DELAY_US
+  };
+  DW_AntCalInit(&antcal_cfg);
+#if ANTCAL_NODE == 0
+  HAL_Delay(ANTCAL_START_DELAY_MS);
+  DW_AntCalStart();
+#endif
+  antcal_report_tick = HAL_GetTick();
+#endif
+
   /* USER CODE END 2 */
 
   /* Infinite loop */
@@ -128,18 +311,238 @@ int main(void)
 
     /* USER CODE BEGIN 3 */
 
+#if APP_MODE == APP_MODE_STREAM_BENCH
+	  DW_StreamStats_t stream_stats;
+
+	  if (DW_StreamBenchmark(DW_TX_FRAME_MAX - DW_FCS_LEN - DW_MAC_HDR_SHORT_LEN,
+			  STREAM_BENCH_FRAMES, &stream_stats) == HAL_OK) {
+		  DW_StreamPrintStats(&stream_stats);
+	  }
+	  HAL_Delay(1000);
+#elif APP_MODE == APP_MODE_DIAG_BENCH
+	  DW_DiagBench_t diag_bench;
+
+	  if (DW_DiagBenchmark(DIAG_BENCH_FRAMES, &diag_bench) == HAL_OK) {
+		  printf("Diag cycles/frame: read %lu, fixed %lu, float %lu, max error %d cdB\n",
+				  (unsigned long)diag_bench.read_cycles, (unsigned long)diag_bench.fixed_cycles,
+				  (unsigned long)diag_bench.float_cycles, diag_bench.max_error);
+	  }
+	  HAL_Delay(1000);
+#elif APP_MODE == APP_MODE_TWR_INITIATOR
+	  DW_RangingBench_t rng_bench;
+
+	  if (DW_RangingBenchmark(TWR_BENCH_EXCHANGES, &rng_bench) == HAL_OK) {
+		  DW_RangingPrintBench(&rng_bench);
+	  }
+	  HAL_Delay(1000);
+#elif APP_MODE == APP_MODE_TWR_RESPONDER
+	  DW_Event_t evt;
+
+	  DW_RangeResult_t range;
+#if RANGE_FILTER
+	  DW_RangeEstimate_t est;
+#endif
+
+	  /* Polls are answered from here, within the reply delay */
+	  DW_ProcessEvents();
+	  while (DW_GetEvent(&evt)) {
+		  if (DW_RangingHandleEvent(&evt, &range)) {
+#if RANGE_FILTER
+			  if (DW_RangeFilterUpdate(&range, &est)) {
+				  DW_RangeFilterPrintEstimate(&est);
+			  }
+#else
+			  printf("Range %04X: %ld mm, offset %ld ppb\n", range.peer,
+					  (long)range.distance_mm, (long)range.clock_offset_ppb);
+#endif
+		  }
+		  if (evt.type == DW_EVENT_RX_FRAME) {
+			  DW_PoolFree(evt.rx.frame);
+		  }
+	  }
+#elif APP_MODE == APP_MODE_TDMA_ANCHOR
+	  DW_Event_t evt;
+
+	  /* Slots follow each other from the event handler */
+	  DW_TdmaRun();
+	  DW_ProcessEvents();
+	  while (DW_GetEvent(&evt)) {
+#if RANGE_FILTER
+		  DW_RangeResult_t range;
+		  DW_RangeEstimate_t est;
+
+		  if (DW_TdmaHandleEvent(&evt, &range) && DW_RangeFilterUpdate(&range, &est)) {
+			  DW_RangeFilterPrintEstimate(&est);
+		  }
+#else
+		  DW_TdmaHandleEvent(&evt, NULL);
+#endif
+		  if (evt.type == DW_EVENT_RX_FRAME) {
+			  DW_PoolFree(evt.rx.frame);
+		  }
+	  }
+
+	  if (HAL_GetTick() - tdma_report_tick >= TDMA_REPORT_MS) {
+		  DW_TdmaPrintStats();
+		  DW_TdmaResetStats();
+		  tdma_report_tick = HAL_GetTick();
+	  }
+#elif APP_MODE == APP_MODE_GROUP_TAG
+	  DW_GroupBench_t grp_bench;
+
+	  if (DW_GroupBenchmark(GROUP_BENCH_ROUNDS, &grp_bench) == HAL_OK) {
+		  DW_GroupPrintBench(&grp_bench);
+	  }
+	  HAL_Delay(1000);
+#elif APP_MODE == APP_MODE_GROUP_ANCHOR
+	  DW_Event_t evt;
+	  DW_RangeResult_t grp_range[DW_GRP_MAX_ANCHORS];
+
+	  /* Polls are answered from here, before this anchor's slot */
+	  DW_ProcessEvents();
+	  while (DW_GetEvent(&evt)) {
+		  if (DW_GroupHandleEvent(&evt, grp_range)) {
+#if RANGE_FILTER
+			  DW_RangeEstimate_t est;
+
+			  if (DW_RangeFilterUpdate(&grp_range[0], &est)) {
+				  DW_RangeFilterPrintEstimate(&est);
+			  }
+#else
+			  printf("Range %04X: %ld mm, offset %ld ppb\n", grp_range[0].peer,
+					  (long)grp_range[0].distance_mm, (long)grp_range[0].clock_offset_ppb);
+#endif
+		  }
+		  if (evt.type == DW_EVENT_RX_FRAME) {
+			  DW_PoolFree(evt.rx.frame);
+		  }
+	  }
+#elif APP_MODE == APP_MODE_TDOA_ANCHOR
+	  /* Blinks are batched to the host and clock sync runs from here */
+	  DW_TdoaRun();
+
+	  if (HAL_GetTick() - tdoa_report_tick >= TDOA_REPORT_MS) {
+		  DW_TdoaFlush();
+		  DW_TdoaPrintStats();
+		  DW_ClockSyncPrintStats();
+		  DW_TdoaResetStats();
+		  tdoa_report_tick = HAL_GetTick();
+	  }
+#elif APP_MODE == APP_MODE_TDOA_TAG
+	  DW_Event_t evt;
+	  uint64_t tag_id = 0;
+
+	  for (uint8_t i = 0; i < 8; i++) {
+		  tag_id |= (uint64_t)current_eui[i] << (8 * i);
+	  }
+
+	  if (DW_TdoaBlink(tag_id, tx_seq++) == HAL_OK) {
+		  DW_WaitTxDone(10);
+	  }
+	  /* Completions are not needed, keep the queue empty */
+	  DW_ProcessEvents();
+	  while (DW_GetEvent(&evt)) {
+	  }
+#if TDOA_BLINK_PERIOD_MS
+	  HAL_Delay(TDOA_BLINK_PERIOD_MS);
+#endif
+#elif APP_MODE == APP_MODE_ANTCAL
+	  DW_AntCalResult_t antcal;
+
+	  /* Polls of the other nodes are answered from here */
+	  DW_AntCalRun();
+
+	  DW_AntCalGetResult(&antcal);
+	  if (HAL_GetTick() - antcal_report_tick >= ANTCAL_REPORT_MS) {
+		  DW_AntCalPrintResult();
+		  antcal_report_tick = HAL_GetTick();
+	  }
+	  if (antcal.state == DW_ANTCAL_DONE || antcal.state == DW_ANTCAL_FAILED) {
+		  DW_AntCalPrintResult();
+		  while (1) {
+		  }
+	  }
+#elif APP_MODE == APP_MODE_TWR_SIM
+	  static const int32_t sim_offsets_ppb[] = { 0, 5000, 20000, 40000 };
+	  DW_RangingSimModel_t sim_model = {
+		  .distance_mm = 10000,
+		  .drift_ppb_s = 200,
+		  .reply1_us = TWR_REPLY_DELAY_US,
+		  .reply2_us = TWR_REPLY_DELAY_US + 1000,
+		  .jitter_us = 500,
+		  .noise_ticks = 8,
+		  .rx_offset_noise_ppb = 100,
+		  .period_us = 10000,
+		  .iterations = 1000
+	  };
+	  DW_RangingSim_t sim;
+
+	  for (uint8_t i = 0; i < sizeof(sim_offsets_ppb) / sizeof(sim_offsets_ppb[0]); i++) {
+		  sim_model.offset_ppb = sim_offsets_ppb[i];
+		  if (DW_RangingSimulate(&sim_model, &sim) == HAL_OK) {
+			  DW_RangingPrintSim(&sim_model, &sim);
+		  }
+	  }
+	  HAL_Delay(5000);
+#elif APP_MODE == APP_MODE_RECEIVER
+	  DW_Event_t evt;
+
+	  DW_ProcessEvents();
+	  while (DW_GetEvent(&evt)) {
+		  if (evt.type == DW_EVENT_RX_FRAME) {
+			  rx_frames++;
+			  rx_burst_frames++;
+			  rx_last_tick = HAL_GetTick();
+#if RX_CIR_EVERY
+			  if (rx_frames % RX_CIR_EVERY == 0) {
+				  const DW_CirConfig_t cir_cfg = { .pre_samples = 16, .samples = 64 };
+				  DW_CirCapture(&evt.rx, &cir_cfg);
+			  }
+#endif
+			  DW_PoolFree(evt.rx.frame);
+		  } else {
+			  rx_errors++;
+		  }
+	  }
 
-	  /* Example: Send a UWB frame */
-	  uint8_t frame_data[] = {0x41, 0x88, 0x00, 0xCA, 0xDE, 0xAD, 0xBE, 0xEF};
+	  /* Report frames captured per burst and how long the radio was deaf */
+	  if (rx_burst_frames && HAL_GetTick() - rx_last_tick > RX_BURST_GAP_MS) {
+		  DW_RxCounters_t rx_cnt;
 
-	  /* Configure for standard transmission */
-	  if (DW_EnableTxMode(DW_TX_MODE_STANDARD) != HAL_OK) {
+		  DW_RxGetCounters(&rx_cnt);
+		  printf("Burst: %lu frames, deaf %lu us (max %lu us), FCS err %lu, PHR err %lu, overruns %lu\n",
+				  (unsigned long)rx_burst_frames, (unsigned long)rx_cnt.deaf_us,
+				  (unsigned long)rx_cnt.deaf_max_us, (unsigned long)rx_cnt.fcs_errors,
+				  (unsigned long)rx_cnt.phr_errors, (unsigned long)rx_cnt.overruns);
+		  rx_burst_frames = 0;
+	  }
+#else
+	  /* Example: Send a UWB frame built in place in the SPI TX buffer */
+	  DW_FrameBuilder_t fb;
+	  DW_Event_t evt;
+	  uint8_t* payload;
+
+	  /* Collect the completion of the previous frame */
+	  DW_ProcessEvents();
+	  while (DW_GetEvent(&evt)) {
+		  if (evt.type == DW_EVENT_TX_DONE && evt.tx.status == DW_TX_OK) {
+			  last_tx_time = evt.tx.tx_time;
+		  }
+	  }
 
+	  DW_FrameBegin(&fb);
+	  DW_FrameWriteMacHeader(&fb, DW_FC_TYPE_DATA, tx_seq++, 0xDECA, 0xFFFF, 0x0001);
+	  payload = DW_FrameReserve(&fb, 4);
+	  if (payload) {
+		  payload[0] = 0xDE;
+		  payload[1] = 0xAD;
+		  payload[2] = 0xBE;
+		  payload[3] = 0xEF;
+		  DW_FrameSend(&fb);
 	  }
 
-	  /* Disable TX when done */
-	  DW_DisableTxMode();
 	  HAL_Delay(100);
+#endif
 
   }
   /* USER CODE END 3 */
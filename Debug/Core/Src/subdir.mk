@@ -6,6 +6,19 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
 ../Core/Src/DW1000.c \
+../Core/Src/DW_AntCal.c \
+../Core/Src/DW_Cir.c \
+../Core/Src/DW_ClockSync.c \
+../Core/Src/DW_Diag.c \
+../Core/Src/DW_ExtSync.c \
+../Core/Src/DW_FramePool.c \
+../Core/Src/DW_Group.c \
+../Core/Src/DW_RangeBias.c \
+../Core/Src/DW_RangeFilter.c \
+../Core/Src/DW_Ranging.c \
+../Core/Src/DW_Stream.c \
+../Core/Src/DW_Tdma.c \
+../Core/Src/DW_Tdoa.c \
 ../Core/Src/main.c \
 ../Core/Src/stm32f1xx_hal_msp.c \
 ../Core/Src/stm32f1xx_it.c \
@@ -15,6 +28,19 @@ C_SRCS += \
 
 OBJS += \
 ./Core/Src/DW1000.o \
+./Core/Src/DW_AntCal.o \
+./Core/Src/DW_Cir.o \
+./Core/Src/DW_ClockSync.o \
+./Core/Src/DW_Diag.o \
+./Core/Src/DW_ExtSync.o \
+./Core/Src/DW_FramePool.o \
+./Core/Src/DW_Group.o \
+./Core/Src/DW_RangeBias.o \
+./Core/Src/DW_RangeFilter.o \
+./Core/Src/DW_Ranging.o \
+./Core/Src/DW_Stream.o \
+./Core/Src/DW_Tdma.o \
+./Core/Src/DW_Tdoa.o \
 ./Core/Src/main.o \
 ./Core/Src/stm32f1xx_hal_msp.o \
 ./Core/Src/stm32f1xx_it.o \
@@ -24,6 +50,19 @@ OBJS += \
 
 C_DEPS += \
 ./Core/Src/DW1000.d \
+./Core/Src/DW_AntCal.d \
+./Core/Src/DW_Cir.d \
+./Core/Src/DW_ClockSync.d \
+./Core/Src/DW_Diag.d \
+./Core/Src/DW_ExtSync.d \
+./Core/Src/DW_FramePool.d \
+./Core/Src/DW_Group.d \
+./Core/Src/DW_RangeBias.d \
+./Core/Src/DW_RangeFilter.d \
+./Core/Src/DW_Ranging.d \
+./Core/Src/DW_Stream.d \
+./Core/Src/DW_Tdma.d \
+./Core/Src/DW_Tdoa.d \
 ./Core/Src/main.d \
 ./Core/Src/stm32f1xx_hal_msp.d \
 ./Core/Src/stm32f1xx_it.d \
@@ -39,7 +78,7 @@ Core/Src/%.o Core/Src/%.su Core/Src/%.cyclo: ../Core/Src/%.c Core/Src/subdir.mk
 clean: clean-Core-2f-Src
 
 clean-Core-2f-Src:
-	-$(RM) ./Core/Src/DW1000.cyclo ./Core/Src/DW1000.d ./Core/Src/DW1000.o ./Core/Src/DW1000.su ./Core/Src/main.cyclo ./Core/Src/main.d ./Core/Src/main.o ./Core/Src/main.su ./Core/Src/stm32f1xx_hal_msp.cyclo ./Core/Src/stm32f1xx_hal_msp.d ./Core/Src/stm32f1xx_hal_msp.o ./Core/Src/stm32f1xx_hal_msp.su ./Core/Src/stm32f1xx_it.cyclo ./Core/Src/stm32f1xx_it.d ./Core/Src/stm32f1xx_it.o ./Core/Src/stm32f1xx_it.su ./Core/Src/syscalls.cyclo ./Core/Src/syscalls.d ./Core/Src/syscalls.o ./Core/Src/syscalls.su ./Core/Src/sysmem.cyclo ./Core/Src/sysmem.d ./Core/Src/sysmem.o ./Core/Src/sysmem.su ./Core/Src/system_stm32f1xx.cyclo ./Core/Src/system_stm32f1xx.d ./Core/Src/system_stm32f1xx.o ./Core/Src/system_stm32f1xx.su
+	-$(RM) ./Core/Src/DW1000.cyclo ./Core/Src/DW1000.d ./Core/Src/DW1000.o ./Core/Src/DW1000.su ./Core/Src/DW_AntCal.cyclo ./Core/Src/DW_AntCal.d ./Core/Src/DW_AntCal.o ./Core/Src/DW_AntCal.su ./Core/Src/DW_Cir.cyclo ./Core/Src/DW_Cir.d ./Core/Src/DW_Cir.o ./Core/Src/DW_Cir.su ./Core/Src/DW_ClockSync.cyclo ./Core/Src/DW_ClockSync.d ./Core/Src/DW_ClockSync.o ./Core/Src/DW_ClockSync.su ./Core/Src/DW_Diag.cyclo ./Core/Src/DW_Diag.d ./Core/Src/DW_Diag.o ./Core/Src/DW_Diag.su ./Core/Src/DW_ExtSync.cyclo ./Core/Src/DW_ExtSync.d ./Core/Src/DW_ExtSync.o ./Core/Src/DW_ExtSync.su ./Core/Src/DW_FramePool.cyclo ./Core/Src/DW_FramePool.d ./Core/Src/DW_FramePool.o ./Core/Src/DW_FramePool.su ./Core/Src/DW_Group.cyclo ./Core/Src/DW_Group.d ./Core/Src/DW_Group.o ./Core/Src/DW_Group.su ./Core/Src/DW_RangeBias.cyclo ./Core/Src/DW_RangeBias.d ./Core/Src/DW_RangeBias.o ./Core/Src/DW_RangeBias.su ./Core/Src/DW_RangeFilter.cyclo ./Core/Src/DW_RangeFilter.d ./Core/Src/DW_RangeFilter.o ./Core/Src/DW_RangeFilter.su ./Core/Src/DW_Ranging.cyclo ./Core/Src/DW_Ranging.d ./Core/Src/DW_Ranging.o ./Core/Src/DW_Ranging.su ./Core/Src/DW_Stream.cyclo ./Core/Src/DW_Stream.d ./Core/Src/DW_Stream.o ./Core/Src/DW_Stream.su ./Core/Src/DW_Tdma.cyclo ./Core/Src/DW_Tdma.d ./Core/Src/DW_Tdma.o ./Core/Src/DW_Tdma.su ./Core/Src/DW_Tdoa.cyclo ./Core/Src/DW_Tdoa.d ./Core/Src/DW_Tdoa.o ./Core/Src/DW_Tdoa.su ./Core/Src/main.cyclo ./Core/Src/main.d ./Core/Src/main.o ./Core/Src/main.su ./Core/Src/stm32f1xx_hal_msp.cyclo ./Core/Src/stm32f1xx_hal_msp.d ./Core/Src/stm32f1xx_hal_msp.o ./Core/Src/stm32f1xx_hal_msp.su ./Core/Src/stm32f1xx_it.cyclo ./Core/Src/stm32f1xx_it.d ./Core/Src/stm32f1xx_it.o ./Core/Src/stm32f1xx_it.su ./Core/Src/syscalls.cyclo ./Core/Src/syscalls.d ./Core/Src/syscalls.o ./Core/Src/syscalls.su ./Core/Src/sysmem.cyclo ./Core/Src/sysmem.d ./Core/Src/sysmem.o ./Core/Src/sysmem.su ./Core/Src/system_stm32f1xx.cyclo ./Core/Src/system_stm32f1xx.d ./Core/Src/system_stm32f1xx.o ./Core/Src/system_stm32f1xx.su
 
 .PHONY: clean-Core-2f-Src
 